@@ -0,0 +1,46 @@
+# Automatically generated by build system.
+# Non-empty value means found, empty means not found.
+HAVE_ALSA_H:=
+HAVE_ALSA_LIB:=
+ALSA_CFLAGS:=
+ALSA_LDFLAGS:=-lasound
+HAVE_GL_H:=true
+HAVE_GL_LIB:=true
+GL_CFLAGS:=
+GL_LDFLAGS:=-lGL
+HAVE_GLEW_H:=
+HAVE_GLEW_LIB:=
+GLEW_CFLAGS:=
+GLEW_LDFLAGS:=-lGLEW
+HAVE_OGG_H:=
+HAVE_OGG_LIB:=
+OGG_CFLAGS:=
+OGG_LDFLAGS:=-logg
+HAVE_PNG_H:=true
+HAVE_PNG_LIB:=true
+PNG_CFLAGS:=-I/usr/include/libpng16
+PNG_LDFLAGS:=-lpng16
+HAVE_SDL_H:=
+HAVE_SDL_LIB:=
+SDL_CFLAGS:=
+SDL_LDFLAGS:=
+HAVE_SDL_TTF_H:=
+HAVE_SDL_TTF_LIB:=
+SDL_TTF_CFLAGS:=
+SDL_TTF_LDFLAGS:=
+HAVE_TCL_H:=true
+HAVE_TCL_LIB:=true
+TCL_CFLAGS:=-I/usr/include/tcl8.6
+TCL_LDFLAGS:=-L/usr/lib/x86_64-linux-gnu -ltcl8.6
+HAVE_THEORA_H:=
+HAVE_THEORA_LIB:=
+THEORA_CFLAGS:=
+THEORA_LDFLAGS:=-ltheoradec
+HAVE_VORBIS_H:=
+HAVE_VORBIS_LIB:=
+VORBIS_CFLAGS:=
+VORBIS_LDFLAGS:=-lvorbis
+HAVE_ZLIB_H:=true
+HAVE_ZLIB_LIB:=true
+ZLIB_CFLAGS:=
+ZLIB_LDFLAGS:=-lz
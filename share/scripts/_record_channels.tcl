@@ -210,13 +210,14 @@ proc record_channels {args} {
 			set var ::${device}_ch${ch}_record
 			if {$start} {
 				set directory [file normalize $::env(OPENMSX_USER_DATA)/../soundlogs]
-				# create dir always
-				file mkdir $directory
 				set software_section $prefix
 				if {$software_section ne ""} {
 					set software_section "${software_section}-"
 				}
-				set $var [utils::get_next_numbered_filename $directory "${software_section}${device}-ch${ch}_" ".wav"]
+				set file_prefix "${software_section}${device}-ch${ch}_"
+				# create dir always, the prefix may contain a subdirectory
+				file mkdir [file dirname [file join $directory $file_prefix]]
+				set $var [utils::get_next_numbered_filename $directory $file_prefix ".wav"]
 				append retval "Recording $device channel $ch to [set $var]...\n"
 			} else {
 				if {[set $var] ne ""} {
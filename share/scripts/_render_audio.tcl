@@ -0,0 +1,137 @@
+namespace eval render_audio {
+
+set_help_text render_audio \
+{Renders the audio of a replay to a WAV file, faster than real time.
+
+The replay is loaded, emulation runs with throttling disabled and without
+video output, and the mixer output is recorded at the requested sample rate
+using the high quality resampler. When the end of the replay is reached the
+recording is stopped and all changed settings are restored.
+
+Usage:
+   render_audio <replay> [<options>]
+
+Options:
+   -prefix <prefix>     name of the output file, also used as prefix for
+                        the per-channel files (default: the replay name),
+                        the per-channel files are always written in the
+                        'soundlogs' directory
+   -frequency <hz>      sample rate of the output (default: 44100)
+   -mono                record in mono (default: stereo)
+   -stems               also record each channel of each sound chip in a
+                        separate file (see 'record_channels')
+   -exit                exit openMSX when rendering is done, useful for
+                        batch rendering, e.g.:
+                          openmsx -setting <file> -script render.tcl
+
+Examples:
+   render_audio mygame
+   render_audio mygame -frequency 48000 -stems -prefix render/mygame
+}
+
+set_tabcompletion_proc render_audio [namespace code tab_render_audio]
+proc tab_render_audio {args} {
+	if {[llength $args] == 2} {
+		return [utils::file_completion {*}$args]
+	}
+	return "-prefix -frequency -mono -stems -exit"
+}
+
+variable old_settings [dict create]
+variable stems false
+variable exit_when_done false
+variable prefix ""
+
+proc render_audio {replay args} {
+	variable old_settings
+	variable stems
+	variable exit_when_done
+	variable prefix
+
+	if {[dict size $old_settings] != 0} {
+		error "Already rendering audio"
+	}
+
+	set prefix [file rootname [file tail $replay]]
+	set frequency 44100
+	set stereo_flag "-stereo"
+	set stems false
+	set exit_when_done false
+	while {[llength $args] > 0} {
+		set option [lindex $args 0]
+		set args [lrange $args 1 end]
+		switch -- $option {
+			"-prefix" {
+				set prefix [lindex $args 0]
+				set args [lrange $args 1 end]
+			}
+			"-frequency" {
+				set frequency [lindex $args 0]
+				set args [lrange $args 1 end]
+			}
+			"-mono"  {set stereo_flag "-mono"}
+			"-stems" {set stems true}
+			"-exit"  {set exit_when_done true}
+			default  {error "Invalid option: $option"}
+		}
+	}
+
+	# Use the null sound driver so that emulation isn't slowed down by
+	# (or synchronized to) the host audio device. The null driver still
+	# determines the mixer sample rate.
+	foreach {setting value} [list \
+			sound_driver null \
+			frequency $frequency \
+			resampler hq \
+			throttle off \
+			renderer none] {
+		dict set old_settings $setting [set ::$setting]
+		set ::$setting $value
+	}
+
+	if {[catch {
+		reverse loadreplay -goto begin $replay
+		# must come after loading the replay: that replaces the machine
+		if {[file dirname $prefix] ne "."} {
+			# 'record' doesn't create the directory of the given file
+			file mkdir [file dirname $prefix]
+		}
+		record start -audioonly $stereo_flag $prefix
+		if {$stems} {
+			record_channels start all -prefix $prefix
+		}
+	} msg]} {
+		finish
+		error $msg
+	}
+
+	set status [reverse status]
+	set duration [expr {[dict get $status end] - [dict get $status current]}]
+	after time $duration [namespace code finish]
+	return "Rendering [format %.1f $duration] seconds of audio..."
+}
+
+proc finish {} {
+	variable old_settings
+	variable stems
+	variable exit_when_done
+
+	catch {record stop}
+	if {$stems} {
+		catch {record_channels stop}
+	}
+	dict for {setting value} $old_settings {
+		set ::$setting $value
+	}
+	set old_settings [dict create]
+	message "Audio rendering done."
+	if {$exit_when_done} {
+		exit
+	}
+}
+
+namespace export render_audio
+
+} ;# namespace render_audio
+
+namespace import render_audio::*
@@ -0,0 +1,102 @@
+namespace eval soundchip_benchmark {
+
+set_help_text soundchip_benchmark \
+{Replays a register log (as recorded with 'reg_log record') into a sound chip,
+generates the corresponding samples directly at the native rate of the chip and
+reports the generation speed and a hash of the generated output. This can be
+used to measure and verify performance work on the sound chip emulation cores.
+
+Usage:
+   soundchip_benchmark <device> <filename> [<options>]
+
+Options:
+   -debuggable <name>   debuggable to write the registers to
+                        (default: "<device> regs")
+   -fps <rate>          number of log lines per second (default: 60)
+   -expect <sha1>       verify the hash of the generated output, raises an
+                        error on mismatch
+   -repeat <count>      replay the log multiple times (default: 1)
+
+The result is a dict with keys samples, seconds, samples_per_second,
+cycles_per_sample (only on hosts that support it) and hash.
+
+Note that this directly drives the sound chip, so the emulated machine is
+disturbed. Preferably use it on a dedicated machine with emulation paused.
+
+Examples:
+   soundchip_benchmark PSG "PSG regs.log"
+   soundchip_benchmark SCC scc.log -debuggable "SCC SCC" -expect <sha1>
+}
+
+set_tabcompletion_proc soundchip_benchmark [namespace code tab_soundchip_benchmark]
+proc tab_soundchip_benchmark {args} {
+	switch [llength $args] {
+		2 {return [machine_info sounddevice]}
+		3 {return [utils::file_completion {*}$args]}
+		default {return "-debuggable -fps -expect -repeat"}
+	}
+}
+
+proc soundchip_benchmark {device filename args} {
+	set debuggable "$device regs"
+	set fps 60
+	set expect ""
+	set repeat 1
+	while {[llength $args] > 0} {
+		set option [lindex $args 0]
+		set value [lindex $args 1]
+		set args [lrange $args 2 end]
+		switch -- $option {
+			"-debuggable" {set debuggable $value}
+			"-fps"        {set fps $value}
+			"-expect"     {set expect $value}
+			"-repeat"     {set repeat $value}
+			default {error "Invalid option: $option"}
+		}
+	}
+	if {$device ni [machine_info sounddevice]} {
+		error "No such sound device: $device"
+	}
+	if {$debuggable ni [debug list]} {
+		error "No such debuggable: $debuggable"
+	}
+
+	set log_file [open $filename RDONLY]
+	set lines [split [read $log_file] \n]
+	close $log_file
+
+	set rate [soundchip_generate $device rate]
+	soundchip_generate $device reset
+	set remainder 0.0
+	for {set i 0} {$i < $repeat} {incr i} {
+		set prev [list]
+		foreach line $lines {
+			if {$line eq ""} continue
+			# only write the registers that changed since the previous line
+			set reg 0
+			foreach val $line {
+				if {$val ne [lindex $prev $reg]} {
+					debug write $debuggable $reg $val
+				}
+				incr reg
+			}
+			set prev $line
+			set exact [expr {$rate / double($fps) + $remainder}]
+			set num [expr {int($exact)}]
+			set remainder [expr {$exact - $num}]
+			soundchip_generate $device $num
+		}
+	}
+
+	set stats [soundchip_generate $device stats]
+	if {$expect ne "" && [dict get $stats hash] ne $expect} {
+		error "Hash mismatch for $device: expected $expect but got [dict get $stats hash]"
+	}
+	return $stats
+}
+
+namespace export soundchip_benchmark
+
+} ;# namespace soundchip_benchmark
+
+namespace import soundchip_benchmark::*
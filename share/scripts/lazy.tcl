@@ -39,6 +39,7 @@ register_lazy "_record_channels.tcl" {
 register_lazy "_record_chunks.tcl" {
 	record_chunks record_chunks_on_framerate_changes}
 register_lazy "_reg_log.tcl" reg_log
+register_lazy "_render_audio.tcl" render_audio
 register_lazy "_reverse.tcl" {
 	reverse_prev reverse_next goto_time_delta go_back_one_step
 	go_forward_one_step reverse_bookmarks
@@ -56,6 +57,7 @@ register_lazy "_showdebuggable.tcl" {showdebuggable showmem}
 register_lazy "_slot.tcl" {
 	get_selected_slot slotselect get_mapper_size pc_in_slot watch_in_slot
 	address_in_slot slotmap iomap}
+register_lazy "_soundchip_benchmark.tcl" soundchip_benchmark
 register_lazy "_soundchip_utils.tcl" {
 	get_num_channels get_volume_expr get_frequency_expr}
 register_lazy "_soundlog.tcl" soundlog
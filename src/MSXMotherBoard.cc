@@ -171,6 +171,7 @@ private:
 
 
 static unsigned machineIDCounter = 0;
+static unsigned configGenerationCounter = 0;
 
 MSXMotherBoard::MSXMotherBoard(Reactor& reactor_)
 	: reactor(reactor_)
@@ -191,6 +192,7 @@ MSXMotherBoard::MSXMotherBoard(Reactor& reactor_)
 	, fastForwardHelper(make_unique<FastForwardHelper>(*this))
 	, settingObserver(make_unique<SettingObserver>(*this))
 	, powerSetting(reactor.getGlobalSettings().getPowerSetting())
+	, configGeneration(++configGenerationCounter)
 	, powered(false)
 	, active(false)
 	, fastForwarding(false)
@@ -260,6 +262,7 @@ void MSXMotherBoard::setMachineConfig(HardwareConfig* machineConfig_)
 {
 	assert(!getMachineConfig());
 	machineConfig = machineConfig_;
+	configChanged();
 
 	// make sure the CPU gets instantiated from the main thread
 	assert(!msxCpu);
@@ -332,6 +335,7 @@ string MSXMotherBoard::insertExtension(
 	}
 	string result = extension->getName();
 	extensions.push_back(std::move(extension));
+	configChanged();
 	getMSXCliComm().update(CliComm::EXTENSION, result, "add");
 	return result;
 }
@@ -351,6 +355,12 @@ void MSXMotherBoard::removeExtension(const HardwareConfig& extension)
 	auto it = rfind_if_unguarded(extensions,
 		[&](Extensions::value_type& v) { return v.get() == &extension; });
 	extensions.erase(it);
+	configChanged();
+}
+
+void MSXMotherBoard::configChanged()
+{
+	configGeneration = ++configGenerationCounter;
 }
 
 CliComm& MSXMotherBoard::getMSXCliComm()
@@ -1053,6 +1063,29 @@ void SettingObserver::update(const Setting& setting)
 // version 2: added reRecordCount
 // version 3: removed reRecordCount (moved to ReverseManager)
 // version 4: moved joystickportA/B from MSXPSG to here
+// Load the state of the hardware configs into the already existing
+// HardwareConfig objects. This must match the layout of serializeWithID() on
+// 'machineConfig2' and 'extensions' below. Only memory archives support this.
+template<typename Archive>
+static void restoreConfigsInPlace(Archive& /*ar*/, HardwareConfig& /*config*/,
+                                  MSXMotherBoard::Extensions& /*extensions*/)
+{
+	UNREACHABLE;
+}
+static void restoreConfigsInPlace(MemInputArchive& ar, HardwareConfig& config,
+                                  MSXMotherBoard::Extensions& extensions)
+{
+	config.restoreInPlace(ar);
+	int num;
+	ar.serialize("size", num);
+	if (unsigned(num) != extensions.size()) {
+		throw MSXException("Snapshot has a different set of extensions.");
+	}
+	for (auto& e : extensions) {
+		e->restoreInPlace(ar);
+	}
+}
+
 template<typename Archive>
 void MSXMotherBoard::serialize(Archive& ar, unsigned version)
 {
@@ -1067,14 +1100,22 @@ void MSXMotherBoard::serialize(Archive& ar, unsigned version)
 	ar.serialize("scheduler", *scheduler);
 	// MSXMixer has already set syncpoints, those are invalid now
 	// the following call will fix this
-	if (ar.isLoader()) {
+	if (ar.isInPlaceRestore()) {
+		// the sound devices still hold samples of the abandoned
+		// time-line
+		msxMixer->resetStreams();
+	} else if (ar.isLoader()) {
 		msxMixer->reInit();
 	}
 
 	ar.serialize("name", machineName);
-	ar.serializeWithID("config", machineConfig2, std::ref(*this));
-	assert(getMachineConfig() == machineConfig2.get());
-	ar.serializeWithID("extensions", extensions, std::ref(*this));
+	if (ar.isInPlaceRestore()) {
+		restoreConfigsInPlace(ar, *machineConfig2, extensions);
+	} else {
+		ar.serializeWithID("config", machineConfig2, std::ref(*this));
+		assert(getMachineConfig() == machineConfig2.get());
+		ar.serializeWithID("extensions", extensions, std::ref(*this));
+	}
 
 	if (mapperIO) ar.serialize("mapperIO", *mapperIO);
 
@@ -1103,10 +1144,11 @@ void MSXMotherBoard::serialize(Archive& ar, unsigned version)
 	}
 
 	if (ar.isLoader()) {
+		bool wasPowered = powered; // only possible for in-place restore
 		powered = true; // must come before changing power setting
 		powerSetting.setBoolean(true);
 		getLedStatus().setLed(LedStatus::POWER, true);
-		msxMixer->unmute();
+		if (!wasPowered) msxMixer->unmute();
 	}
 
 	if (version == 2) {
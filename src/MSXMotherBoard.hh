@@ -111,6 +111,15 @@ public:
 	                            std::unique_ptr<HardwareConfig> extension);
 	void removeExtension(const HardwareConfig& extension);
 
+	/** Identifies the current hardware configuration (machine and
+	 * extensions). A new (globally unique) value is assigned on every
+	 * change. ReverseManager uses this to decide whether a snapshot can
+	 * be restored into this machine directly.
+	 */
+	unsigned getConfigGeneration() const { return configGeneration; }
+	void setConfigGeneration(unsigned generation) { configGeneration = generation; }
+	void configChanged();
+
 	// The following classes are unique per MSX machine
 	CliComm& getMSXCliComm();
 	MSXCommandController& getMSXCommandController() { return *msxCommandController; }
@@ -261,6 +270,7 @@ private:
 	friend class SettingObserver;
 	BooleanSetting& powerSetting;
 
+	unsigned configGeneration;
 	bool powered;
 	bool active;
 	bool fastForwarding;
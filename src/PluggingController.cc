@@ -252,6 +252,13 @@ EmuTime::param PluggingController::getCurrentTime() const
 	return motherBoard.getCurrentTime();
 }
 
+void PluggingController::unplugAll(EmuTime::param time)
+{
+	for (auto& c : connectors) {
+		c->unplug(time);
+	}
+}
+
 
 // Pluggable info
 
@@ -51,6 +51,12 @@ public:
 	 */
 	EmuTime::param getCurrentTime() const;
 
+	/** Unplug the Pluggables from all Connectors. Used before a reverse
+	 * snapshot is loaded into this (existing) machine, the loader then
+	 * re-plugs them like it does in a new machine.
+	 */
+	void unplugAll(EmuTime::param time);
+
 private:
 	Connector& getConnector(string_ref name) const;
 	Pluggable& getPluggable(string_ref name) const;
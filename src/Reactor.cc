@@ -37,6 +37,7 @@
 #include "Thread.hh"
 #include "Timer.hh"
 #include "serialize.hh"
+#include "DeltaBlock.hh"
 #include "openmsx.hh"
 #include "checked_cast.hh"
 #include "statp.hh"
@@ -148,6 +149,17 @@ private:
 	Reactor& reactor;
 };
 
+class CloneMachineCommand final : public Command
+{
+public:
+	CloneMachineCommand(CommandController& commandController, Reactor& reactor);
+	void execute(array_ref<TclObject> tokens, TclObject& result) override;
+	string help(const vector<string>& tokens) const override;
+	void tabCompletion(vector<string>& tokens) const override;
+private:
+	Reactor& reactor;
+};
+
 class ConfigInfo final : public InfoTopic
 {
 public:
@@ -188,7 +200,7 @@ void Reactor::init()
 {
 	rtScheduler = make_unique<RTScheduler>();
 	eventDistributor = make_unique<EventDistributor>(*this);
-	globalCliComm = make_unique<GlobalCliComm>();
+	globalCliComm = make_unique<GlobalCliComm>(*eventDistributor);
 	globalCommandController = make_unique<GlobalCommandController>(
 		*eventDistributor, *globalCliComm, *this);
 	globalSettings = make_unique<GlobalSettings>(
@@ -230,6 +242,8 @@ void Reactor::init()
 		*globalCommandController, *this);
 	restoreMachineCommand = make_unique<RestoreMachineCommand>(
 		*globalCommandController, *this);
+	cloneMachineCommand = make_unique<CloneMachineCommand>(
+		*globalCommandController, *this);
 	aviRecordCommand = make_unique<AviRecorder>(*this);
 	extensionInfo = make_unique<ConfigInfo>(
 		getOpenMSXInfoCommand(), "extensions");
@@ -992,6 +1006,89 @@ void RestoreMachineCommand::tabCompletion(vector<string>& tokens) const
 }
 
 
+// class CloneMachineCommand
+
+CloneMachineCommand::CloneMachineCommand(
+	CommandController& commandController_, Reactor& reactor_)
+	: Command(commandController_, "clone_machine")
+	, reactor(reactor_)
+{
+}
+
+void CloneMachineCommand::execute(array_ref<TclObject> tokens,
+                                  TclObject& result)
+{
+	string machineID;
+	int count = 1;
+	switch (tokens.size()) {
+	case 1:
+		machineID = reactor.getMachineID();
+		break;
+	case 2:
+		machineID = tokens[1].getString().str();
+		break;
+	case 3:
+		machineID = tokens[1].getString().str();
+		count = tokens[2].getInt(getInterpreter());
+		if (count < 1) {
+			throw CommandException("Count must be at least 1.");
+		}
+		break;
+	default:
+		throw SyntaxError();
+	}
+	auto& board = reactor.getMachine(machineID);
+
+	// Take an in-memory snapshot of the template machine (like a reverse
+	// snapshot, but including all state). This avoids parsing the
+	// hardware config files again and locating all ROM files. Large
+	// blocks (e.g. RAM) are stored as delta-blocks, those are shared by
+	// all clones. ROM content is shared via the cache in Rom.
+	LastDeltaBlocks lastDeltaBlocks;
+	vector<std::shared_ptr<DeltaBlock>> deltaBlocks;
+	MemOutputArchive out(lastDeltaBlocks, deltaBlocks, false);
+	out.serialize("machine", board);
+	size_t size;
+	auto snapshot = out.releaseBuffer(size);
+
+	// First create all clones, only make them visible when all succeeded.
+	Reactor::Boards newBoards;
+	for (int i = 0; i < count; ++i) {
+		auto newBoard = reactor.createEmptyMotherBoard();
+		try {
+			MemInputArchive in(snapshot.data(), size, deltaBlocks);
+			in.serialize("machine", *newBoard);
+		} catch (MSXException& e) {
+			throw CommandException("Cannot clone machine: " + e.getMessage());
+		}
+		// See RestoreMachineCommand.
+		newBoard->getStateChangeDistributor().stopReplay(newBoard->getCurrentTime());
+		newBoards.push_back(move(newBoard));
+	}
+	for (auto& b : newBoards) {
+		result.addListElement(b->getMachineID());
+		reactor.boards.push_back(move(b));
+	}
+}
+
+string CloneMachineCommand::help(const vector<string>& /*tokens*/) const
+{
+	return
+		"clone_machine                       Create a copy of the current machine\n"
+		"clone_machine <machineID>           Create a copy of the indicated machine\n"
+		"clone_machine <machineID> <count>   Create <count> copies of the indicated machine\n"
+		"\n"
+		"Returns the machineIDs of the new machines. The copies start in the exact\n"
+		"same state as the original machine. This is much faster than creating a\n"
+		"new machine from its configuration files.";
+}
+
+void CloneMachineCommand::tabCompletion(vector<string>& tokens) const
+{
+	completeString(tokens, reactor.getMachineIDs());
+}
+
+
 // class ConfigInfo
 
 ConfigInfo::ConfigInfo(InfoCommand& openMSXInfoCommand,
@@ -6,6 +6,9 @@
 #include "Debugger.hh"
 #include "EventDelay.hh"
 #include "MSXMixer.hh"
+#include "MSXCPU.hh"
+#include "PluggingController.hh"
+#include "RealTime.hh"
 #include "MSXCommandController.hh"
 #include "XMLException.hh"
 #include "TclObject.hh"
@@ -410,6 +413,14 @@ void ReverseManager::goTo(
 		    ((snapshotTime <= currentTime) ||
 		     ((preTarget - currentTime) < EmuDuration(1.0)))) {
 			newBoard = &motherBoard; // use current board
+		} else if (sameTimeLine &&
+		           (chunk.configGeneration == motherBoard.getConfigGeneration())) {
+			// The hardware configuration didn't change since the
+			// snapshot was taken, so instead of constructing a
+			// new machine, let the existing devices load their
+			// state from the snapshot. This is a lot faster.
+			newBoard = &motherBoard;
+			restoreInPlace(chunk);
 		} else {
 			// Note: we don't (anymore) erase future snapshots
 			// -- restore old snapshot --
@@ -419,6 +430,7 @@ void ReverseManager::goTo(
 					   chunk.size,
 					   chunk.deltaBlocks);
 			in.serialize("machine", *newBoard);
+			newBoard->setConfigGeneration(chunk.configGeneration);
 
 			if (eventDelay) {
 				// Handle all events that are scheduled, but not yet
@@ -773,6 +785,7 @@ void ReverseManager::loadReplay(
 		                     newChunk.deltaBlocks, false);
 		out.serialize("machine", *m);
 		newChunk.savestate = out.releaseBuffer(newChunk.size);
+		newChunk.configGeneration = m->getConfigGeneration();
 
 		// update replayIdx
 		// TODO: should we use <= instead??
@@ -807,13 +820,64 @@ void ReverseManager::transferHistory(ReverseHistory& oldHistory,
 	// actual history transfer
 	history.swap(oldHistory);
 
+	resumeCollecting(oldEventCount);
+}
+
+void ReverseManager::restoreInPlace(ReverseChunk& chunk)
+{
+	assert(isCollecting());
+
+	// See comments in goTo().
+	if (eventDelay) eventDelay->flush();
+	if (history.events.empty() ||
+	    !dynamic_cast<const EndLogEvent*>(history.events.back().get())) {
+		history.events.push_back(
+			std::make_shared<EndLogEvent>(getCurrentTime()));
+	}
+
+	// Like stop(), but keep the history.
+	motherBoard.getStateChangeDistributor().unregisterRecorder(*this);
+	syncNewSnapshot.removeSyncPoint();
+	syncInputEvent .removeSyncPoint();
+	collecting = false;
+	pendingTakeSnapshot = false;
+
+	// The CPU may have cached the time till the next syncpoint, that
+	// becomes invalid when time goes backwards.
+	motherBoard.exitCPULoopSync();
+
+	// The loader re-plugs the pluggables that were plugged in when the
+	// snapshot was taken, like it does in a new machine. Unplug them
+	// first, so they don't e.g. register their listeners twice.
+	motherBoard.getPluggingController().unplugAll(getCurrentTime());
+
+	MemInputArchive in(chunk.savestate.data(), chunk.size,
+	                   chunk.deltaBlocks, true);
+	in.serialize("machine", motherBoard);
+
+	// Parts that are not stored in the snapshot still have timing state
+	// of the abandoned time-line (a new machine starts fresh).
+	motherBoard.getRealTime().resync();
+	if (eventDelay) eventDelay->resync();
+	// The cached memory pages may refer to the mapper/slot configuration
+	// before the restore.
+	motherBoard.getCPU().invalidateMemCache(0x0000, 0x10000);
+
+	// the deltas in the next snapshot must be relative to this state
+	history.lastDeltaBlocks.clear();
+
+	resumeCollecting(chunk.eventCount);
+}
+
+void ReverseManager::resumeCollecting(unsigned eventCount)
+{
 	// resume collecting (and event recording)
 	collecting = true;
 	schedule(getCurrentTime());
 	motherBoard.getStateChangeDistributor().registerRecorder(*this);
 
 	// start replaying events
-	replayIndex = oldEventCount;
+	replayIndex = eventCount;
 	// replay log contains at least the EndLogEvent
 	assert(replayIndex < history.events.size());
 	replayNextEvent();
@@ -917,6 +981,7 @@ void ReverseManager::takeSnapshot(EmuTime::param time)
 	newChunk.time = time;
 	newChunk.savestate = out.releaseBuffer(newChunk.size);
 	newChunk.eventCount = replayIndex;
+	newChunk.configGeneration = motherBoard.getConfigGeneration();
 }
 
 void ReverseManager::replayNextEvent()
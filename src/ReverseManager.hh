@@ -52,7 +52,7 @@ public:
 
 private:
 	struct ReverseChunk {
-		ReverseChunk() : time(EmuTime::zero) {}
+		ReverseChunk() : time(EmuTime::zero), configGeneration(0) {}
 
 		EmuTime time;
 		std::vector<std::shared_ptr<DeltaBlock>> deltaBlocks;
@@ -63,6 +63,10 @@ private:
 		// snapshot was created. So when going back replay should
 		// start at this index.
 		unsigned eventCount;
+
+		// MSXMotherBoard::getConfigGeneration() at the time this
+		// snapshot was created.
+		unsigned configGeneration;
 	};
 	using Chunks = std::map<unsigned, ReverseChunk>;
 	using Events = std::vector<std::shared_ptr<StateChange>>;
@@ -97,6 +101,8 @@ private:
 	          ReverseHistory& history, bool sameTimeLine);
 	void transferHistory(ReverseHistory& oldHistory,
 	                     unsigned oldEventCount);
+	void restoreInPlace(ReverseChunk& chunk);
+	void resumeCollecting(unsigned eventCount);
 	void transferState(MSXMotherBoard& newBoard);
 	void takeSnapshot(EmuTime::param time);
 	void schedule(EmuTime::param time);
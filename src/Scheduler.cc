@@ -134,9 +134,24 @@ INSTANTIATE_SERIALIZE_METHODS(SynchronizationPoint);
 template <typename Archive>
 void Scheduler::serialize(Archive& ar, unsigned /*version*/)
 {
+	EmuTime oldTime = scheduleTime;
 	ar.serialize("currentTime", scheduleTime);
 	// don't serialize 'queue', each Schedulable serializes its own
 	// syncpoints
+	if (ar.isInPlaceRestore()) {
+		// The Schedulables that are part of the snapshot will restore
+		// their own syncpoints. The others (e.g. RealTime, 'after
+		// time' commands) are not part of the machine state, move
+		// their syncpoints along with the time jump so that they
+		// keep the same distance to the current time. This doesn't
+		// change the order of the queue.
+		for (auto& sp : queue) {
+			auto delta = (sp.getTime() > oldTime)
+			           ? (sp.getTime() - oldTime)
+			           : EmuDuration::zero;
+			sp.setTime(scheduleTime + delta);
+		}
+	}
 }
 INSTANTIATE_SERIALIZE_METHODS(Scheduler);
 
@@ -382,7 +382,8 @@ void CassettePlayer::rewind(EmuTime::param time)
 void CassettePlayer::recordTape(const Filename& filename, EmuTime::param time)
 {
 	removeTape(time); // flush (possible) previous recording
-	recordImage = make_unique<Wav8Writer>(filename, 1, RECORD_FREQ);
+	recordImage = make_unique<Wav8Writer>(
+		motherBoard.getMSXCliComm(), filename, 1, RECORD_FREQ);
 	tapePos = EmuTime::zero;
 	setState(RECORD, filename, time);
 }
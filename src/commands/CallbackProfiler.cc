@@ -0,0 +1,62 @@
+#include "CallbackProfiler.hh"
+#include <algorithm>
+#include <vector>
+#include <cstdio>
+
+using std::string;
+
+namespace openmsx {
+
+static const char* const kindNames[CallbackProfiler::NUM_KINDS] = {
+	"after", "breakpoint", "condition", "callback"
+};
+
+void CallbackProfiler::record(Kind kind, const string& name, uint64_t duration)
+{
+	auto& s = stats[kind][name];
+	++s.calls;
+	s.total += duration;
+	s.max = std::max(s.max, duration);
+}
+
+void CallbackProfiler::clear()
+{
+	for (auto& s : stats) s.clear();
+}
+
+string CallbackProfiler::report(unsigned num) const
+{
+	struct Entry {
+		const string* name;
+		const Stats* stats;
+		int kind;
+	};
+	std::vector<Entry> entries;
+	for (int k = 0; k < NUM_KINDS; ++k) {
+		for (auto& s : stats[k]) {
+			entries.push_back({&s.first, &s.second, k});
+		}
+	}
+	std::sort(begin(entries), end(entries),
+		[](const Entry& a, const Entry& b) {
+			return a.stats->total > b.stats->total; });
+	if (entries.size() > num) entries.resize(num);
+
+	string result = "  total(ms)     calls  avg(us)  max(us)  kind        command\n";
+	for (auto& e : entries) {
+		char buf[80];
+		snprintf(buf, sizeof(buf), "%11.3f  %8llu  %7llu  %7llu  %-10s  ",
+		         e.stats->total / 1000.0,
+		         static_cast<unsigned long long>(e.stats->calls),
+		         static_cast<unsigned long long>(e.stats->total / e.stats->calls),
+		         static_cast<unsigned long long>(e.stats->max),
+		         kindNames[e.kind]);
+		result += buf;
+		// only the first line of (multi-line) scripts
+		result.append(*e.name, 0, e.name->find('\n'));
+		result += '\n';
+	}
+	return result;
+}
+
+} // namespace openmsx
@@ -0,0 +1,87 @@
+#ifndef CALLBACKPROFILER_HH
+#define CALLBACKPROFILER_HH
+
+#include "TclObject.hh"
+#include "Timer.hh"
+#include "hash_map.hh"
+#include "string_ref.hh"
+#include "xxhash.hh"
+#include <string>
+#include <cstdint>
+
+namespace openmsx {
+
+/** Measures the time spent in Tcl callbacks: 'after' commands, the
+ * commands and (not natively evaluated) conditions of breakpoints,
+ * watchpoints and debug conditions, and callback settings (like
+ * 'di_halt_callback'). The results are shown with 'callback_profile'.
+ *
+ * When not active, the only overhead is testing the isActive() flag.
+ */
+class CallbackProfiler
+{
+public:
+	enum Kind { AFTER, BREAKPOINT, CONDITION, CALLBACK, NUM_KINDS };
+
+	CallbackProfiler() : active(false) {}
+
+	bool isActive() const { return active; }
+	void setActive(bool active_) { active = active_; }
+	void clear();
+
+	/** Returns a table with the 'num' callbacks that took the most time.
+	  */
+	std::string report(unsigned num) const;
+
+	/** Measures the time between construction and destruction. */
+	class Scope
+	{
+	public:
+		Scope(CallbackProfiler& profiler_, Kind kind_, const TclObject& name_)
+			: profiler(profiler_.isActive() ? &profiler_ : nullptr)
+			, kind(kind_)
+		{
+			if (profiler) begin(name_.getString());
+		}
+		Scope(CallbackProfiler& profiler_, Kind kind_, string_ref name_)
+			: profiler(profiler_.isActive() ? &profiler_ : nullptr)
+			, kind(kind_)
+		{
+			if (profiler) begin(name_);
+		}
+		~Scope()
+		{
+			if (profiler) {
+				profiler->record(kind, name, Timer::getTime() - start);
+			}
+		}
+	private:
+		void begin(string_ref name_)
+		{
+			// copy the name, the callback could delete it
+			name = name_.str();
+			start = Timer::getTime();
+		}
+
+		CallbackProfiler* profiler; // nullptr when not measuring
+		Kind kind;
+		std::string name;
+		uint64_t start;
+	};
+
+private:
+	struct Stats {
+		Stats() : calls(0), total(0), max(0) {}
+		uint64_t calls;
+		uint64_t total; // us
+		uint64_t max;   // us
+	};
+	void record(Kind kind, const std::string& name, uint64_t duration);
+
+	hash_map<std::string, Stats, XXHasher> stats[NUM_KINDS];
+	bool active;
+};
+
+} // namespace openmsx
+
+#endif
@@ -17,6 +17,7 @@
 #include "memory.hh"
 #include "outer.hh"
 #include "xrange.hh"
+#include <algorithm>
 #include <cassert>
 
 using std::string;
@@ -37,6 +38,7 @@ GlobalCommandController::GlobalCommandController(
 	, helpCmd(*this)
 	, tabCompletionCmd(*this)
 	, updateCmd(*this)
+	, callbackProfileCmd(*this)
 	, platformInfo(getOpenMSXInfoCommand())
 	, versionInfo (getOpenMSXInfoCommand())
 	, romInfoTopic(getOpenMSXInfoCommand())
@@ -568,6 +570,13 @@ CliConnection& GlobalCommandController::UpdateCmd::getConnection()
 void GlobalCommandController::UpdateCmd::execute(
 	array_ref<TclObject> tokens, TclObject& /*result*/)
 {
+	if (tokens.size() == 4) {
+		// enable <type> <pattern>
+		if (tokens[1] != "enable") throw SyntaxError();
+		getConnection().addUpdateFilter(
+			getType(tokens[2]), tokens[3].getString());
+		return;
+	}
 	if (tokens.size() != 3) {
 		throw SyntaxError();
 	}
@@ -582,7 +591,9 @@ void GlobalCommandController::UpdateCmd::execute(
 
 string GlobalCommandController::UpdateCmd::help(const vector<string>& /*tokens*/) const
 {
-	static const string helpText = "Enable or disable update events for external applications. See doc/openmsx-control-xml.txt.";
+	static const string helpText = "Enable or disable update events for external applications. See doc/openmsx-control-xml.txt.\n"
+		"  openmsx_update enable <type> [<pattern>]  enable updates (only for names matching the glob pattern)\n"
+		"  openmsx_update disable <type>             disable updates\n";
 	return helpText;
 }
 
@@ -601,6 +612,66 @@ void GlobalCommandController::UpdateCmd::tabCompletion(vector<string>& tokens) c
 }
 
 
+// class CallbackProfileCmd
+
+GlobalCommandController::CallbackProfileCmd::CallbackProfileCmd(
+		CommandController& commandController_)
+	: Command(commandController_, "callback_profile")
+{
+}
+
+void GlobalCommandController::CallbackProfileCmd::execute(
+	array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() < 2) {
+		throw SyntaxError();
+	}
+	auto& profiler = getInterpreter().getCallbackProfiler();
+	string_ref subCmd = tokens[1].getString();
+	if (subCmd == "start") {
+		if (tokens.size() != 2) throw SyntaxError();
+		profiler.setActive(true);
+	} else if (subCmd == "stop") {
+		if (tokens.size() != 2) throw SyntaxError();
+		profiler.setActive(false);
+	} else if (subCmd == "clear") {
+		if (tokens.size() != 2) throw SyntaxError();
+		profiler.clear();
+	} else if (subCmd == "report") {
+		// report [<count>]
+		if (tokens.size() > 3) throw SyntaxError();
+		int num = (tokens.size() == 3)
+		        ? tokens[2].getInt(getInterpreter()) : 20;
+		result.setString(profiler.report(std::max(num, 0)));
+	} else {
+		throw CommandException("Unknown subcommand: " + subCmd);
+	}
+}
+
+string GlobalCommandController::CallbackProfileCmd::help(
+	const vector<string>& /*tokens*/) const
+{
+	return "Measures the time spent in Tcl callbacks ('after' commands, "
+	       "breakpoint/watchpoint/condition commands and conditions, "
+	       "callback settings).\n"
+	       "  callback_profile start            start measuring\n"
+	       "  callback_profile stop             stop measuring, the results are kept\n"
+	       "  callback_profile clear            forget all results\n"
+	       "  callback_profile report [<count>] the <count> (default 20) callbacks that took the most time\n";
+}
+
+void GlobalCommandController::CallbackProfileCmd::tabCompletion(
+	vector<string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static const char* const subCmds[] = {
+			"start", "stop", "clear", "report"
+		};
+		completeString(tokens, subCmds);
+	}
+}
+
+
 // Platform info
 
 GlobalCommandController::PlatformInfo::PlatformInfo(InfoCommand& openMSXInfoCommand_)
@@ -136,6 +136,13 @@ private:
 		CliConnection& getConnection();
 	} updateCmd;
 
+	struct CallbackProfileCmd final : Command {
+		explicit CallbackProfileCmd(CommandController& commandController);
+		void execute(array_ref<TclObject> tokens, TclObject& result) override;
+		std::string help(const std::vector<std::string>& tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} callbackProfileCmd;
+
 	struct PlatformInfo final : InfoTopic {
 		explicit PlatformInfo(InfoCommand& openMSXInfoCommand);
 		void execute(array_ref<TclObject> tokens,
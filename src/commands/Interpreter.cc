@@ -111,6 +111,7 @@ Interpreter::~Interpreter()
 	// see comment in MSXCPUInterface::cleanup()
 	MSXCPUInterface::cleanup();
 
+	scriptCache.clear(); // releases bytecode, do this before deleting interp
 	if (!Tcl_InterpDeleted(interp)) {
 		Tcl_DeleteInterp(interp);
 	}
@@ -204,6 +205,24 @@ TclObject Interpreter::execute(const string& command)
 	return TclObject(Tcl_GetObjResult(interp));
 }
 
+TclObject Interpreter::executeCached(const TclObject& script)
+{
+	static const unsigned MAX_CACHED_SCRIPTS = 256;
+
+	string_ref str = script.getString();
+	auto it = scriptCache.find(str);
+	if (it == end(scriptCache)) {
+		if (scriptCache.size() == MAX_CACHED_SCRIPTS) {
+			scriptCache.clear();
+		}
+		it = scriptCache.emplace_noDuplicateCheck(str.str(), script);
+	}
+	// Copy, the script could (indirectly) clear the cache. Executing
+	// with 'compile' stores the bytecode in the (cached) object.
+	TclObject cached = it->second;
+	return cached.executeCommand(*this, true);
+}
+
 TclObject Interpreter::executeFile(const string& filename)
 {
 	int success = Tcl_EvalFile(interp, filename.c_str());
@@ -237,6 +256,16 @@ void Interpreter::setVariable(const TclObject& name, const TclObject& value)
 	}
 }
 
+TclObject Interpreter::getVariable(const TclObject& name)
+{
+	auto* value = Tcl_ObjGetVar2(interp, name.getTclObjectNonConst(), nullptr,
+	                             TCL_GLOBAL_ONLY | TCL_LEAVE_ERR_MSG);
+	if (!value) {
+		throw CommandException(Tcl_GetStringResult(interp));
+	}
+	return TclObject(value);
+}
+
 void Interpreter::unsetVariable(const char* name)
 {
 	Tcl_UnsetVar(interp, name, TCL_GLOBAL_ONLY);
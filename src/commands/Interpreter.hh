@@ -3,7 +3,11 @@
 
 #include "TclParser.hh"
 #include "TclObject.hh"
+#include "CallbackProfiler.hh"
+#include "hash_map.hh"
 #include "string_ref.hh"
+#include "xxhash.hh"
+#include <string>
 #include <vector>
 #include <tcl.h>
 
@@ -33,7 +37,21 @@ public:
 	TclObject execute(const std::string& command);
 	TclObject executeFile(const std::string& filename);
 
+	/** Execute a script that will likely be executed again later, e.g.
+	  * an 'after frame' command that re-registers itself. The compiled
+	  * form (bytecode) is cached (keyed on the text of the script), so
+	  * the script doesn't need to be parsed again the next time.
+	  * @throws CommandException when the script returns an error.
+	  */
+	TclObject executeCached(const TclObject& script);
+
+	CallbackProfiler& getCallbackProfiler() { return callbackProfiler; }
+
 	void setVariable(const TclObject& name, const TclObject& value);
+	/** Get the value of a global variable.
+	  * @throws CommandException if the variable doesn't exist.
+	  */
+	TclObject getVariable(const TclObject& name);
 	void unsetVariable(const char* name);
 	void registerSetting(BaseSetting& variable);
 	void unregisterSetting(BaseSetting& variable);
@@ -66,6 +84,11 @@ private:
 	Tcl_Interp* interp;
 	InterpreterOutput* output;
 
+	// Scripts executed via executeCached(). Entries are never removed
+	// individually, the whole cache is cleared when it gets full.
+	hash_map<std::string, TclObject, XXHasher> scriptCache;
+	CallbackProfiler callbackProfiler;
+
 	friend class TclObject;
 };
 
@@ -1,5 +1,6 @@
 #include "TclCallback.hh"
 #include "CommandController.hh"
+#include "Interpreter.hh"
 #include "CliComm.hh"
 #include "CommandException.hh"
 #include "StringSetting.hh"
@@ -96,8 +97,12 @@ TclObject TclCallback::execute(string_ref arg1, string_ref arg2)
 
 TclObject TclCallback::executeCommon(TclObject& command)
 {
+	auto& interp = callbackSetting.getInterpreter();
+	CallbackProfiler::Scope scope(interp.getCallbackProfiler(),
+	                              CallbackProfiler::CALLBACK,
+	                              getSetting().getFullNameObj());
 	try {
-		return command.executeCommand(callbackSetting.getInterpreter());
+		return command.executeCommand(interp);
 	} catch (CommandException& e) {
 		string message =
 			"Error executing callback function \"" +
@@ -116,6 +116,16 @@ int TclObject::getInt(Interpreter& interp_) const
 	return result;
 }
 
+int64_t TclObject::getInt64(Interpreter& interp_) const
+{
+	auto* interp = interp_.interp;
+	Tcl_WideInt result;
+	if (Tcl_GetWideIntFromObj(interp, obj, &result) != TCL_OK) {
+		throwException(interp);
+	}
+	return result;
+}
+
 bool TclObject::getBoolean(Interpreter& interp_) const
 {
 	auto* interp = interp_.interp;
@@ -149,6 +159,12 @@ const byte* TclObject::getBinary(unsigned& length) const
 		obj, reinterpret_cast<int*>(&length)));
 }
 
+bool TclObject::isBinary() const
+{
+	static const Tcl_ObjType* byteArrayType = Tcl_GetObjType("bytearray");
+	return obj->typePtr == byteArrayType;
+}
+
 unsigned TclObject::getListLength(Interpreter& interp_) const
 {
 	auto* interp = interp_.interp;
@@ -7,6 +7,7 @@
 #include <tcl.h>
 #include <iterator>
 #include <cassert>
+#include <cstdint>
 
 struct Tcl_Obj;
 
@@ -99,9 +100,15 @@ public:
 	// value getters
 	string_ref getString() const;
 	int getInt      (Interpreter& interp) const;
+	/** Like getInt(), but for the full 64-bit range (getInt() wraps
+	  * e.g. 0xFFFFFFFF to -1). */
+	int64_t getInt64(Interpreter& interp) const;
 	bool getBoolean (Interpreter& interp) const;
 	double getDouble(Interpreter& interp) const;
 	const byte* getBinary(unsigned& length) const;
+	/** Is the value stored as a byte array (e.g. set via setBinary())?
+	  * For such values getBinary() doesn't need a conversion. */
+	bool isBinary() const;
 	unsigned getListLength(Interpreter& interp) const;
 	TclObject getListIndex(Interpreter& interp, unsigned index) const;
 	TclObject getDictValue(Interpreter& interp, const TclObject& key) const;
@@ -398,21 +398,31 @@ void HardwareConfig::serialize(Archive& ar, unsigned version)
 	if (ar.versionBelow(version, 2)) {
 		XMLElement::getLastSerializedFileContext(); // clear any previous value
 	}
-	ar.serialize("config", config); // fills in getLastSerializedFileContext()
-	if (ar.versionAtLeast(version, 2)) {
-		if (ar.versionAtLeast(version, 4)) {
-			ar.serialize("context", context);
+	if (ar.isInPlaceRestore()) {
+		// Devices keep pointers into 'config', so it must not be
+		// replaced. The caller already checked the configuration
+		// didn't change since the snapshot was taken.
+		XMLElement tmpConfig;
+		ar.serialize("config", tmpConfig);
+		FileContext tmpContext;
+		ar.serialize("context", tmpContext);
+	} else {
+		ar.serialize("config", config); // fills in getLastSerializedFileContext()
+		if (ar.versionAtLeast(version, 2)) {
+			if (ar.versionAtLeast(version, 4)) {
+				ar.serialize("context", context);
+			} else {
+				std::unique_ptr<FileContext> ctxt;
+				ar.serialize("context", ctxt);
+				if (ctxt) context = *ctxt;
+			}
 		} else {
-			std::unique_ptr<FileContext> ctxt;
-			ar.serialize("context", ctxt);
-			if (ctxt) context = *ctxt;
+			auto ctxt = XMLElement::getLastSerializedFileContext();
+			assert(ctxt);
+			context = *ctxt;
 		}
-	} else {
-		auto ctxt = XMLElement::getLastSerializedFileContext();
-		assert(ctxt);
-		context = *ctxt;
 	}
-	if (ar.isLoader()) {
+	if (ar.isLoader() && !ar.isInPlaceRestore()) {
 		if (!motherBoard.getMachineConfig()) {
 			// must be done before parseSlots()
 			motherBoard.setMachineConfig(this);
@@ -430,4 +440,19 @@ void HardwareConfig::serialize(Archive& ar, unsigned version)
 }
 INSTANTIATE_SERIALIZE_METHODS(HardwareConfig);
 
+void HardwareConfig::restoreInPlace(MemInputArchive& ar)
+{
+	// This must match the layout that's used for (non-polymorphic)
+	// pointers: id, constructor arguments, content.
+	unsigned id;
+	ar.attribute("id", id);
+	std::string tmpHwName;
+	ar.serialize("hwname", tmpHwName);
+	if (tmpHwName != hwName) {
+		throw MSXException("Snapshot has a different hardware configuration.");
+	}
+	ar.addPointer(id, this);
+	serialize(ar, SerializeClassVersion<HardwareConfig>::value);
+}
+
 } // namespace openmsx
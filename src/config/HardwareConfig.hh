@@ -16,6 +16,7 @@ namespace openmsx {
 class MSXMotherBoard;
 class MSXDevice;
 class TclObject;
+class MemInputArchive;
 
 class HardwareConfig
 {
@@ -55,6 +56,12 @@ public:
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
+	/** Load the state that was stored via a pointer to a HardwareConfig
+	 * (see MSXMotherBoard::serialize()) into this existing object.
+	 * Only valid if the snapshot has the exact same configuration.
+	 */
+	void restoreInPlace(MemInputArchive& ar);
+
 private:
 	static std::string getFilename(string_ref type, string_ref name);
 	static XMLElement loadConfig(const std::string& filename);
@@ -1,5 +1,7 @@
 #include "BreakPointBase.hh"
+#include "CompiledCondition.hh"
 #include "CommandException.hh"
+#include "Interpreter.hh"
 #include "GlobalCliComm.hh"
 #include "ScopedAssign.hh"
 
@@ -7,16 +9,26 @@ namespace openmsx {
 
 BreakPointBase::BreakPointBase(TclObject command_, TclObject condition_)
 	: command(std::move(command_)), condition(std::move(condition_))
+	, compiled(CompiledCondition::compile(condition.getString()))
 	, executing(false)
 {
 }
 
-bool BreakPointBase::isTrue(GlobalCliComm& cliComm, Interpreter& interp) const
+bool BreakPointBase::isTrue(GlobalCliComm& cliComm, Interpreter& interp,
+                            MSXMotherBoard& motherBoard) const
 {
 	if (condition.getString().empty()) {
 		// unconditional bp
 		return true;
 	}
+	bool result;
+	if (compiled && compiled->evaluate(motherBoard, interp, result)) {
+		return result;
+	}
+	// Not compiled or it couldn't be evaluated natively (e.g. an error),
+	// let Tcl handle it.
+	CallbackProfiler::Scope scope(interp.getCallbackProfiler(),
+	                              CallbackProfiler::CONDITION, condition);
 	try {
 		return condition.evalBool(interp);
 	} catch (CommandException& e) {
@@ -25,14 +37,25 @@ bool BreakPointBase::isTrue(GlobalCliComm& cliComm, Interpreter& interp) const
 	}
 }
 
-void BreakPointBase::checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp)
+bool BreakPointBase::mightTrigger(Interpreter& interp,
+                                  MSXMotherBoard& motherBoard) const
+{
+	bool result;
+	return !compiled ||
+	       !compiled->evaluate(motherBoard, interp, result) || result;
+}
+
+void BreakPointBase::checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp,
+                                     MSXMotherBoard& motherBoard)
 {
 	if (executing) {
 		// no recursive execution
 		return;
 	}
 	ScopedAssign<bool> sa(executing, true);
-	if (isTrue(cliComm, interp)) {
+	if (isTrue(cliComm, interp, motherBoard)) {
+		CallbackProfiler::Scope scope(interp.getCallbackProfiler(),
+		                              CallbackProfiler::BREAKPOINT, command);
 		try {
 			command.executeCommand(interp, true); // compile command
 		} catch (CommandException& e) {
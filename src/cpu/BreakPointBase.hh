@@ -3,11 +3,14 @@
 
 #include "TclObject.hh"
 #include "string_ref.hh"
+#include <memory>
 
 namespace openmsx {
 
 class Interpreter;
 class GlobalCliComm;
+class MSXMotherBoard;
+class CompiledCondition;
 
 /** Base class for CPU break and watch points.
  */
@@ -19,7 +22,14 @@ public:
 	TclObject getConditionObj() const { return condition; }
 	TclObject getCommandObj()   const { return command; }
 
-	void checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp);
+	void checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp,
+	                     MSXMotherBoard& motherBoard);
+
+	/** Quick check that doesn't have side effects. Returns false only
+	  * when the condition is (natively) known to be false, in that case
+	  * checkAndExecute() won't execute the command.
+	  */
+	bool mightTrigger(Interpreter& interp, MSXMotherBoard& motherBoard) const;
 
 protected:
 	// Note: we require GlobalCliComm here because breakpoint objects can
@@ -28,10 +38,14 @@ protected:
 	BreakPointBase(TclObject command, TclObject condition);
 
 private:
-	bool isTrue(GlobalCliComm& cliComm, Interpreter& interp) const;
+	bool isTrue(GlobalCliComm& cliComm, Interpreter& interp,
+	            MSXMotherBoard& motherBoard) const;
 
 	TclObject command;
 	TclObject condition;
+	// Native version of 'condition', nullptr if it couldn't be compiled.
+	// Shared because breakpoint objects get copied.
+	std::shared_ptr<const CompiledCondition> compiled;
 	bool executing;
 };
 
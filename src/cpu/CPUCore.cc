@@ -159,6 +159,9 @@
 // instructions too late.
 
 #include "CPUCore.hh"
+#include "CPUTrace.hh"
+#include "CPUProfiler.hh"
+#include "MemoryCoverage.hh"
 #include "MSXCPUInterface.hh"
 #include "Scheduler.hh"
 #include "MSXMotherBoard.hh"
@@ -294,7 +297,8 @@ static void initTables()
 
 template<class T> CPUCore<T>::CPUCore(
 		MSXMotherBoard& motherboard_, const string& name,
-		const BooleanSetting& traceSetting_,
+		const BooleanSetting& traceSetting_, CPUTrace& trace_,
+		CPUProfiler& profiler_, MemoryCoverage& coverage_,
 		TclCallback& diHaltCallback_, EmuTime::param time)
 	: CPURegs(T::isR800())
 	, T(time, motherboard_.getScheduler())
@@ -302,6 +306,9 @@ template<class T> CPUCore<T>::CPUCore(
 	, scheduler(motherboard.getScheduler())
 	, interface(nullptr)
 	, traceSetting(traceSetting_)
+	, trace(trace_)
+	, profiler(profiler_)
+	, coverage(coverage_)
 	, diHaltCallback(diHaltCallback_)
 	, IRQStatus(motherboard.getDebugger(), name + ".pendingIRQ",
 	            "Non-zero if there are pending IRQs (thus CPU would enter "
@@ -323,7 +330,9 @@ template<class T> CPUCore<T>::CPUCore(
 	, NMIStatus(0)
 	, nmiEdge(false)
 	, exitLoop(false)
-	, tracingEnabled(traceSetting.getBoolean())
+	, tracingEnabled(traceSetting.getBoolean() || trace.isRecording() ||
+	                 coverage.getSetting().getBoolean())
+	, textTracing(traceSetting.getBoolean())
 	, isTurboR(motherboard.isTurboR())
 {
 	static_assert(!std::is_polymorphic<CPUCore<T>>::value,
@@ -353,6 +362,8 @@ template<class T> void CPUCore<T>::invalidateMemCache(unsigned start, unsigned s
 	memset(&writeCacheLine [first], 0, num * sizeof(byte*)); //
 	memset(&readCacheTried [first], 0, num * sizeof(bool));  // FALSE
 	memset(&writeCacheTried[first], 0, num * sizeof(bool));  //
+	memset(&readWatchLine  [first], 0, num * sizeof(byte*)); // nullptr
+	memset(&writeWatchLine [first], 0, num * sizeof(byte*)); //
 }
 
 template<class T> void CPUCore<T>::doReset(EmuTime::param time)
@@ -559,8 +570,13 @@ template<class T> void CPUCore<T>::update(const Setting& setting)
 		doSetFreq();
 	} else if (&setting == &freqValue) {
 		doSetFreq();
-	} else if (&setting == &traceSetting) {
-		tracingEnabled = traceSetting.getBoolean();
+	} else if ((&setting == &traceSetting) ||
+	           (&setting == &trace.getRecordSetting()) ||
+	           (&setting == &coverage.getSetting())) {
+		textTracing = traceSetting.getBoolean();
+		tracingEnabled = textTracing ||
+		                 trace.getRecordSetting().getBoolean() ||
+		                 coverage.getSetting().getBoolean();
 	}
 }
 
@@ -599,7 +615,7 @@ template<class T> inline void CPUCore<T>::WRITE_PORT(unsigned port, byte value,
 	// note: no forced page-break after IO
 }
 
-template<class T> template<bool PRE_PB, bool POST_PB>
+template<class T> template<bool PRE_PB, bool POST_PB, bool FETCH>
 NEVER_INLINE byte CPUCore<T>::RDMEMslow(unsigned address, unsigned cc)
 {
 	// not cached
@@ -614,17 +630,31 @@ NEVER_INLINE byte CPUCore<T>::RDMEMslow(unsigned address, unsigned cc)
 			readCacheLine[high] = line - addrBase;
 			return readCacheLine[high][address];
 		}
+		if (const byte* line = interface->getReadWatchCacheLine(addrBase)) {
+			readWatchLine[high] = line - addrBase;
+		}
 	}
 	// uncacheable
 	readCacheTried[high] = true;
+	const byte* watchLine = readWatchLine[high];
+	if (watchLine && !interface->isReadWatched(address)) {
+		// in a line with a watchpoint, but not on a watched address
+		T::template PRE_MEM<PRE_PB, POST_PB>(address);
+		T::template POST_MEM<       POST_PB>(address);
+		return watchLine[address];
+	}
 	T::template PRE_MEM<PRE_PB, POST_PB>(address);
+	if (unlikely(coverage.isActive())) {
+		coverage.access(address, FETCH ? MemoryCoverage::EXECUTED
+		                               : MemoryCoverage::READ);
+	}
 	EmuTime time = T::getTimeFast(cc);
 	scheduler.schedule(time);
 	byte result = interface->readMem(address, time);
 	T::template POST_MEM<POST_PB>(address);
 	return result;
 }
-template<class T> template<bool PRE_PB, bool POST_PB>
+template<class T> template<bool PRE_PB, bool POST_PB, bool FETCH>
 ALWAYS_INLINE byte CPUCore<T>::RDMEM_impl2(unsigned address, unsigned cc)
 {
 	const byte* line = readCacheLine[address >> CacheLine::BITS];
@@ -634,15 +664,15 @@ ALWAYS_INLINE byte CPUCore<T>::RDMEM_impl2(unsigned address, unsigned cc)
 		T::template POST_MEM<       POST_PB>(address);
 		return line[address];
 	} else {
-		return RDMEMslow<PRE_PB, POST_PB>(address, cc); // not inlined
+		return RDMEMslow<PRE_PB, POST_PB, FETCH>(address, cc); // not inlined
 	}
 }
-template<class T> template<bool PRE_PB, bool POST_PB>
+template<class T> template<bool PRE_PB, bool POST_PB, bool FETCH>
 ALWAYS_INLINE byte CPUCore<T>::RDMEM_impl(unsigned address, unsigned cc)
 {
 	static const bool PRE  = T::template Normalize<PRE_PB >::value;
 	static const bool POST = T::template Normalize<POST_PB>::value;
-	return RDMEM_impl2<PRE, POST>(address, cc);
+	return RDMEM_impl2<PRE, POST, FETCH>(address, cc);
 }
 template<class T> template<unsigned PC_OFFSET> ALWAYS_INLINE byte CPUCore<T>::RDMEM_OPCODE(unsigned cc)
 {
@@ -656,21 +686,21 @@ template<class T> template<unsigned PC_OFFSET> ALWAYS_INLINE byte CPUCore<T>::RD
 	// faster to only update PC once per instruction instead of after each
 	// fetch.
 	unsigned address = (getPC() + PC_OFFSET) & 0xFFFF;
-	return RDMEM_impl<false, false>(address, cc);
+	return RDMEM_impl<false, false, true>(address, cc);
 }
 template<class T> ALWAYS_INLINE byte CPUCore<T>::RDMEM(unsigned address, unsigned cc)
 {
 	return RDMEM_impl<true, true>(address, cc);
 }
 
-template<class T> template<bool PRE_PB, bool POST_PB>
+template<class T> template<bool PRE_PB, bool POST_PB, bool FETCH>
 NEVER_INLINE unsigned CPUCore<T>::RD_WORD_slow(unsigned address, unsigned cc)
 {
-	unsigned res = RDMEM_impl<PRE_PB,  false>(address, cc);
-	res         += RDMEM_impl<false, POST_PB>((address + 1) & 0xFFFF, cc + T::CC_RDMEM) << 8;
+	unsigned res = RDMEM_impl<PRE_PB,  false, FETCH>(address, cc);
+	res         += RDMEM_impl<false, POST_PB, FETCH>((address + 1) & 0xFFFF, cc + T::CC_RDMEM) << 8;
 	return res;
 }
-template<class T> template<bool PRE_PB, bool POST_PB>
+template<class T> template<bool PRE_PB, bool POST_PB, bool FETCH>
 ALWAYS_INLINE unsigned CPUCore<T>::RD_WORD_impl2(unsigned address, unsigned cc)
 {
 	const byte* line = readCacheLine[address >> CacheLine::BITS];
@@ -681,20 +711,20 @@ ALWAYS_INLINE unsigned CPUCore<T>::RD_WORD_impl2(unsigned address, unsigned cc)
 		return Endian::read_UA_L16(&line[address]);
 	} else {
 		// slow path, not inline
-		return RD_WORD_slow<PRE_PB, POST_PB>(address, cc);
+		return RD_WORD_slow<PRE_PB, POST_PB, FETCH>(address, cc);
 	}
 }
-template<class T> template<bool PRE_PB, bool POST_PB>
+template<class T> template<bool PRE_PB, bool POST_PB, bool FETCH>
 ALWAYS_INLINE unsigned CPUCore<T>::RD_WORD_impl(unsigned address, unsigned cc)
 {
 	static const bool PRE  = T::template Normalize<PRE_PB >::value;
 	static const bool POST = T::template Normalize<POST_PB>::value;
-	return RD_WORD_impl2<PRE, POST>(address, cc);
+	return RD_WORD_impl2<PRE, POST, FETCH>(address, cc);
 }
 template<class T> template<unsigned PC_OFFSET> ALWAYS_INLINE unsigned CPUCore<T>::RD_WORD_PC(unsigned cc)
 {
 	unsigned addr = (getPC() + PC_OFFSET) & 0xFFFF;
-	return RD_WORD_impl<false, false>(addr, cc);
+	return RD_WORD_impl<false, false, true>(addr, cc);
 }
 template<class T> ALWAYS_INLINE unsigned CPUCore<T>::RD_WORD(
 	unsigned address, unsigned cc)
@@ -718,9 +748,20 @@ NEVER_INLINE void CPUCore<T>::WRMEMslow(unsigned address, byte value, unsigned c
 			writeCacheLine[high][address] = value;
 			return;
 		}
+		if (byte* line = interface->getWriteWatchCacheLine(addrBase)) {
+			writeWatchLine[high] = line - addrBase;
+		}
 	}
 	// uncacheable
 	writeCacheTried[high] = true;
+	byte* watchLine = writeWatchLine[high];
+	if (watchLine && !interface->isWriteWatched(address)) {
+		// in a line with a watchpoint, but not on a watched address
+		T::template PRE_MEM<PRE_PB, POST_PB>(address);
+		T::template POST_MEM<       POST_PB>(address);
+		watchLine[address] = value;
+		return;
+	}
 	T::template PRE_MEM<PRE_PB, POST_PB>(address);
 	EmuTime time = T::getTimeFast(cc);
 	scheduler.schedule(time);
@@ -816,6 +857,7 @@ template<class T> inline void CPUCore<T>::nmi()
 	setHALT(false);
 	setIFF1(false);
 	PUSH<T::EE_NMI_1>(getPC());
+	if (unlikely(profiler.isActive())) profiler.call(getPC(), 0x0066, getSP());
 	setPC(0x0066);
 	T::add(T::CC_NMI);
 }
@@ -831,6 +873,7 @@ template<class T> inline void CPUCore<T>::irq0()
 	setIFF1(false);
 	setIFF2(false);
 	PUSH<T::EE_IRQ0_1>(getPC());
+	if (unlikely(profiler.isActive())) profiler.call(getPC(), 0x0038, getSP());
 	setPC(0x0038);
 	T::setMemPtr(getPC());
 	T::add(T::CC_IRQ0);
@@ -844,6 +887,7 @@ template<class T> inline void CPUCore<T>::irq1()
 	setIFF1(false);
 	setIFF2(false);
 	PUSH<T::EE_IRQ1_1>(getPC());
+	if (unlikely(profiler.isActive())) profiler.call(getPC(), 0x0038, getSP());
 	setPC(0x0038);
 	T::setMemPtr(getPC());
 	T::add(T::CC_IRQ1);
@@ -858,7 +902,9 @@ template<class T> inline void CPUCore<T>::irq2()
 	setIFF2(false);
 	PUSH<T::EE_IRQ2_1>(getPC());
 	unsigned x = interface->readIRQVector() | (getI() << 8);
-	setPC(RD_WORD(x, T::CC_IRQ2_2));
+	unsigned addr = RD_WORD(x, T::CC_IRQ2_2);
+	if (unlikely(profiler.isActive())) profiler.call(getPC(), addr, getSP());
+	setPC(addr);
 	T::setMemPtr(getPC());
 	T::add(T::CC_IRQ2);
 }
@@ -984,7 +1030,7 @@ start:
 
 fetchSlow: {
 	unsigned address = getPC();
-	byte opcodeSlow = RDMEMslow<false, false>(address, T::CC_MAIN);
+	byte opcodeSlow = RDMEMslow<false, false, true>(address, T::CC_MAIN);
 	goto *(opcodeTable[opcodeSlow]);
 }
 #endif
@@ -2472,6 +2518,25 @@ template<class T> inline void CPUCore<T>::cpuTracePost()
 }
 template<class T> void CPUCore<T>::cpuTracePost_slow()
 {
+	if (trace.isRecording()) {
+		auto& r = trace.next();
+		r.time = (T::getTimeFast() - EmuTime::zero).length();
+		r.pc = start_pc;
+		r.af = getAF(); r.bc = getBC(); r.de = getDE(); r.hl = getHL();
+		r.ix = getIX(); r.iy = getIY(); r.sp = getSP();
+		for (unsigned i = 0; i < 4; ++i) {
+			r.opcode[i] = interface->peekMem(start_pc + i, T::getTimeFast());
+		}
+		r.primarySlots = r.secondarySlots = r.expanded = 0;
+		for (int i = 0; i < 4; ++i) { // page resp. primary slot
+			r.primarySlots   |= interface->getPrimarySlot  (i) << (2 * i);
+			r.secondarySlots |= interface->getSecondarySlot(i) << (2 * i);
+			if (interface->isExpanded(i)) r.expanded |= 1 << i;
+		}
+		r.flags = T::isR800() ? CPUTrace::FLAG_R800 : 0;
+	}
+	if (!textTracing) return;
+
 	byte opbuf[4];
 	string dasmOutput;
 	dasm(*interface, start_pc, opbuf, dasmOutput, T::getTimeFast());
@@ -3866,6 +3931,7 @@ template<class T> template<typename COND> II CPUCore<T>::call(COND cond) {
 	T::setMemPtr(addr);
 	if (cond(getF())) {
 		PUSH<T::EE_CALL>(getPC() + 3); /**/
+		if (unlikely(profiler.isActive())) profiler.call(getPC(), addr, getSP());
 		setPC(addr);
 		if (T::isR800()) {
 			setCurrentCall();
@@ -3881,6 +3947,7 @@ template<class T> template<typename COND> II CPUCore<T>::call(COND cond) {
 // RST n
 template<class T> template<unsigned ADDR> II CPUCore<T>::rst() {
 	PUSH<0>(getPC() + 1); /**/
+	if (unlikely(profiler.isActive())) profiler.call(getPC(), ADDR, getSP());
 	T::setMemPtr(ADDR);
 	setPC(ADDR);
 	if (T::isR800()) {
@@ -3894,6 +3961,7 @@ template<class T> template<unsigned ADDR> II CPUCore<T>::rst() {
 // RET
 template<class T> template<int EE, typename COND> inline II CPUCore<T>::RET(COND cond) {
 	if (cond(getF())) {
+		if (unlikely(profiler.isActive())) profiler.ret(getSP());
 		unsigned addr = POP<EE>();
 		T::setMemPtr(addr);
 		setPC(addr);
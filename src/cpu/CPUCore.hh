@@ -17,6 +17,9 @@
 namespace openmsx {
 
 class MSXCPUInterface;
+class CPUTrace;
+class CPUProfiler;
+class MemoryCoverage;
 class Scheduler;
 class MSXMotherBoard;
 class TclCallback;
@@ -45,7 +48,8 @@ class CPUCore final : public CPUBase, public CPURegs, public CPU_POLICY
 {
 public:
 	CPUCore(MSXMotherBoard& motherboard, const std::string& name,
-	        const BooleanSetting& traceSetting,
+	        const BooleanSetting& traceSetting, CPUTrace& trace,
+	        CPUProfiler& profiler, MemoryCoverage& coverage,
 	        TclCallback& diHaltCallback, EmuTime::param time);
 
 	void setInterface(MSXCPUInterface* interf) { interface = interf; }
@@ -127,12 +131,19 @@ private:
 	byte* writeCacheLine[CacheLine::NUM];
 	bool readCacheTried [CacheLine::NUM];
 	bool writeCacheTried[CacheLine::NUM];
+	// Cache lines that are not cached because they contain watched
+	// addresses. Only the unwatched addresses may be accessed via these.
+	const byte* readWatchLine[CacheLine::NUM];
+	byte* writeWatchLine[CacheLine::NUM];
 
 	MSXMotherBoard& motherboard;
 	Scheduler& scheduler;
 	MSXCPUInterface* interface;
 
 	const BooleanSetting& traceSetting;
+	CPUTrace& trace;
+	CPUProfiler& profiler;
+	MemoryCoverage& coverage;
 	TclCallback& diHaltCallback;
 
 	Probe<int> IRQStatus;
@@ -156,8 +167,11 @@ private:
 
 	std::atomic<bool> exitLoop;
 
-	/** In sync with traceSetting.getBoolean(). */
+	/** In sync with traceSetting.getBoolean() || trace.isRecording() ||
+	  * coverage.isActive(). */
 	bool tracingEnabled;
+	/** In sync with traceSetting.getBoolean(). */
+	bool textTracing;
 
 	/** 'normal' Z80 and Z80 in a turboR behave slightly different */
 	const bool isTurboR;
@@ -170,21 +184,21 @@ private:
 	inline byte READ_PORT(unsigned port, unsigned cc);
 	inline void WRITE_PORT(unsigned port, byte value, unsigned cc);
 
-	template<bool PRE_PB, bool POST_PB>
+	template<bool PRE_PB, bool POST_PB, bool FETCH = false>
 	byte RDMEMslow(unsigned address, unsigned cc);
-	template<bool PRE_PB, bool POST_PB>
+	template<bool PRE_PB, bool POST_PB, bool FETCH = false>
 	inline byte RDMEM_impl2(unsigned address, unsigned cc);
-	template<bool PRE_PB, bool POST_PB>
+	template<bool PRE_PB, bool POST_PB, bool FETCH = false>
 	inline byte RDMEM_impl (unsigned address, unsigned cc);
 	template<unsigned PC_OFFSET>
 	inline byte RDMEM_OPCODE(unsigned cc);
 	inline byte RDMEM(unsigned address, unsigned cc);
 
-	template<bool PRE_PB, bool POST_PB>
+	template<bool PRE_PB, bool POST_PB, bool FETCH = false>
 	unsigned RD_WORD_slow(unsigned address, unsigned cc);
-	template<bool PRE_PB, bool POST_PB>
+	template<bool PRE_PB, bool POST_PB, bool FETCH = false>
 	inline unsigned RD_WORD_impl2(unsigned address, unsigned cc);
-	template<bool PRE_PB, bool POST_PB>
+	template<bool PRE_PB, bool POST_PB, bool FETCH = false>
 	inline unsigned RD_WORD_impl (unsigned address, unsigned cc);
 	template<unsigned PC_OFFSET>
 	inline unsigned RD_WORD_PC(unsigned cc);
@@ -0,0 +1,354 @@
+#include "CPUProfiler.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXCPU.hh"
+#include "CPURegs.hh"
+#include "MSXCPUInterface.hh"
+#include "MSXMemoryMapper.hh"
+#include "Debugger.hh"
+#include "Debuggable.hh"
+#include "CommandException.hh"
+#include "FileContext.hh"
+#include "FileOperations.hh"
+#include "TclObject.hh"
+#include "outer.hh"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <cstdio>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+// Functions are identified by their start address and the slot that was
+// selected in that page at the moment of the call:
+//   bits  0-15: address
+//   bits 16-17: primary slot
+//   bits 18-19: secondary slot (only when expanded)
+//   bit     20: primary slot is expanded
+//   bit     21: 'toplevel', code that's not inside any (known) function
+// A location additionally has the selected segment:
+//   bits 22-38: segment + 1 (or 0 if there's no mapper)
+static const uint32_t TOPLEVEL = 1 << 21;
+static const unsigned MAX_STACK = 1024;
+
+CPUProfiler::CPUProfiler(MSXMotherBoard& motherBoard_)
+	: Schedulable(motherBoard_.getScheduler())
+	, motherBoard(motherBoard_)
+	, cmd(motherBoard.getCommandController())
+	, totalSamples(0)
+	, active(false)
+{
+}
+
+CPUProfiler::~CPUProfiler()
+{
+	stop();
+}
+
+uint32_t CPUProfiler::functionKey(unsigned address) const
+{
+	auto& cpuInterface = motherBoard.getCPUInterface();
+	int page = address >> 14;
+	int ps = cpuInterface.getPrimarySlot(page);
+	if (cpuInterface.isExpanded(ps)) {
+		int ss = cpuInterface.getSecondarySlot(page);
+		return address | (ps << 16) | (ss << 18) | (1 << 20);
+	} else {
+		return address | (ps << 16);
+	}
+}
+
+uint64_t CPUProfiler::locationKey(unsigned address) const
+{
+	return functionKey(address) | (uint64_t(getSegment(address) + 1) << 22);
+}
+
+// Only used while taking a sample, so this doesn't need to be very fast.
+int CPUProfiler::getSegment(unsigned address) const
+{
+	auto* device = motherBoard.getCPUInterface().getVisibleMSXDevice(
+		address >> 14);
+	if (auto* mapper = dynamic_cast<MSXMemoryMapper*>(device)) {
+		return mapper->getSegment(address);
+	}
+	if (auto* blocks = motherBoard.getDebugger().findDebuggable(
+			device->getName() + " romblocks")) {
+		byte block = blocks->read(address);
+		if (block != 255) return block;
+	}
+	return -1;
+}
+
+void CPUProfiler::call(unsigned callSite, unsigned target, unsigned sp)
+{
+	uint64_t caller = stack.empty() ? TOPLEVEL : stack.back().function;
+	uint32_t callee = functionKey(target);
+	++edges[(caller << 38) | (uint64_t(callSite) << 22) | callee].calls;
+
+	if (stack.size() == MAX_STACK) {
+		// Probably the code never returns from (some of) its calls
+		// (e.g. it pops the return address instead). Forget the
+		// outermost half of the stack.
+		stack.erase(begin(stack), begin(stack) + MAX_STACK / 2);
+	}
+	stack.push_back({callee, uint16_t(callSite), uint16_t(sp)});
+}
+
+void CPUProfiler::ret(unsigned sp)
+{
+	// Also drop the frames that are deeper on the stack, e.g. a routine
+	// that dropped the return address and jumped back to its caller.
+	while (!stack.empty() && (stack.back().sp <= sp)) {
+		stack.pop_back();
+	}
+}
+
+void CPUProfiler::sample()
+{
+	auto& regs = motherBoard.getCPU().getRegisters();
+	unsigned pc = regs.getPC();
+	unsigned sp = regs.getSP();
+
+	// Frames whose return address is already removed from the stack
+	// (without executing a return instruction) are no longer active.
+	while (!stack.empty() && (stack.back().sp < sp)) {
+		stack.pop_back();
+	}
+
+	uint64_t function = stack.empty() ? TOPLEVEL : stack.back().function;
+	++samples[(function << 40) | locationKey(pc)];
+	uint64_t caller = TOPLEVEL;
+	for (auto& frame : stack) {
+		++edges[(caller << 38) | (uint64_t(frame.callSite) << 22) |
+		        frame.function].samples;
+		caller = frame.function;
+	}
+	++totalSamples;
+}
+
+void CPUProfiler::executeUntil(EmuTime::param time)
+{
+	sample();
+	setSyncPoint(time + interval);
+}
+
+void CPUProfiler::start(unsigned rate)
+{
+	removeSyncPoint();
+	if (!active) {
+		// we don't know the calls that happened before
+		stack.clear();
+	}
+	interval = EmuDuration::hz(rate);
+	active = true;
+	setSyncPoint(getCurrentTime() + interval);
+}
+
+void CPUProfiler::stop()
+{
+	removeSyncPoint();
+	stack.clear();
+	active = false;
+}
+
+void CPUProfiler::clear()
+{
+	samples.clear();
+	edges.clear();
+	totalSamples = 0;
+}
+
+static string slotName(uint64_t key)
+{
+	char buf[8];
+	unsigned ps = (key >> 16) & 3;
+	if (key & (1 << 20)) {
+		snprintf(buf, sizeof(buf), "%u-%u", ps, unsigned(key >> 18) & 3);
+	} else {
+		snprintf(buf, sizeof(buf), "%u", ps);
+	}
+	return buf;
+}
+
+static int segmentOf(uint64_t location)
+{
+	return int((location >> 22) & 0x1FFFF) - 1;
+}
+
+static string functionName(uint64_t function)
+{
+	if (function & TOPLEVEL) return "(toplevel)";
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%04X slot %s", unsigned(function & 0xFFFF),
+	         slotName(function).c_str());
+	return buf;
+}
+
+static string fileName(uint64_t key)
+{
+	if (key & TOPLEVEL) return "(unknown)";
+	string result = "slot " + slotName(key);
+	int segment = segmentOf(key);
+	if (segment != -1) {
+		result += " segment " + std::to_string(segment);
+	}
+	return result;
+}
+
+string CPUProfiler::report(unsigned num) const
+{
+	// combine the samples of the same location in different functions
+	std::map<uint64_t, uint64_t> perLocation;
+	for (auto& s : samples) {
+		perLocation[s.first & ((uint64_t(1) << 40) - 1)] += s.second;
+	}
+	vector<std::pair<uint64_t, uint64_t>> sorted(
+		begin(perLocation), end(perLocation));
+	std::stable_sort(begin(sorted), end(sorted),
+		[](const std::pair<uint64_t, uint64_t>& a,
+		   const std::pair<uint64_t, uint64_t>& b) {
+			return a.second > b.second; });
+	if (sorted.size() > num) sorted.resize(num);
+
+	string result = "total samples: " + std::to_string(totalSamples) + '\n';
+	result += "  samples       %  slot  segment  address\n";
+	for (auto& s : sorted) {
+		char buf[80];
+		int segment = segmentOf(s.first);
+		snprintf(buf, sizeof(buf), "%9llu  %6.2f  %-4s  %7s  %04X\n",
+		         static_cast<unsigned long long>(s.second),
+		         100.0 * s.second / totalSamples,
+		         slotName(s.first).c_str(),
+		         (segment == -1) ? "-" : std::to_string(segment).c_str(),
+		         unsigned(s.first & 0xFFFF));
+		result += buf;
+	}
+	return result;
+}
+
+// Write the profile in the format of callgrind, so that it can be viewed
+// with e.g. KCachegrind or processed with callgrind_annotate.
+void CPUProfiler::save(const string& filename) const
+{
+	struct Function {
+		std::map<uint64_t, uint64_t> self; // location -> samples
+		std::map<uint64_t, Edge> calls; // call site << 22 | callee
+	};
+	std::map<uint64_t, Function> functions;
+	for (auto& s : samples) {
+		functions[s.first >> 40].self[s.first & ((uint64_t(1) << 40) - 1)] = s.second;
+	}
+	for (auto& e : edges) {
+		functions[e.first >> 38].calls[e.first & ((uint64_t(1) << 38) - 1)] = e.second;
+	}
+
+	std::ofstream file;
+	FileOperations::openofstream(file, filename);
+	if (!file.is_open()) {
+		throw CommandException("Couldn't open file for writing: " + filename);
+	}
+	file << "# callgrind format\n"
+	        "version: 1\n"
+	        "creator: openMSX\n"
+	        "positions: instr\n"
+	        "events: Samples\n"
+	        "summary: " << totalSamples << "\n";
+	char addr[8];
+	for (auto& f : functions) {
+		string fl = fileName(f.first);
+		file << "\nfl=" << fl << "\nfn=" << functionName(f.first) << '\n';
+		string current = fl;
+		for (auto& s : f.second.self) {
+			string fi = fileName(s.first);
+			if (fi != current) {
+				file << "fi=" << fi << '\n';
+				current = fi;
+			}
+			snprintf(addr, sizeof(addr), "0x%04X", unsigned(s.first & 0xFFFF));
+			file << addr << ' ' << s.second << '\n';
+		}
+		for (auto& c : f.second.calls) {
+			uint64_t callee = c.first & ((1 << 22) - 1);
+			file << "cfl=" << fileName(callee) << '\n'
+			     << "cfn=" << functionName(callee) << '\n';
+			snprintf(addr, sizeof(addr), "0x%04X", unsigned(callee & 0xFFFF));
+			file << "calls=" << c.second.calls << ' ' << addr << '\n';
+			snprintf(addr, sizeof(addr), "0x%04X", unsigned(c.first >> 22));
+			file << addr << ' ' << c.second.samples << '\n';
+		}
+	}
+	if (file.fail()) {
+		throw CommandException("Error while writing file: " + filename);
+	}
+}
+
+
+// class Cmd
+
+CPUProfiler::Cmd::Cmd(CommandController& commandController)
+	: Command(commandController, "cpu_profile")
+{
+}
+
+void CPUProfiler::Cmd::execute(array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() < 2) {
+		throw SyntaxError();
+	}
+	auto& profiler = OUTER(CPUProfiler, cmd);
+	auto& interp = getInterpreter();
+	string_ref subCmd = tokens[1].getString();
+	if (subCmd == "start") {
+		// start [<rate>]
+		if (tokens.size() > 3) throw SyntaxError();
+		int rate = (tokens.size() == 3) ? tokens[2].getInt(interp) : 10000;
+		if ((rate < 1) || (rate > 1000000)) {
+			throw CommandException(
+				"Sample rate must be in range 1..1000000");
+		}
+		profiler.start(rate);
+	} else if (subCmd == "stop") {
+		if (tokens.size() != 2) throw SyntaxError();
+		profiler.stop();
+	} else if (subCmd == "clear") {
+		if (tokens.size() != 2) throw SyntaxError();
+		profiler.clear();
+	} else if (subCmd == "report") {
+		// report [<count>]
+		if (tokens.size() > 3) throw SyntaxError();
+		int num = (tokens.size() == 3) ? tokens[2].getInt(interp) : 20;
+		result.setString(profiler.report(std::max(num, 0)));
+	} else if (subCmd == "save") {
+		if (tokens.size() != 3) throw SyntaxError();
+		profiler.save(FileOperations::expandTilde(
+			tokens[2].getString().str()));
+	} else {
+		throw CommandException("Unknown subcommand: " + subCmd);
+	}
+}
+
+string CPUProfiler::Cmd::help(const vector<string>& /*tokens*/) const
+{
+	return "Sampling profiler for the emulated CPU.\n"
+	       "  cpu_profile start [<rate>]  start sampling, <rate> (default 10000) samples per second of emulated time\n"
+	       "  cpu_profile stop            stop sampling, the samples are kept\n"
+	       "  cpu_profile clear           remove all samples\n"
+	       "  cpu_profile report [<count>]  the <count> (default 20) addresses with the most samples\n"
+	       "  cpu_profile save <filename>   save the profile (including the call graph) in callgrind format\n";
+}
+
+void CPUProfiler::Cmd::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static const char* const subCmds[] = {
+			"start", "stop", "clear", "report", "save"
+		};
+		completeString(tokens, subCmds);
+	} else if ((tokens.size() == 3) && (tokens[1] == "save")) {
+		completeFileName(tokens, userFileContext());
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,102 @@
+#ifndef CPUPROFILER_HH
+#define CPUPROFILER_HH
+
+#include "Command.hh"
+#include "Schedulable.hh"
+#include "EmuDuration.hh"
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace openmsx {
+
+class MSXMotherBoard;
+class MSXCPUInterface;
+
+/** Sampling profiler for the emulated CPU.
+ *
+ * While the profiler runs, the PC is sampled at a fixed rate (in emulated
+ * time). Each sample is attributed to the slot, subslot and (memory mapper
+ * or ROM mapper) segment that was visible at that moment. The CPU also
+ * reports all calls (CALL, RST, interrupts) and returns, that's used to
+ * maintain a shadow call stack, so that each sample can also be attributed
+ * to all functions on the call stack (inclusive cost).
+ *
+ * When the profiler is stopped there is no sync point and the CPU only
+ * tests the isActive() flag on call and return instructions.
+ */
+class CPUProfiler final : private Schedulable
+{
+public:
+	explicit CPUProfiler(MSXMotherBoard& motherBoard);
+	~CPUProfiler();
+
+	bool isActive() const { return active; }
+
+	/** Called by the CPU right after it jumped to a subroutine or an
+	  * interrupt handler. Only call this when isActive() returns true.
+	  * @param callSite Address of the call instruction, or for an
+	  *                 interrupt the address of the interrupted instruction.
+	  * @param target The new PC.
+	  * @param sp The value of the stack pointer after the return address
+	  *           was pushed.
+	  */
+	void call(unsigned callSite, unsigned target, unsigned sp);
+
+	/** Called by the CPU right before it executes a (taken) return
+	  * instruction. Only call this when isActive() returns true.
+	  * @param sp The value of the stack pointer before the return address
+	  *           is popped.
+	  */
+	void ret(unsigned sp);
+
+private:
+	struct Frame {
+		uint32_t function; // see functionKey()
+		uint16_t callSite;
+		uint16_t sp;
+	};
+	struct Edge {
+		Edge() : calls(0), samples(0) {}
+		uint64_t calls;
+		uint64_t samples; // inclusive
+	};
+
+	void start(unsigned rate);
+	void stop();
+	void clear();
+	void sample();
+	uint32_t functionKey(unsigned address) const;
+	uint64_t locationKey(unsigned address) const;
+	int getSegment(unsigned address) const;
+	std::string report(unsigned num) const;
+	void save(const std::string& filename) const;
+
+	// Schedulable
+	void executeUntil(EmuTime::param time) override;
+
+	MSXMotherBoard& motherBoard;
+
+	class Cmd final : public Command {
+	public:
+		explicit Cmd(CommandController& commandController);
+		void execute(array_ref<TclObject> tokens,
+		             TclObject& result) override;
+		std::string help(const std::vector<std::string>& tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} cmd;
+
+	std::vector<Frame> stack; // shadow call stack, innermost call last
+	// (innermost function << 40 | location) -> number of samples
+	std::unordered_map<uint64_t, uint64_t> samples;
+	// (caller << 38 | call site << 22 | callee) -> edge
+	std::unordered_map<uint64_t, Edge> edges;
+	uint64_t totalSamples;
+	EmuDuration interval;
+	bool active;
+};
+
+} // namespace openmsx
+
+#endif
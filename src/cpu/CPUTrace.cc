@@ -0,0 +1,272 @@
+#include "CPUTrace.hh"
+#include "Dasm.hh"
+#include "CommandException.hh"
+#include "File.hh"
+#include "FileContext.hh"
+#include "FileOperations.hh"
+#include "TclObject.hh"
+#include "EmuDuration.hh"
+#include "StringOp.hh"
+#include "endian.hh"
+#include "outer.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+static const char TRACE_MAGIC[8] = { 'o','M','S','X','t','r','c','1' };
+static const size_t RECORD_SIZE = 32; // in the file
+
+CPUTrace::CPUTrace(CommandController& commandController)
+	: recordSetting(commandController, "cputrace_record",
+		"record a compact binary CPU trace, see 'cputrace_buffer'",
+		false, Setting::DONT_SAVE)
+	, sizeSetting(commandController, "cputrace_record_size",
+		"number of instructions kept by 'cputrace_record'",
+		1000000, 1000, 100000000)
+	, cmd(commandController)
+	, pos(0), count(0)
+	, recording(false)
+{
+	recordSetting.attach(*this);
+	sizeSetting.attach(*this);
+}
+
+CPUTrace::~CPUTrace()
+{
+	sizeSetting.detach(*this);
+	recordSetting.detach(*this);
+}
+
+void CPUTrace::update(const Setting& setting)
+{
+	if (&setting == &sizeSetting) {
+		if (!buffer.empty()) resize();
+	} else {
+		recording = recordSetting.getBoolean();
+		if (recording && buffer.empty()) resize();
+	}
+}
+
+void CPUTrace::resize()
+{
+	// don't keep the old content, that's simpler
+	vector<Record> newBuffer(sizeSetting.getInt());
+	buffer.swap(newBuffer);
+	pos = 0;
+	count = 0;
+}
+
+const CPUTrace::Record& CPUTrace::get(size_t i) const
+{
+	assert(i < count);
+	size_t first = (count < buffer.size()) ? 0 : pos;
+	size_t j = first + i;
+	if (j >= buffer.size()) j -= buffer.size();
+	return buffer[j];
+}
+
+string CPUTrace::decode(const Record& r)
+{
+	string dasmOutput;
+	dasm(r.opcode, r.pc, dasmOutput);
+
+	// slot of the page that contains the instruction
+	unsigned shift = 2 * (r.pc >> 14);
+	unsigned ps = (r.primarySlots   >> shift) & 3;
+	unsigned ss = (r.secondarySlots >> shift) & 3;
+	char slot[8];
+	if (r.expanded & (1 << ps)) {
+		snprintf(slot, sizeof(slot), "%u-%u", ps, ss);
+	} else {
+		snprintf(slot, sizeof(slot), "%u  ", ps);
+	}
+
+	char buf[160];
+	snprintf(buf, sizeof(buf),
+	         "%.9f %s %s %04x : %s AF=%04x BC=%04x DE=%04x HL=%04x "
+	         "IX=%04x IY=%04x SP=%04x",
+	         EmuDuration(r.time).toDouble(),
+	         (r.flags & FLAG_R800) ? "R800" : "Z80 ", slot, r.pc,
+	         dasmOutput.c_str(), r.af, r.bc, r.de, r.hl, r.ix, r.iy, r.sp);
+	return buf;
+}
+
+// The file stores the records in a fixed (little endian) layout, so that
+// it can be decoded on any host.
+void CPUTrace::save(const string& filename) const
+{
+	vector<byte> data(sizeof(TRACE_MAGIC) + 8 + count * RECORD_SIZE);
+	memcpy(data.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	Endian::write_UA_L64(&data[8], count);
+	byte* p = &data[16];
+	for (size_t i = 0; i < count; ++i) {
+		auto& r = get(i);
+		Endian::write_UA_L64(p +  0, r.time);
+		Endian::write_UA_L16(p +  8, r.pc);
+		Endian::write_UA_L16(p + 10, r.af);
+		Endian::write_UA_L16(p + 12, r.bc);
+		Endian::write_UA_L16(p + 14, r.de);
+		Endian::write_UA_L16(p + 16, r.hl);
+		Endian::write_UA_L16(p + 18, r.ix);
+		Endian::write_UA_L16(p + 20, r.iy);
+		Endian::write_UA_L16(p + 22, r.sp);
+		memcpy(p + 24, r.opcode, 4);
+		p[28] = r.primarySlots;
+		p[29] = r.secondarySlots;
+		p[30] = r.expanded;
+		p[31] = r.flags;
+		p += RECORD_SIZE;
+	}
+	File file(filename, File::TRUNCATE);
+	file.write(data.data(), data.size());
+}
+
+vector<CPUTrace::Record> CPUTrace::load(const string& filename)
+{
+	File file(filename);
+	size_t size;
+	const byte* data = file.mmap(size);
+	if ((size < 16) ||
+	    (memcmp(data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) ||
+	    (Endian::read_UA_L64(data + 8) != ((size - 16) / RECORD_SIZE)) ||
+	    (((size - 16) % RECORD_SIZE) != 0)) {
+		throw CommandException("Not a CPU trace file: " + filename);
+	}
+	size_t num = (size - 16) / RECORD_SIZE;
+	vector<Record> result(num);
+	const byte* p = data + 16;
+	for (auto& r : result) {
+		r.time = Endian::read_UA_L64(p + 0);
+		r.pc   = Endian::read_UA_L16(p +  8);
+		r.af   = Endian::read_UA_L16(p + 10);
+		r.bc   = Endian::read_UA_L16(p + 12);
+		r.de   = Endian::read_UA_L16(p + 14);
+		r.hl   = Endian::read_UA_L16(p + 16);
+		r.ix   = Endian::read_UA_L16(p + 18);
+		r.iy   = Endian::read_UA_L16(p + 20);
+		r.sp   = Endian::read_UA_L16(p + 22);
+		memcpy(r.opcode, p + 24, 4);
+		r.primarySlots   = p[28];
+		r.secondarySlots = p[29];
+		r.expanded       = p[30];
+		r.flags          = p[31];
+		p += RECORD_SIZE;
+	}
+	return result;
+}
+
+
+// class Cmd
+
+CPUTrace::Cmd::Cmd(CommandController& commandController)
+	: Command(commandController, "cputrace_buffer")
+{
+}
+
+// Add the decoded form of the last 'num' of the given records to 'result',
+// optionally only those that contain 'pattern'.
+template<typename GET>
+static void decodeRecords(size_t total, GET get, size_t num,
+                          string_ref pattern, TclObject& result)
+{
+	vector<string> lines;
+	for (size_t i = total; (i > 0) && (lines.size() < num); --i) {
+		string line = CPUTrace::decode(get(i - 1));
+		if (pattern.empty() ||
+		    (string_ref(line).find(pattern) != string_ref::npos)) {
+			lines.push_back(std::move(line));
+		}
+	}
+	std::reverse(begin(lines), end(lines)); // oldest first
+	result.addListElements(lines);
+}
+
+void CPUTrace::Cmd::execute(array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() < 2) {
+		throw SyntaxError();
+	}
+	auto& trace = OUTER(CPUTrace, cmd);
+	auto& interp = getInterpreter();
+	string_ref subCmd = tokens[1].getString();
+	if (subCmd == "size") {
+		if (tokens.size() != 2) throw SyntaxError();
+		result.setInt(int(trace.count));
+	} else if (subCmd == "clear") {
+		if (tokens.size() != 2) throw SyntaxError();
+		trace.pos = 0;
+		trace.count = 0;
+	} else if ((subCmd == "dump") || (subCmd == "search")) {
+		// dump [<count>]  or  search <text> [<count>]
+		bool search = subCmd == "search";
+		unsigned first = search ? 3 : 2;
+		if ((tokens.size() < first) || (tokens.size() > (first + 1))) {
+			throw SyntaxError();
+		}
+		string_ref pattern = search ? tokens[2].getString() : string_ref();
+		int num = (tokens.size() > first) ? tokens[first].getInt(interp)
+		                                  : 100;
+		decodeRecords(trace.count,
+		              [&](size_t i) -> const Record& { return trace.get(i); },
+		              std::max(num, 0), pattern, result);
+	} else if (subCmd == "save") {
+		if (tokens.size() != 3) throw SyntaxError();
+		try {
+			trace.save(FileOperations::expandTilde(
+				tokens[2].getString().str()));
+		} catch (MSXException& e) {
+			throw CommandException(e.getMessage());
+		}
+	} else if (subCmd == "decode") {
+		// decode <filename> [<count>]
+		if ((tokens.size() < 3) || (tokens.size() > 4)) {
+			throw SyntaxError();
+		}
+		int num = (tokens.size() == 4) ? tokens[3].getInt(interp)
+		                               : 100;
+		vector<Record> records;
+		try {
+			records = load(FileOperations::expandTilde(
+				tokens[2].getString().str()));
+		} catch (MSXException& e) {
+			throw CommandException(e.getMessage());
+		}
+		decodeRecords(records.size(),
+		              [&](size_t i) -> const Record& { return records[i]; },
+		              std::max(num, 0), string_ref(), result);
+	} else {
+		throw CommandException("Unknown subcommand: " + subCmd);
+	}
+}
+
+string CPUTrace::Cmd::help(const vector<string>& /*tokens*/) const
+{
+	return "Inspect the trace recorded when 'cputrace_record' is enabled.\n"
+	       "  cputrace_buffer dump [<count>]           the last <count> (default 100) instructions\n"
+	       "  cputrace_buffer search <text> [<count>]  the last <count> instructions whose line contains <text>\n"
+	       "  cputrace_buffer size                     number of recorded instructions\n"
+	       "  cputrace_buffer clear                    remove all recorded instructions\n"
+	       "  cputrace_buffer save <filename>          save the recorded instructions in a file\n"
+	       "  cputrace_buffer decode <filename> [<count>]  decode the last <count> instructions from a saved file\n";
+}
+
+void CPUTrace::Cmd::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static const char* const subCmds[] = {
+			"dump", "search", "size", "clear", "save", "decode"
+		};
+		completeString(tokens, subCmds);
+	} else if ((tokens.size() == 3) &&
+	           ((tokens[1] == "save") || (tokens[1] == "decode"))) {
+		completeFileName(tokens, userFileContext());
+	}
+}
+
+} // namespace openmsx
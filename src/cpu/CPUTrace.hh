@@ -0,0 +1,94 @@
+#ifndef CPUTRACE_HH
+#define CPUTRACE_HH
+
+#include "Command.hh"
+#include "BooleanSetting.hh"
+#include "IntegerSetting.hh"
+#include "Observer.hh"
+#include "openmsx.hh"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace openmsx {
+
+class CommandController;
+
+/** Compact binary CPU trace.
+ *
+ * The 'cputrace' setting disassembles and prints every instruction, that's
+ * much too slow to leave enabled for a long time. When the
+ * 'cputrace_record' setting is enabled, the CPU instead stores a small
+ * fixed-size record per instruction in a ring buffer. Disassembling only
+ * happens when the trace is inspected, with the 'cputrace_buffer' command
+ * (e.g. from the command of a breakpoint). That command can also save the
+ * buffer to a file and decode such a file later.
+ */
+class CPUTrace final : private Observer<Setting>
+{
+public:
+	struct Record {
+		uint64_t time; // EmuTime at the end of the instruction
+		// registers after executing the instruction (like 'cputrace')
+		uint16_t pc; // address of the instruction itself
+		uint16_t af, bc, de, hl, ix, iy, sp;
+		byte opcode[4];
+		byte primarySlots;   // selected primary slot, 2 bits per page
+		byte secondarySlots; // selected secondary slot, 2 bits per page
+		byte expanded; // bit N set: primary slot N is expanded
+		byte flags;    // see below
+	};
+	enum { FLAG_R800 = 1 };
+
+	explicit CPUTrace(CommandController& commandController);
+	~CPUTrace();
+
+	BooleanSetting& getRecordSetting() { return recordSetting; }
+
+	/** In sync with the 'cputrace_record' setting. */
+	bool isRecording() const { return recording; }
+
+	/** Returns the entry that should be filled in for the next
+	  * instruction. Only call this when isRecording() returns true.
+	  */
+	Record& next()
+	{
+		Record& result = buffer[pos];
+		if (++pos == buffer.size()) pos = 0;
+		if (count < buffer.size()) ++count;
+		return result;
+	}
+
+	/** Disassemble a record to a human readable line. */
+	static std::string decode(const Record& record);
+
+private:
+	// Observer<Setting>
+	void update(const Setting& setting) override;
+
+	void resize();
+	const Record& get(size_t i) const; // 0 is the oldest record
+	void save(const std::string& filename) const;
+	static std::vector<Record> load(const std::string& filename);
+
+	BooleanSetting recordSetting;
+	IntegerSetting sizeSetting;
+
+	class Cmd final : public Command {
+	public:
+		explicit Cmd(CommandController& commandController);
+		void execute(array_ref<TclObject> tokens,
+		             TclObject& result) override;
+		std::string help(const std::vector<std::string>& tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} cmd;
+
+	std::vector<Record> buffer; // allocated when recording starts
+	size_t pos;   // position of the next record
+	size_t count; // number of valid records
+	bool recording;
+};
+
+} // namespace openmsx
+
+#endif
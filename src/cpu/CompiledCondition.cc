@@ -0,0 +1,731 @@
+#include "CompiledCondition.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXCPU.hh"
+#include "MSXCPUInterface.hh"
+#include "CPURegs.hh"
+#include "Debugger.hh"
+#include "Debuggable.hh"
+#include "Interpreter.hh"
+#include "TclObject.hh"
+#include "CommandException.hh"
+#include "StringOp.hh"
+#include "memory.hh"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace openmsx {
+
+struct CompiledCondition::Node
+{
+	explicit Node(bool boolOnly_ = false) : boolOnly(boolOnly_) {}
+	virtual ~Node() = default;
+
+	/** @throws CommandException when the value can't be calculated. The
+	  * message doesn't matter, Tcl will produce the real error message.
+	  */
+	virtual int64_t eval(MSXMotherBoard& motherBoard,
+	                     Interpreter& interp) const = 0;
+
+	// Some Tcl procs (e.g. pc_in_slot) return the string "true" instead
+	// of 1. Such a value can only be used in a boolean context.
+	const bool boolOnly;
+};
+
+namespace {
+
+using Node = CompiledCondition::Node;
+using NodePtr = unique_ptr<Node>;
+
+// Thrown by the parser when it encounters something it doesn't support.
+struct Unsupported {};
+
+static void fail()
+{
+	throw CommandException("can't evaluate natively");
+}
+
+// Tcl transparently switches to arbitrary precision integers when a result
+// doesn't fit. We don't, instead the operands of the operators that can
+// overflow are limited to 32 bit (the result then always fits in 64 bit).
+static int64_t check32(int64_t v)
+{
+	if ((v < -(int64_t(1) << 31)) || (v > (int64_t(1) << 31))) fail();
+	return v;
+}
+
+struct Constant final : Node
+{
+	explicit Constant(int64_t value_) : value(value_) {}
+	int64_t eval(MSXMotherBoard&, Interpreter&) const override
+	{
+		return value;
+	}
+	const int64_t value;
+};
+
+struct Variable final : Node
+{
+	explicit Variable(string_ref name_) : name(name_) {}
+	int64_t eval(MSXMotherBoard&, Interpreter& interp) const override
+	{
+		// Not getInt(), that wraps values above 0x7FFFFFFF.
+		return interp.getVariable(name).getInt64(interp);
+	}
+	const TclObject name;
+};
+
+using RegGetter = unsigned (*)(const CPURegs&);
+
+struct Register final : Node
+{
+	explicit Register(RegGetter getter_) : getter(getter_) {}
+	int64_t eval(MSXMotherBoard& motherBoard, Interpreter&) const override
+	{
+		return getter(motherBoard.getCPU().getRegisters());
+	}
+	const RegGetter getter;
+};
+
+// Same names and values as the 'reg' proc (which uses the 'CPU regs'
+// debuggable).
+static const struct RegInfo {
+	const char* name;
+	RegGetter getter;
+} regTable[] = {
+	{ "a",   [](const CPURegs& r) -> unsigned { return r.getA(); } },
+	{ "f",   [](const CPURegs& r) -> unsigned { return r.getF(); } },
+	{ "b",   [](const CPURegs& r) -> unsigned { return r.getB(); } },
+	{ "c",   [](const CPURegs& r) -> unsigned { return r.getC(); } },
+	{ "d",   [](const CPURegs& r) -> unsigned { return r.getD(); } },
+	{ "e",   [](const CPURegs& r) -> unsigned { return r.getE(); } },
+	{ "h",   [](const CPURegs& r) -> unsigned { return r.getH(); } },
+	{ "l",   [](const CPURegs& r) -> unsigned { return r.getL(); } },
+	{ "a2",  [](const CPURegs& r) -> unsigned { return r.getA2(); } },
+	{ "f2",  [](const CPURegs& r) -> unsigned { return r.getF2(); } },
+	{ "b2",  [](const CPURegs& r) -> unsigned { return r.getB2(); } },
+	{ "c2",  [](const CPURegs& r) -> unsigned { return r.getC2(); } },
+	{ "d2",  [](const CPURegs& r) -> unsigned { return r.getD2(); } },
+	{ "e2",  [](const CPURegs& r) -> unsigned { return r.getE2(); } },
+	{ "h2",  [](const CPURegs& r) -> unsigned { return r.getH2(); } },
+	{ "l2",  [](const CPURegs& r) -> unsigned { return r.getL2(); } },
+	{ "ixh", [](const CPURegs& r) -> unsigned { return r.getIXh(); } },
+	{ "ixl", [](const CPURegs& r) -> unsigned { return r.getIXl(); } },
+	{ "iyh", [](const CPURegs& r) -> unsigned { return r.getIYh(); } },
+	{ "iyl", [](const CPURegs& r) -> unsigned { return r.getIYl(); } },
+	{ "pch", [](const CPURegs& r) -> unsigned { return r.getPCh(); } },
+	{ "pcl", [](const CPURegs& r) -> unsigned { return r.getPCl(); } },
+	{ "sph", [](const CPURegs& r) -> unsigned { return r.getSPh(); } },
+	{ "spl", [](const CPURegs& r) -> unsigned { return r.getSPl(); } },
+	{ "i",   [](const CPURegs& r) -> unsigned { return r.getI(); } },
+	{ "r",   [](const CPURegs& r) -> unsigned { return r.getR(); } },
+	{ "im",  [](const CPURegs& r) -> unsigned { return r.getIM(); } },
+	{ "iff", [](const CPURegs& r) -> unsigned {
+		return 1 *  r.getIFF1() +
+		       2 *  r.getIFF2() +
+		       4 * (r.getIFF1() && !r.prevWasEI()); } },
+	{ "af",  [](const CPURegs& r) -> unsigned { return r.getAF(); } },
+	{ "bc",  [](const CPURegs& r) -> unsigned { return r.getBC(); } },
+	{ "de",  [](const CPURegs& r) -> unsigned { return r.getDE(); } },
+	{ "hl",  [](const CPURegs& r) -> unsigned { return r.getHL(); } },
+	{ "af2", [](const CPURegs& r) -> unsigned { return r.getAF2(); } },
+	{ "bc2", [](const CPURegs& r) -> unsigned { return r.getBC2(); } },
+	{ "de2", [](const CPURegs& r) -> unsigned { return r.getDE2(); } },
+	{ "hl2", [](const CPURegs& r) -> unsigned { return r.getHL2(); } },
+	{ "ix",  [](const CPURegs& r) -> unsigned { return r.getIX(); } },
+	{ "iy",  [](const CPURegs& r) -> unsigned { return r.getIY(); } },
+	{ "pc",  [](const CPURegs& r) -> unsigned { return r.getPC(); } },
+	{ "sp",  [](const CPURegs& r) -> unsigned { return r.getSP(); } },
+};
+
+// Implements [debug read ..] and the [peek ..] procs.
+struct Peek final : Node
+{
+	Peek(NodePtr address_, string_ref debuggable_,
+	     bool word_, bool bigEndian_, bool isSigned_)
+		: address(std::move(address_)), debuggable(debuggable_.str())
+		, isMemory(debuggable_ == "memory")
+		, isWord(word_), bigEndian(bigEndian_), isSigned(isSigned_)
+	{
+	}
+
+	int64_t eval(MSXMotherBoard& motherBoard, Interpreter& interp) const override
+	{
+		int64_t addr = address->eval(motherBoard, interp);
+		if (!isWord) {
+			int64_t b = read(motherBoard, addr);
+			return (isSigned && (b >= 128)) ? (b - 256) : b;
+		}
+		int64_t b0 = read(motherBoard, addr + 0);
+		int64_t b1 = read(motherBoard, addr + 1);
+		int64_t w = bigEndian ? (256 * b0 + b1) : (256 * b1 + b0);
+		return (isSigned && (w >= 32768)) ? (w - 65536) : w;
+	}
+
+	int64_t read(MSXMotherBoard& motherBoard, int64_t addr) const
+	{
+		if (isMemory) {
+			// fast path for the most common case
+			if ((addr < 0) || (addr >= 0x10000)) fail();
+			return motherBoard.getCPUInterface().peekMem(
+				word(addr), motherBoard.getCurrentTime());
+		}
+		// lookup every time, debuggables can come and go
+		auto* device = motherBoard.getDebugger().findDebuggable(debuggable);
+		if (!device) fail();
+		if ((addr < 0) || (addr >= device->getSize())) fail();
+		return device->read(unsigned(addr));
+	}
+
+	const NodePtr address;
+	const string debuggable;
+	const bool isMemory;
+	const bool isWord;
+	const bool bigEndian;
+	const bool isSigned;
+};
+
+// Implements the pc_in_slot and watch_in_slot procs (without mapper check).
+struct InSlot final : Node
+{
+	InSlot(NodePtr address_, int ps_, int ss_)
+		: Node(true), address(std::move(address_)), ps(ps_), ss(ss_)
+	{
+	}
+
+	int64_t eval(MSXMotherBoard& motherBoard, Interpreter& interp) const override
+	{
+		int64_t addr = address->eval(motherBoard, interp);
+		if ((addr < 0) || (addr >= 0x10000)) fail();
+		int page = int(addr >> 14);
+		auto& cpuInterface = motherBoard.getCPUInterface();
+		int curPs = cpuInterface.getPrimarySlot(page);
+		if ((ps != -1) && (curPs != ps)) return 0;
+		if ((ss != -1) && cpuInterface.isExpanded(curPs) &&
+		    (cpuInterface.getSecondarySlot(page) != ss)) return 0;
+		return 1;
+	}
+
+	const NodePtr address;
+	const int ps; // -1 means 'X' (any slot)
+	const int ss;
+};
+
+struct Unary final : Node
+{
+	Unary(char op_, NodePtr a_) : op(op_), a(std::move(a_)) {}
+
+	int64_t eval(MSXMotherBoard& motherBoard, Interpreter& interp) const override
+	{
+		int64_t x = a->eval(motherBoard, interp);
+		switch (op) {
+		case '!': return x == 0;
+		case '~': return ~x;
+		case '-': return -check32(x);
+		default:  return x; // '+'
+		}
+	}
+
+	const char op;
+	const NodePtr a;
+};
+
+enum BinaryOp {
+	OP_OR, OP_AND, OP_BIT_OR, OP_BIT_XOR, OP_BIT_AND, OP_EQ, OP_NE,
+	OP_LT, OP_LE, OP_GT, OP_GE, OP_SHL, OP_SHR, OP_ADD, OP_SUB, OP_MUL,
+	OP_DIV, OP_MOD
+};
+
+struct Binary final : Node
+{
+	Binary(BinaryOp op_, NodePtr a_, NodePtr b_)
+		: op(op_), a(std::move(a_)), b(std::move(b_)) {}
+
+	int64_t eval(MSXMotherBoard& motherBoard, Interpreter& interp) const override
+	{
+		int64_t x = a->eval(motherBoard, interp);
+		// short-circuit evaluation, like Tcl
+		if (op == OP_OR) {
+			return (x != 0) || (b->eval(motherBoard, interp) != 0);
+		}
+		if (op == OP_AND) {
+			return (x != 0) && (b->eval(motherBoard, interp) != 0);
+		}
+		int64_t y = b->eval(motherBoard, interp);
+		switch (op) {
+		case OP_BIT_OR:  return x | y;
+		case OP_BIT_XOR: return x ^ y;
+		case OP_BIT_AND: return x & y;
+		case OP_EQ:      return x == y;
+		case OP_NE:      return x != y;
+		case OP_LT:      return x <  y;
+		case OP_LE:      return x <= y;
+		case OP_GT:      return x >  y;
+		case OP_GE:      return x >= y;
+		case OP_SHL:
+			if ((y < 0) || (y >= 32)) fail();
+			return check32(x) << y;
+		case OP_SHR:
+			if (y < 0) fail();
+			return x >> std::min<int64_t>(y, 63);
+		case OP_ADD:     return check32(x) + check32(y);
+		case OP_SUB:     return check32(x) - check32(y);
+		case OP_MUL:     return check32(x) * check32(y);
+		case OP_DIV: {
+			if (y == 0) fail();
+			// Tcl rounds towards negative infinity
+			int64_t q = check32(x) / check32(y);
+			if (((x % y) != 0) && ((x < 0) != (y < 0))) --q;
+			return q;
+		}
+		case OP_MOD: {
+			if (y == 0) fail();
+			// the result has the same sign as the divisor
+			int64_t r = check32(x) % check32(y);
+			if ((r != 0) && ((r < 0) != (y < 0))) r += y;
+			return r;
+		}
+		default:
+			return 0; // OP_OR, OP_AND already handled
+		}
+	}
+
+	const BinaryOp op;
+	const NodePtr a;
+	const NodePtr b;
+};
+
+struct Ternary final : Node
+{
+	Ternary(NodePtr c_, NodePtr a_, NodePtr b_)
+		: Node(a_->boolOnly || b_->boolOnly)
+		, c(std::move(c_)), a(std::move(a_)), b(std::move(b_)) {}
+
+	int64_t eval(MSXMotherBoard& motherBoard, Interpreter& interp) const override
+	{
+		return (c->eval(motherBoard, interp) != 0)
+		     ? a->eval(motherBoard, interp)
+		     : b->eval(motherBoard, interp);
+	}
+
+	const NodePtr c;
+	const NodePtr a;
+	const NodePtr b;
+};
+
+// Parse an integer literal, like Tcl does. Octal numbers without '0o'
+// prefix, floating point numbers and (very) large numbers are not
+// supported.
+static bool parseInteger(const char*& p, const char* end, int64_t& result)
+{
+	unsigned base = 10;
+	if ((p == end) || !isdigit(byte(*p))) return false;
+	if ((*p == '0') && ((p + 1) != end)) {
+		char c = p[1];
+		if      ((c == 'x') || (c == 'X')) { base = 16; p += 2; }
+		else if ((c == 'b') || (c == 'B')) { base =  2; p += 2; }
+		else if ((c == 'o') || (c == 'O')) { base =  8; p += 2; }
+		else if (isdigit(byte(c))) return false;
+	}
+	const char* start = p;
+	result = 0;
+	while (p != end) {
+		char c = *p;
+		unsigned digit;
+		if      (('0' <= c) && (c <= '9')) digit = c - '0';
+		else if (('a' <= c) && (c <= 'f')) digit = c - 'a' + 10;
+		else if (('A' <= c) && (c <= 'F')) digit = c - 'A' + 10;
+		else break;
+		if (digit >= base) return false;
+		result = result * base + digit;
+		if (result > 0xFFFFFFFF) return false;
+		++p;
+	}
+	if (p == start) return false;
+	// reject things like '1.5', '1e3', '12abc'
+	return (p == end) || !(isalnum(byte(*p)) || (*p == '.') || (*p == '_'));
+}
+
+class Parser
+{
+public:
+	explicit Parser(string_ref expression)
+		: p(expression.begin()), end(expression.end())
+	{
+	}
+
+	NodePtr parseExpression()
+	{
+		auto result = parseTernary();
+		skipSpace();
+		if (p != end) throw Unsupported();
+		return result;
+	}
+
+private:
+	struct Word {
+		string literal;
+		NodePtr node; // nullptr for a literal
+	};
+
+	void skipSpace()
+	{
+		while ((p != end) && isspace(byte(*p))) ++p;
+	}
+
+	string_ref peekOperator()
+	{
+		static const char* const operators[] = {
+			"||", "&&", "==", "!=", "<=", ">=", "<<", ">>", "**",
+			"|", "^", "&", "<", ">", "+", "-", "*", "/", "%",
+			"!", "~", "?", ":",
+		};
+		skipSpace();
+		for (auto* op : operators) {
+			size_t len = strlen(op);
+			if ((size_t(end - p) >= len) && (memcmp(p, op, len) == 0)) {
+				return string_ref(p, len);
+			}
+		}
+		return string_ref();
+	}
+
+	static void checkNotBool(const Node& node)
+	{
+		if (node.boolOnly) throw Unsupported();
+	}
+
+	NodePtr parseTernary()
+	{
+		auto cond = parseBinary(0);
+		if (peekOperator() != "?") return cond;
+		++p;
+		auto a = parseTernary();
+		if (peekOperator() != ":") throw Unsupported();
+		++p;
+		auto b = parseTernary();
+		return make_unique<Ternary>(std::move(cond), std::move(a), std::move(b));
+	}
+
+	NodePtr parseBinary(unsigned level)
+	{
+		// from lowest to highest precedence
+		static const struct {
+			const char* str;
+			BinaryOp op;
+		} levels[][5] = {
+			{ { "||", OP_OR }, { nullptr, OP_OR } },
+			{ { "&&", OP_AND }, { nullptr, OP_OR } },
+			{ { "|", OP_BIT_OR }, { nullptr, OP_OR } },
+			{ { "^", OP_BIT_XOR }, { nullptr, OP_OR } },
+			{ { "&", OP_BIT_AND }, { nullptr, OP_OR } },
+			{ { "==", OP_EQ }, { "!=", OP_NE }, { nullptr, OP_OR } },
+			{ { "<", OP_LT }, { "<=", OP_LE }, { ">", OP_GT },
+			  { ">=", OP_GE }, { nullptr, OP_OR } },
+			{ { "<<", OP_SHL }, { ">>", OP_SHR }, { nullptr, OP_OR } },
+			{ { "+", OP_ADD }, { "-", OP_SUB }, { nullptr, OP_OR } },
+			{ { "*", OP_MUL }, { "/", OP_DIV }, { "%", OP_MOD },
+			  { nullptr, OP_OR } },
+		};
+		static const unsigned NUM_LEVELS = sizeof(levels) / sizeof(levels[0]);
+		if (level == NUM_LEVELS) return parseUnary();
+
+		auto left = parseBinary(level + 1);
+		while (true) {
+			auto str = peekOperator();
+			auto* info = &levels[level][0];
+			while (info->str && (str != info->str)) ++info;
+			if (!info->str) return left;
+			p += str.size();
+			auto right = parseBinary(level + 1);
+			bool logical = (info->op == OP_OR) || (info->op == OP_AND);
+			if (!logical) {
+				checkNotBool(*left);
+				checkNotBool(*right);
+			}
+			left = make_unique<Binary>(info->op, std::move(left), std::move(right));
+		}
+	}
+
+	NodePtr parseUnary()
+	{
+		auto str = peekOperator();
+		if ((str == "!") || (str == "~") || (str == "-") || (str == "+")) {
+			++p;
+			auto a = parseUnary();
+			if (str != "!") checkNotBool(*a);
+			return make_unique<Unary>(str[0], std::move(a));
+		}
+		return parsePrimary();
+	}
+
+	NodePtr parsePrimary()
+	{
+		skipSpace();
+		if (p == end) throw Unsupported();
+		switch (*p) {
+		case '(': {
+			++p;
+			auto result = parseTernary();
+			skipSpace();
+			if ((p == end) || (*p != ')')) throw Unsupported();
+			++p;
+			return result;
+		}
+		case '$':
+			return parseVariable();
+		case '[':
+			return parseCommand();
+		default: {
+			int64_t value;
+			if (!parseInteger(p, end, value)) throw Unsupported();
+			return make_unique<Constant>(value);
+		}
+		}
+	}
+
+	NodePtr parseVariable()
+	{
+		++p; // skip '$'
+		const char* start = p;
+		if ((p != end) && (*p == '{')) {
+			start = ++p;
+			while ((p != end) && (*p != '}')) ++p;
+			if (p == end) throw Unsupported();
+			string_ref name(start, p - start);
+			++p;
+			if (name.empty()) throw Unsupported();
+			return make_unique<Variable>(name);
+		}
+		while (p != end) {
+			if (isalnum(byte(*p)) || (*p == '_')) {
+				++p;
+			} else if ((*p == ':') && ((p + 1) != end) && (p[1] == ':')) {
+				p += 2;
+			} else {
+				break;
+			}
+		}
+		if (p == start) throw Unsupported();
+		// array elements are not supported
+		if ((p != end) && (*p == '(')) throw Unsupported();
+		return make_unique<Variable>(string_ref(start, p - start));
+	}
+
+	// Is the current position at the end of a word of a command?
+	bool atWordEnd() const
+	{
+		return (p != end) && ((*p == ' ') || (*p == '\t') || (*p == ']'));
+	}
+
+	bool parseWord(Word& word)
+	{
+		while ((p != end) && ((*p == ' ') || (*p == '\t'))) ++p;
+		if (p == end) throw Unsupported();
+		switch (*p) {
+		case ']':
+			++p;
+			return false;
+		case '[':
+			word.node = parseCommand();
+			break;
+		case '$':
+			word.node = parseVariable();
+			break;
+		case '{': {
+			const char* start = ++p;
+			int depth = 1;
+			while (p != end) {
+				if (*p == '\\') throw Unsupported();
+				if (*p == '{') ++depth;
+				if ((*p == '}') && (--depth == 0)) break;
+				++p;
+			}
+			if (p == end) throw Unsupported();
+			word.literal.assign(start, p - start);
+			++p;
+			break;
+		}
+		case '"': {
+			const char* start = ++p;
+			while ((p != end) && (*p != '"')) {
+				if (strchr("$[\\", *p)) throw Unsupported();
+				++p;
+			}
+			if (p == end) throw Unsupported();
+			word.literal.assign(start, p - start);
+			++p;
+			break;
+		}
+		default: {
+			const char* start = p;
+			while ((p != end) && !strchr(" \t]", *p)) {
+				if (strchr("$[\\\"{};\n\r", *p)) throw Unsupported();
+				++p;
+			}
+			word.literal.assign(start, p - start);
+			break;
+		}
+		}
+		if (!atWordEnd()) throw Unsupported();
+		return true;
+	}
+
+	static NodePtr integerArg(Word& word)
+	{
+		if (word.node) {
+			checkNotBool(*word.node);
+			return std::move(word.node);
+		}
+		const char* b = word.literal.data();
+		const char* e = b + word.literal.size();
+		int64_t value;
+		if (!parseInteger(b, e, value) || (b != e)) throw Unsupported();
+		return make_unique<Constant>(value);
+	}
+
+	static const string& literalArg(const Word& word)
+	{
+		if (word.node) throw Unsupported();
+		return word.literal;
+	}
+
+	// Slot number as used by pc_in_slot, -1 means "X".
+	static int slotArg(const Word& word)
+	{
+		auto& str = literalArg(word);
+		if (str == "X") return -1;
+		if ((str.size() != 1) || (str[0] < '0') || (str[0] > '3')) {
+			throw Unsupported();
+		}
+		return str[0] - '0';
+	}
+
+	NodePtr parseCommand()
+	{
+		++p; // skip '['
+		vector<Word> words;
+		while (true) {
+			Word word;
+			if (!parseWord(word)) break;
+			words.push_back(std::move(word));
+		}
+		if (words.empty()) throw Unsupported();
+		string_ref name = literalArg(words[0]);
+		if (name.starts_with("::")) name = name.substr(2);
+		auto num = words.size();
+
+		if (name == "reg") {
+			if (num != 2) throw Unsupported();
+			string reg = StringOp::toLower(literalArg(words[1]));
+			for (auto& info : regTable) {
+				if (reg == info.name) {
+					return make_unique<Register>(info.getter);
+				}
+			}
+			throw Unsupported();
+		}
+		if (name == "debug") {
+			if ((num != 4) || (literalArg(words[1]) != "read")) {
+				throw Unsupported();
+			}
+			return make_unique<Peek>(integerArg(words[3]),
+			                         literalArg(words[2]),
+			                         false, false, false);
+		}
+		if (name == "expr") {
+			if (num != 2) throw Unsupported();
+			return Parser(literalArg(words[1])).parseExpression();
+		}
+		if ((name == "pc_in_slot") || (name == "watch_in_slot")) {
+			if ((num < 2) || (num > 4)) throw Unsupported();
+			int ps = slotArg(words[1]);
+			int ss = (num >= 3) ? slotArg(words[2]) : -1;
+			if ((num == 4) && (literalArg(words[3]) != "X")) {
+				// checking the mapper block is not supported
+				throw Unsupported();
+			}
+			NodePtr address;
+			if (name == "pc_in_slot") {
+				address = make_unique<Register>(
+					[](const CPURegs& r) -> unsigned { return r.getPC(); });
+			} else {
+				address = make_unique<Variable>("::wp_last_address");
+			}
+			return make_unique<InSlot>(std::move(address), ps, ss);
+		}
+
+		static const struct {
+			const char* name;
+			bool word, bigEndian, isSigned;
+		} peekTable[] = {
+			{ "peek",       false, false, false },
+			{ "peek8",      false, false, false },
+			{ "peek_u8",    false, false, false },
+			{ "peek_s8",    false, false, true  },
+			{ "peek16",     true,  false, false },
+			{ "peek16_LE",  true,  false, false },
+			{ "peek16_BE",  true,  true,  false },
+			{ "peek_u16",   true,  false, false },
+			{ "peek_u16LE", true,  false, false },
+			{ "peek_u16BE", true,  true,  false },
+			{ "peek_s16",   true,  false, true  },
+			{ "peek_s16LE", true,  false, true  },
+			{ "peek_s16BE", true,  true,  true  },
+		};
+		for (auto& info : peekTable) {
+			if (name != info.name) continue;
+			if ((num != 2) && (num != 3)) throw Unsupported();
+			string_ref debuggable = (num == 3)
+			                      ? string_ref(literalArg(words[2]))
+			                      : string_ref("memory");
+			return make_unique<Peek>(integerArg(words[1]), debuggable,
+			                         info.word, info.bigEndian,
+			                         info.isSigned);
+		}
+		throw Unsupported();
+	}
+
+	const char* p;
+	const char* const end;
+};
+
+} // namespace
+
+
+CompiledCondition::CompiledCondition(unique_ptr<Node> root_)
+	: root(std::move(root_))
+{
+}
+
+CompiledCondition::~CompiledCondition() = default;
+
+unique_ptr<CompiledCondition> CompiledCondition::compile(string_ref expression)
+{
+	try {
+		return unique_ptr<CompiledCondition>(new CompiledCondition(
+			Parser(expression).parseExpression()));
+	} catch (Unsupported&) {
+		return nullptr;
+	}
+}
+
+bool CompiledCondition::evaluate(MSXMotherBoard& motherBoard,
+                                 Interpreter& interp, bool& result) const
+{
+	try {
+		result = root->eval(motherBoard, interp) != 0;
+		return true;
+	} catch (CommandException&) {
+		return false;
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,62 @@
+#ifndef COMPILEDCONDITION_HH
+#define COMPILEDCONDITION_HH
+
+#include "string_ref.hh"
+#include <memory>
+
+namespace openmsx {
+
+class MSXMotherBoard;
+class Interpreter;
+
+/** Native version of a breakpoint/watchpoint/condition expression.
+ *
+ * Conditions are checked very often (e.g. a 'debug set_condition' is
+ * checked after every instruction), evaluating them via Tcl makes
+ * emulation very slow. This class can compile a subset of Tcl expressions
+ * into a tree of native nodes:
+ *  - integer literals and (global) '$variable' references
+ *  - the operators  ! ~ - + * / % << >> < <= > >= == != & ^ | && || ?:
+ *  - the commands [reg ...], [peek ...] (and its 8/16-bit, signed and
+ *    big endian variants), [debug read ...], [expr {...}] and the
+ *    [pc_in_slot ...] and [watch_in_slot ...] commands without the mapper
+ *    argument
+ * Expressions that use anything else are not compiled, those are still
+ * evaluated by Tcl.
+ */
+class CompiledCondition
+{
+public:
+	/** Try to compile the given expression.
+	 * @return nullptr if the expression contains unsupported constructs.
+	 */
+	static std::unique_ptr<CompiledCondition> compile(string_ref expression);
+
+	~CompiledCondition();
+
+	/** Evaluate the expression.
+	 * @param motherBoard The machine whose CPU registers, memory,
+	 *                    debuggables, ... are inspected.
+	 * @param interp Used to read Tcl variables.
+	 * @param result Output parameter, only valid when this method
+	 *               returns true.
+	 * @return false when the expression couldn't be evaluated natively
+	 *         (e.g. a referenced variable doesn't exist or contains a
+	 *         non-integer value, division by zero, ...). The caller
+	 *         should then let Tcl evaluate the original expression, that
+	 *         produces the proper result or error message.
+	 */
+	bool evaluate(MSXMotherBoard& motherBoard, Interpreter& interp,
+	              bool& result) const;
+
+	struct Node;
+
+private:
+	explicit CompiledCondition(std::unique_ptr<Node> root);
+
+	const std::unique_ptr<Node> root;
+};
+
+} // namespace openmsx
+
+#endif
@@ -21,6 +21,15 @@ class MSXCPUInterface;
 unsigned dasm(const MSXCPUInterface& interf, word pc, byte buf[4],
               std::string& dest, EmuTime::param time);
 
+/** Disassemble an instruction of which the bytes are already known.
+  * @param opcode The 4 bytes starting at 'pc' (an instruction is never
+  *               longer, only the bytes that form the instruction are used)
+  * @param pc The address of the instruction (for relative jumps)
+  * @param dest String representation of the disassembled opcode
+  * @return Length of the disassembled opcode in bytes
+  */
+unsigned dasm(const byte opcode[4], word pc, std::string& dest);
+
 } // namespace openmsx
 
 #endif
@@ -23,16 +23,19 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 	, traceSetting(
 		motherboard.getCommandController(), "cputrace",
 		"CPU tracing on/off", false, Setting::DONT_SAVE)
+	, trace(motherboard.getCommandController())
+	, profiler(motherboard)
+	, coverage(motherboard)
 	, diHaltCallback(
 		motherboard.getCommandController(), "di_halt_callback",
 		"Tcl proc called when the CPU executed a DI/HALT sequence")
 	, z80(make_unique<CPUCore<Z80TYPE>>(
-		motherboard, "z80", traceSetting,
+		motherboard, "z80", traceSetting, trace, profiler, coverage,
 		diHaltCallback, EmuTime::zero))
 	, r800(motherboard.isTurboR()
 		? make_unique<CPUCore<R800TYPE>>(
-			motherboard, "r800", traceSetting,
-			diHaltCallback, EmuTime::zero)
+			motherboard, "r800", traceSetting, trace, profiler,
+			coverage, diHaltCallback, EmuTime::zero)
 		: nullptr)
 	, timeInfo(motherboard.getMachineInfoCommand())
 	, z80FreqInfo(motherboard.getMachineInfoCommand(), "z80_freq", *z80)
@@ -49,6 +52,8 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 	motherboard.getDebugger().setCPU(this);
 	motherboard.getScheduler().setCPU(this);
 	traceSetting.attach(*this);
+	trace.getRecordSetting().attach(*this);
+	coverage.getSetting().attach(*this);
 
 	z80->freqLocked.attach(*this);
 	z80->freqValue.attach(*this);
@@ -61,6 +66,8 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 MSXCPU::~MSXCPU()
 {
 	traceSetting.detach(*this);
+	trace.getRecordSetting().detach(*this);
+	coverage.getSetting().detach(*this);
 	z80->freqLocked.detach(*this);
 	z80->freqValue.detach(*this);
 	if (r800) {
@@ -1,6 +1,9 @@
 #ifndef MSXCPU_HH
 #define MSXCPU_HH
 
+#include "CPUTrace.hh"
+#include "CPUProfiler.hh"
+#include "MemoryCoverage.hh"
 #include "InfoTopic.hh"
 #include "SimpleDebuggable.hh"
 #include "Observer.hh"
@@ -115,6 +118,8 @@ public:
 
 	CPURegs& getRegisters();
 
+	MemoryCoverage& getCoverage() { return coverage; }
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -135,6 +140,9 @@ private:
 
 	MSXMotherBoard& motherboard;
 	BooleanSetting traceSetting;
+	CPUTrace trace;
+	CPUProfiler profiler;
+	MemoryCoverage coverage;
 	TclCallback diHaltCallback;
 	const std::unique_ptr<CPUCore<Z80TYPE>> z80;
 	const std::unique_ptr<CPUCore<R800TYPE>> r800; // can be nullptr
@@ -54,6 +54,7 @@ static unsigned breakedSettingCount = 0;
 static const byte SECUNDARY_SLOT_BIT = 0x01;
 static const byte MEMORY_WATCH_BIT   = 0x02;
 static const byte GLOBAL_WRITE_BIT   = 0x04;
+static const byte COVERAGE_BIT       = 0x08;
 
 
 MSXCPUInterface::MSXCPUInterface(MSXMotherBoard& motherBoard_)
@@ -181,6 +182,8 @@ byte MSXCPUInterface::readMemSlow(word address, EmuTime::param time)
 		                [address &  CacheLine::LOW]) {
 			executeMemWatch(WatchPoint::READ_MEM, address);
 		}
+		// coverage of reads is recorded in CPUCore::RDMEMslow(),
+		// only the CPU knows whether this is an instruction fetch
 	}
 	if (unlikely((address == 0xFFFF) && isExpanded(primarySlotState[3]))) {
 		return 0xFF ^ subSlotRegister[primarySlotState[3]];
@@ -214,7 +217,41 @@ void MSXCPUInterface::writeMemSlow(word address, byte value, EmuTime::param time
 		                 [address &  CacheLine::LOW]) {
 			executeMemWatch(WatchPoint::WRITE_MEM, address, value);
 		}
+		auto& coverage = msxcpu.getCoverage();
+		if (coverage.isActive()) {
+			coverage.access(address, MemoryCoverage::WRITTEN);
+		}
+	}
+}
+
+void MSXCPUInterface::setCoverage(bool enabled)
+{
+	for (unsigned i = 0; i < CacheLine::NUM; ++i) {
+		if (enabled) {
+			disallowReadCache [i] |=  COVERAGE_BIT;
+			disallowWriteCache[i] |=  COVERAGE_BIT;
+		} else {
+			disallowReadCache [i] &= ~COVERAGE_BIT;
+			disallowWriteCache[i] &= ~COVERAGE_BIT;
+		}
+	}
+	msxcpu.invalidateMemCache(0x0000, 0x10000);
+}
+
+const byte* MSXCPUInterface::getReadWatchCacheLine(word start) const
+{
+	if (disallowReadCache[start >> CacheLine::BITS] != MEMORY_WATCH_BIT) {
+		return nullptr;
+	}
+	return visibleDevices[start >> 14]->getReadCacheLine(start);
+}
+
+byte* MSXCPUInterface::getWriteWatchCacheLine(word start) const
+{
+	if (disallowWriteCache[start >> CacheLine::BITS] != MEMORY_WATCH_BIT) {
+		return nullptr;
 	}
+	return visibleDevices[start >> 14]->getWriteCacheLine(start);
 }
 
 void MSXCPUInterface::setExpanded(int ps)
@@ -523,6 +560,7 @@ void MSXCPUInterface::unregisterMemDevice(
 		base += partialSize;
 		size -= partialSize;
 	}
+	msxcpu.getCoverage().invalidate();
 }
 
 void MSXCPUInterface::registerGlobalWrite(MSXDevice& device, word address)
@@ -724,11 +762,18 @@ void MSXCPUInterface::checkBreakPoints(
 	auto& globalCliComm = motherBoard.getReactor().getGlobalCliComm();
 	auto& interp        = motherBoard.getReactor().getInterpreter();
 	for (auto& p : bpCopy) {
-		p.checkAndExecute(globalCliComm, interp);
+		p.checkAndExecute(globalCliComm, interp, motherBoard);
+	}
+	// Conditions are checked after every instruction and usually they
+	// are false, so avoid making a copy when it's known to be unneeded.
+	if (none_of(begin(conditions), end(conditions),
+	            [&](const DebugCondition& c) {
+	                    return c.mightTrigger(interp, motherBoard); })) {
+		return;
 	}
 	auto condCopy = conditions;
 	for (auto& c : condCopy) {
-		c.checkAndExecute(globalCliComm, interp);
+		c.checkAndExecute(globalCliComm, interp, motherBoard);
 	}
 }
 
@@ -876,14 +921,19 @@ void MSXCPUInterface::executeMemWatch(WatchPoint::Type type,
 		                   TclObject(int(value)));
 	}
 
-	auto wpCopy = watchPoints;
-	for (auto& w : wpCopy) {
+	// Only copy the matching watchpoints (a callback may remove them),
+	// there can be many others.
+	WatchPoints matching;
+	for (auto& w : watchPoints) {
 		if ((w->getBeginAddress() <= address) &&
 		    (w->getEndAddress()   >= address) &&
 		    (w->getType()         == type)) {
-			w->checkAndExecute(globalCliComm, interp);
+			matching.push_back(w);
 		}
 	}
+	for (auto& w : matching) {
+		w->checkAndExecute(globalCliComm, interp, motherBoard);
+	}
 
 	interp.unsetVariable("wp_last_address");
 	interp.unsetVariable("wp_last_value");
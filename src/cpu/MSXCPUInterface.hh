@@ -177,6 +177,34 @@ public:
 		return visibleDevices[start >> 14]->getWriteCacheLine(start);
 	}
 
+	/**
+	 * Like getReadCacheLine()/getWriteCacheLine(), but for a cache line
+	 * that is uncacheable only because it contains watched addresses.
+	 * The CPU may access the addresses in such a line that are not
+	 * watched (see isReadWatched()/isWriteWatched()) via the returned
+	 * buffer. Returns a null pointer if that's not possible.
+	 */
+	const byte* getReadWatchCacheLine(word start) const;
+	byte* getWriteWatchCacheLine(word start) const;
+
+	/**
+	 * Make all memory uncacheable (or cacheable again), so that all
+	 * CPU memory accesses can be recorded by MemoryCoverage.
+	 */
+	void setCoverage(bool enabled);
+
+	/**
+	 * Is there a read/write watchpoint on the given address?
+	 */
+	bool isReadWatched(word address) const {
+		return readWatchSet[address >> CacheLine::BITS]
+		                   [address &  CacheLine::LOW];
+	}
+	bool isWriteWatched(word address) const {
+		return writeWatchSet[address >> CacheLine::BITS]
+		                    [address &  CacheLine::LOW];
+	}
+
 	/**
 	 * CPU uses this method to read 'extra' data from the databus
 	 * used in interrupt routines. In MSX this returns always 255.
@@ -203,6 +231,15 @@ public:
 	void unsetExpanded(int ps);
 	void testUnsetExpanded(int ps, std::vector<MSXDevice*> allowed) const;
 	inline bool isExpanded(int ps) const { return expanded[ps] != 0; }
+
+	/** The currently selected primary/secondary slot in the given page.
+	 * The secondary slot is only meaningful when the primary slot is
+	 * expanded.
+	 */
+	int getPrimarySlot  (int page) const { return primarySlotState  [page]; }
+	int getSecondarySlot(int page) const { return secondarySlotState[page]; }
+	/** The device that is currently visible in the given page. */
+	MSXDevice* getVisibleMSXDevice(int page) const { return visibleDevices[page]; }
 	void changeExpanded(bool isExpanded);
 
 	DummyDevice& getDummyDevice() { return *dummyDevice; }
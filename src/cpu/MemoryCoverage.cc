@@ -0,0 +1,310 @@
+#include "MemoryCoverage.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXCPUInterface.hh"
+#include "MSXMemoryMapper.hh"
+#include "MSXRom.hh"
+#include "CommandException.hh"
+#include "File.hh"
+#include "FileContext.hh"
+#include "FileOperations.hh"
+#include "TclObject.hh"
+#include "endian.hh"
+#include "outer.hh"
+#include <algorithm>
+#include <cstring>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+static const char COVERAGE_MAGIC[8] = { 'o','M','S','X','c','o','v','1' };
+static const byte TYPES[3] = {
+	MemoryCoverage::EXECUTED, MemoryCoverage::READ, MemoryCoverage::WRITTEN
+};
+
+MemoryCoverage::MemoryCoverage(MSXMotherBoard& motherBoard_)
+	: motherBoard(motherBoard_)
+	, setting(motherBoard.getCommandController(), "coverage",
+		"record which memory gets executed, read and written, "
+		"see 'coverage_data'", false, Setting::DONT_SAVE)
+	, cmd(motherBoard.getCommandController())
+	, active(false)
+{
+	invalidate();
+	setting.attach(*this);
+}
+
+MemoryCoverage::~MemoryCoverage()
+{
+	setting.detach(*this);
+}
+
+void MemoryCoverage::update(const Setting& /*setting*/)
+{
+	active = setting.getBoolean();
+	invalidate();
+	motherBoard.getCPUInterface().setCoverage(active);
+}
+
+void MemoryCoverage::invalidate()
+{
+	for (auto& page : pages) {
+		page.device = nullptr;
+	}
+}
+
+void MemoryCoverage::updatePage(Page& page, const MSXDevice& device)
+{
+	page.device = &device;
+	page.mapper = dynamic_cast<const MSXMemoryMapper*>(&device);
+	page.rom    = dynamic_cast<const MSXRom*>(&device);
+	page.region = (page.mapper || page.rom) ? &regions[device.getName()]
+	                                        : nullptr;
+	page.fallback = &regions[device.getName() + " (Z80)"];
+}
+
+void MemoryCoverage::access(word address, byte type)
+{
+	int p = address >> 14;
+	auto* device = motherBoard.getCPUInterface().getVisibleMSXDevice(p);
+	auto& page = pages[p];
+	if (page.device != device) updatePage(page, *device);
+
+	if (page.mapper) {
+		page.region->mark((page.mapper->getSegment(address) << 14) |
+		                  (address & 0x3FFF), type);
+		return;
+	}
+	if (page.rom) {
+		int offset = page.rom->getRomOffset(address);
+		if (offset != -1) {
+			page.region->mark(offset, type);
+			return;
+		}
+	}
+	page.fallback->mark(address, type);
+}
+
+void MemoryCoverage::access(const string& region, unsigned offset, byte type)
+{
+	regions[region].mark(offset, type);
+}
+
+const MemoryCoverage::Region& MemoryCoverage::getRegion(const string& name) const
+{
+	auto it = regions.find(name);
+	if (it == end(regions)) {
+		throw CommandException("No such coverage region: " + name);
+	}
+	return it->second;
+}
+
+// File layout (all numbers little endian):
+//   magic "oMSXcov1", number of regions (32-bit)
+//   per region: length of the name (32-bit), the name, size (32-bit),
+//               3 bitmaps (executed, read, written) of (size + 7) / 8 bytes
+void MemoryCoverage::save(const string& filename) const
+{
+	vector<byte> data(COVERAGE_MAGIC, COVERAGE_MAGIC + sizeof(COVERAGE_MAGIC));
+	auto add32 = [&](uint32_t value) {
+		byte buf[4];
+		Endian::write_UA_L32(buf, value);
+		data.insert(end(data), buf, buf + 4);
+	};
+	add32(uint32_t(regions.size()));
+	for (auto& r : regions) {
+		add32(uint32_t(r.first.size()));
+		data.insert(end(data), r.first.begin(), r.first.end());
+		auto& flags = r.second.flags;
+		add32(uint32_t(flags.size()));
+		for (byte type : TYPES) {
+			size_t pos = data.size();
+			data.resize(pos + (flags.size() + 7) / 8);
+			for (size_t i = 0; i < flags.size(); ++i) {
+				if (flags[i] & type) {
+					data[pos + i / 8] |= 1 << (i % 8);
+				}
+			}
+		}
+	}
+	File file(filename, File::TRUNCATE);
+	file.write(data.data(), data.size());
+}
+
+void MemoryCoverage::merge(const string& filename)
+{
+	File file(filename);
+	size_t size;
+	const byte* data = file.mmap(size);
+	const byte* last = data + size;
+	auto error = [&]() {
+		return CommandException("Not a coverage file: " + filename);
+	};
+	auto read32 = [&]() {
+		if ((last - data) < 4) throw error();
+		uint32_t result = Endian::read_UA_L32(data);
+		data += 4;
+		return result;
+	};
+	if ((size < sizeof(COVERAGE_MAGIC)) ||
+	    (memcmp(data, COVERAGE_MAGIC, sizeof(COVERAGE_MAGIC)) != 0)) {
+		throw error();
+	}
+	data += sizeof(COVERAGE_MAGIC);
+
+	// first check the whole file, only then merge it
+	vector<std::pair<string, vector<byte>>> newRegions;
+	uint32_t num = read32();
+	for (uint32_t i = 0; i < num; ++i) {
+		uint32_t nameLen = read32();
+		if (uint32_t(last - data) < nameLen) throw error();
+		string name(reinterpret_cast<const char*>(data), nameLen);
+		data += nameLen;
+		uint32_t regionSize = read32();
+		size_t bitmapSize = (size_t(regionSize) + 7) / 8;
+		if (size_t(last - data) < 3 * bitmapSize) throw error();
+		vector<byte> flags(regionSize);
+		for (byte type : TYPES) {
+			for (uint32_t j = 0; j < regionSize; ++j) {
+				if (data[j / 8] & (1 << (j % 8))) flags[j] |= type;
+			}
+			data += bitmapSize;
+		}
+		newRegions.emplace_back(std::move(name), std::move(flags));
+	}
+	if (data != last) throw error();
+
+	for (auto& n : newRegions) {
+		auto& flags = regions[n.first].flags;
+		if (flags.size() < n.second.size()) {
+			flags.resize(n.second.size());
+		}
+		for (size_t i = 0; i < n.second.size(); ++i) {
+			flags[i] |= n.second[i];
+		}
+	}
+}
+
+
+// class Cmd
+
+MemoryCoverage::Cmd::Cmd(CommandController& commandController)
+	: Command(commandController, "coverage_data")
+{
+}
+
+static byte parseType(string_ref str)
+{
+	if (str == "executed") return MemoryCoverage::EXECUTED;
+	if (str == "read")     return MemoryCoverage::READ;
+	if (str == "written")  return MemoryCoverage::WRITTEN;
+	throw CommandException("Unknown access type: " + str +
+	                       " (must be one of executed, read or written)");
+}
+
+void MemoryCoverage::Cmd::execute(array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() < 2) {
+		throw SyntaxError();
+	}
+	auto& coverage = OUTER(MemoryCoverage, cmd);
+	auto& interp = getInterpreter();
+	string_ref subCmd = tokens[1].getString();
+	if (subCmd == "regions") {
+		if (tokens.size() != 2) throw SyntaxError();
+		for (auto& r : coverage.regions) {
+			result.addListElement(r.first);
+		}
+	} else if (subCmd == "get") {
+		// get <region> <offset>
+		if (tokens.size() != 4) throw SyntaxError();
+		auto& flags = coverage.getRegion(tokens[2].getString().str()).flags;
+		unsigned offset = tokens[3].getInt(interp);
+		byte f = (offset < flags.size()) ? flags[offset] : 0;
+		if (f & EXECUTED) result.addListElement("executed");
+		if (f & READ)     result.addListElement("read");
+		if (f & WRITTEN)  result.addListElement("written");
+	} else if (subCmd == "count") {
+		// count <region> <type>
+		if (tokens.size() != 4) throw SyntaxError();
+		auto& flags = coverage.getRegion(tokens[2].getString().str()).flags;
+		byte type = parseType(tokens[3].getString());
+		result.setInt(int(std::count_if(begin(flags), end(flags),
+			[&](byte f) { return (f & type) != 0; })));
+	} else if (subCmd == "ranges") {
+		// ranges <region> <type>
+		if (tokens.size() != 4) throw SyntaxError();
+		auto& flags = coverage.getRegion(tokens[2].getString().str()).flags;
+		byte type = parseType(tokens[3].getString());
+		size_t i = 0;
+		while (i < flags.size()) {
+			if (!(flags[i] & type)) { ++i; continue; }
+			size_t first = i;
+			while ((i < flags.size()) && (flags[i] & type)) ++i;
+			TclObject range;
+			range.addListElement(int(first));
+			range.addListElement(int(i - 1));
+			result.addListElement(range);
+		}
+	} else if (subCmd == "clear") {
+		if (tokens.size() != 2) throw SyntaxError();
+		for (auto& r : coverage.regions) {
+			auto& flags = r.second.flags;
+			std::fill(begin(flags), end(flags), 0);
+		}
+	} else if ((subCmd == "save") || (subCmd == "merge")) {
+		if (tokens.size() != 3) throw SyntaxError();
+		string filename = FileOperations::expandTilde(
+			tokens[2].getString().str());
+		try {
+			if (subCmd == "save") {
+				coverage.save(filename);
+			} else {
+				coverage.merge(filename);
+			}
+		} catch (MSXException& e) {
+			throw CommandException(e.getMessage());
+		}
+	} else {
+		throw CommandException("Unknown subcommand: " + subCmd);
+	}
+}
+
+string MemoryCoverage::Cmd::help(const vector<string>& /*tokens*/) const
+{
+	return "Inspect the data recorded when the 'coverage' setting is enabled.\n"
+	       "  coverage_data regions                  list of regions (devices) with recorded data\n"
+	       "  coverage_data get <region> <offset>    how the given byte was accessed (executed, read, written)\n"
+	       "  coverage_data count <region> <type>    number of bytes that were executed/read/written\n"
+	       "  coverage_data ranges <region> <type>   list of {<begin> <end>} ranges that were executed/read/written\n"
+	       "  coverage_data clear                    forget all recorded data\n"
+	       "  coverage_data save <filename>          save all recorded data in a file\n"
+	       "  coverage_data merge <filename>         add the data from a saved file to the recorded data\n";
+}
+
+void MemoryCoverage::Cmd::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static const char* const subCmds[] = {
+			"regions", "get", "count", "ranges", "clear", "save", "merge"
+		};
+		completeString(tokens, subCmds);
+	} else if ((tokens.size() == 3) &&
+	           ((tokens[1] == "save") || (tokens[1] == "merge"))) {
+		completeFileName(tokens, userFileContext());
+	} else if (tokens.size() == 3) {
+		auto& coverage = OUTER(MemoryCoverage, cmd);
+		vector<string> names;
+		for (auto& r : coverage.regions) names.push_back(r.first);
+		completeString(tokens, names);
+	} else if ((tokens.size() == 4) &&
+	           ((tokens[1] == "count") || (tokens[1] == "ranges"))) {
+		static const char* const types[] = {
+			"executed", "read", "written"
+		};
+		completeString(tokens, types);
+	}
+}
+
+} // namespace openmsx
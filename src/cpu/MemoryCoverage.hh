@@ -0,0 +1,111 @@
+#ifndef MEMORYCOVERAGE_HH
+#define MEMORYCOVERAGE_HH
+
+#include "Command.hh"
+#include "BooleanSetting.hh"
+#include "Observer.hh"
+#include "openmsx.hh"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class MSXMotherBoard;
+class MSXDevice;
+class MSXMemoryMapper;
+class MSXRom;
+
+/** Records which memory was executed, read and written.
+ *
+ * When the 'coverage' setting is enabled, every CPU memory access is
+ * recorded per byte, in a 'region' per device:
+ *  - for memory mappers the offset in the mapper RAM (so the segment is
+ *    taken into account)
+ *  - for ROM mappers the offset in the ROM image
+ *  - for other devices (or e.g. the SRAM of a ROM mapper) the address in
+ *    the Z80 address space, these regions are called '<device> (Z80)'
+ * The VDP also records the accesses to its VRAM (region 'physical VRAM').
+ * Executed means: fetched as part of an instruction (opcode, prefixes or
+ * operands), those fetches are not recorded as read.
+ *
+ * While recording, all CPU memory accesses go via the slow path (the
+ * CPU doesn't use its memory cache). When disabled there's no overhead.
+ */
+class MemoryCoverage final : private Observer<Setting>
+{
+public:
+	enum { EXECUTED = 1, READ = 2, WRITTEN = 4 };
+
+	explicit MemoryCoverage(MSXMotherBoard& motherBoard);
+	~MemoryCoverage();
+
+	BooleanSetting& getSetting() { return setting; }
+
+	/** In sync with the 'coverage' setting. */
+	bool isActive() const { return active; }
+
+	/** Record a CPU access to the given address. Only call this when
+	  * isActive() returns true.
+	  * @param type One of EXECUTED, READ or WRITTEN.
+	  */
+	void access(word address, byte type);
+
+	/** Record an access to an offset in the given region. Only call this
+	  * when isActive() returns true.
+	  */
+	void access(const std::string& region, unsigned offset, byte type);
+
+	/** Must be called when a device gets removed from the address space.
+	  */
+	void invalidate();
+
+private:
+	struct Region {
+		void mark(unsigned offset, byte type)
+		{
+			if (offset >= flags.size()) {
+				flags.resize((offset | 0x3FFF) + 1);
+			}
+			flags[offset] |= type;
+		}
+		std::vector<byte> flags;
+	};
+	struct Page {
+		const MSXDevice* device;
+		const MSXMemoryMapper* mapper; // nullptr if not a mapper
+		const MSXRom* rom;             // nullptr if not a ROM
+		Region* region;   // mapper RAM or ROM image
+		Region* fallback; // Z80 address space
+	};
+
+	// Observer<Setting>
+	void update(const Setting& setting) override;
+
+	void updatePage(Page& page, const MSXDevice& device);
+	const Region& getRegion(const std::string& name) const;
+	void save(const std::string& filename) const;
+	void merge(const std::string& filename);
+
+	MSXMotherBoard& motherBoard;
+	BooleanSetting setting;
+
+	class Cmd final : public Command {
+	public:
+		explicit Cmd(CommandController& commandController);
+		void execute(array_ref<TclObject> tokens,
+		             TclObject& result) override;
+		std::string help(const std::vector<std::string>& tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} cmd;
+
+	// Regions are never removed (clearing only resets the flags), so
+	// pointers to them stay valid.
+	std::map<std::string, Region> regions;
+	Page pages[4];
+	bool active;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,310 @@
+#include "DebugSubscriptions.hh"
+#include "Debugger.hh"
+#include "Debuggable.hh"
+#include "Probe.hh"
+#include "MSXMotherBoard.hh"
+#include "Reactor.hh"
+#include "EventDistributor.hh"
+#include "CliComm.hh"
+#include "EmuTime.hh"
+#include "TclObject.hh"
+#include "CommandException.hh"
+#include "Observer.hh"
+#include "StringOp.hh"
+#include "stl.hh"
+#include "memory.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+class DebugSubscriptions::Subscription
+{
+public:
+	virtual ~Subscription() {}
+
+	unsigned getId() const { return id; }
+
+	/** The parameters of this subscription, as shown by 'list'. */
+	virtual void describe(TclObject& result) const = 0;
+
+	/** Append the changes since the previous call to 'result'.
+	  * Returns false (and leaves 'result' untouched) when nothing changed.
+	  */
+	virtual bool collect(TclObject& result, EmuTime::param time) = 0;
+
+	/** Make the same subscription in 'target'. */
+	virtual void copyTo(DebugSubscriptions& target) const = 0;
+
+protected:
+	explicit Subscription(unsigned id_) : id(id_) {}
+
+private:
+	const unsigned id;
+};
+
+static double toSeconds(EmuTime::param time)
+{
+	return (time - EmuTime::zero).toDouble();
+}
+
+
+// Reports the value of a probe (and the time it got that value).
+class DebugSubscriptions::ProbeSubscription final
+	: public Subscription, private Observer<ProbeBase>
+{
+public:
+	ProbeSubscription(DebugSubscriptions& parent_, ProbeBase& probe_,
+	                  unsigned id_)
+		: Subscription(id_)
+		, parent(parent_)
+		, probe(probe_)
+		, changeTime(EmuTime::zero)
+		, changed(true) // also report the initial value
+	{
+		probe.attach(*this);
+	}
+
+	~ProbeSubscription()
+	{
+		probe.detach(*this);
+	}
+
+	void describe(TclObject& result) const override
+	{
+		result.addListElement("probe");
+		result.addListElement(probe.getName());
+	}
+
+	bool collect(TclObject& result, EmuTime::param time) override
+	{
+		if (!changed) return false;
+		changed = false;
+		// the initial value has no change time
+		result.addListElement(toSeconds(
+			(changeTime == EmuTime::zero) ? time : changeTime));
+		result.addListElement(probe.getValue());
+		return true;
+	}
+
+	void copyTo(DebugSubscriptions& target) const override
+	{
+		if (auto* p = target.debugger.findProbe(probe.getName())) {
+			target.subscribeProbe(*p, getId());
+		}
+	}
+
+private:
+	// Observer<ProbeBase>
+	void update(const ProbeBase& /*subject*/) override
+	{
+		changeTime = parent.debugger.getMotherBoard().getCurrentTime();
+		changed = true;
+	}
+
+	void subjectDeleted(const ProbeBase& /*subject*/) override
+	{
+		parent.remove(*this);
+	}
+
+	DebugSubscriptions& parent;
+	ProbeBase& probe;
+	EmuTime changeTime;
+	bool changed;
+};
+
+
+// Reports the changed bytes in a range of a debuggable. The debuggable is
+// looked up by name on each delivery, it can (temporarily) disappear, e.g.
+// when an extension is removed.
+class DebugSubscriptions::DebuggableSubscription final : public Subscription
+{
+public:
+	DebuggableSubscription(Debugger& debugger_, string name_,
+	                       unsigned begin_, unsigned size_, unsigned id_)
+		: Subscription(id_)
+		, debugger(debugger_)
+		, name(std::move(name_))
+		, begin(begin_)
+		, size(size_)
+	{
+	}
+
+	void describe(TclObject& result) const override
+	{
+		result.addListElement("debuggable");
+		result.addListElement(name);
+		result.addListElement(int(begin));
+		result.addListElement(int(size));
+	}
+
+	bool collect(TclObject& result, EmuTime::param time) override
+	{
+		auto* debuggable = debugger.findDebuggable(name);
+		unsigned debuggableSize = debuggable ? debuggable->getSize() : 0;
+		if (debuggableSize <= begin) {
+			// report everything again when it reappears
+			snapshot.clear();
+			return false;
+		}
+		unsigned num = std::min(size, debuggableSize - begin);
+		current.resize(num);
+		debuggable->readBlock(begin, current.data(), num);
+
+		if (snapshot.size() != num) {
+			// first delivery (or the debuggable changed size)
+			snapshot.assign(num, 0);
+			result.addListElement(toSeconds(time));
+			addRun(result, 0, num);
+		} else if (memcmp(snapshot.data(), current.data(), num) == 0) {
+			return false;
+		} else {
+			result.addListElement(toSeconds(time));
+			unsigned i = 0;
+			while (i < num) {
+				if (snapshot[i] == current[i]) { ++i; continue; }
+				unsigned first = i;
+				while ((i < num) && (snapshot[i] != current[i])) ++i;
+				addRun(result, first, i);
+			}
+		}
+		snapshot.swap(current);
+		return true;
+	}
+
+	void copyTo(DebugSubscriptions& target) const override
+	{
+		target.subscribeDebuggable(name, begin, size, getId());
+	}
+
+private:
+	// a run is {<address> <byte> <byte> ...}
+	void addRun(TclObject& result, unsigned first, unsigned last) const
+	{
+		TclObject run;
+		run.addListElement(int(begin + first));
+		for (unsigned i = first; i < last; ++i) {
+			run.addListElement(int(current[i]));
+		}
+		result.addListElement(run);
+	}
+
+	Debugger& debugger;
+	const string name;
+	const unsigned begin;
+	const unsigned size;
+	vector<byte> snapshot; // values at the previous delivery
+	vector<byte> current;
+};
+
+
+unsigned DebugSubscriptions::lastId = 0;
+
+DebugSubscriptions::DebugSubscriptions(Debugger& debugger_)
+	: debugger(debugger_)
+{
+	auto& distributor = debugger.getMotherBoard().getReactor().getEventDistributor();
+	distributor.registerEventListener(OPENMSX_FINISH_FRAME_EVENT, *this);
+	distributor.registerEventListener(OPENMSX_BREAK_EVENT, *this);
+}
+
+DebugSubscriptions::~DebugSubscriptions()
+{
+	auto& distributor = debugger.getMotherBoard().getReactor().getEventDistributor();
+	distributor.unregisterEventListener(OPENMSX_BREAK_EVENT, *this);
+	distributor.unregisterEventListener(OPENMSX_FINISH_FRAME_EVENT, *this);
+}
+
+unsigned DebugSubscriptions::subscribeProbe(ProbeBase& probe,
+                                            unsigned newId /*= -1*/)
+{
+	unsigned id = (newId == unsigned(-1)) ? ++lastId : newId;
+	subscriptions.push_back(make_unique<ProbeSubscription>(*this, probe, id));
+	return id;
+}
+
+unsigned DebugSubscriptions::subscribeDebuggable(
+	string debuggable, unsigned begin, unsigned size,
+	unsigned newId /*= -1*/)
+{
+	unsigned id = (newId == unsigned(-1)) ? ++lastId : newId;
+	subscriptions.push_back(make_unique<DebuggableSubscription>(
+		debugger, std::move(debuggable), begin, size, id));
+	return id;
+}
+
+void DebugSubscriptions::unsubscribe(string_ref name)
+{
+	if (name.starts_with("sub#")) {
+		try {
+			unsigned id = fast_stou(name.substr(4));
+			auto it = find_if(begin(subscriptions), end(subscriptions),
+				[&](const std::unique_ptr<Subscription>& s) {
+					return s->getId() == id; });
+			if (it != end(subscriptions)) {
+				move_pop_back(subscriptions, it);
+				return;
+			}
+		} catch (std::invalid_argument&) {
+			// parse error in fast_stou()
+		}
+	}
+	throw CommandException("No such subscription: " + name);
+}
+
+void DebugSubscriptions::remove(Subscription& subscription)
+{
+	move_pop_back(subscriptions, rfind_if_unguarded(subscriptions,
+		[&](const std::unique_ptr<Subscription>& s) {
+			return s.get() == &subscription; }));
+}
+
+string DebugSubscriptions::list() const
+{
+	string result;
+	for (auto& s : subscriptions) {
+		TclObject line;
+		line.addListElement(StringOp::Builder() << "sub#" << s->getId());
+		s->describe(line);
+		result += line.getString() + '\n';
+	}
+	return result;
+}
+
+void DebugSubscriptions::flush()
+{
+	auto& motherBoard = debugger.getMotherBoard();
+	EmuTime time = motherBoard.getCurrentTime();
+	auto& cliComm = motherBoard.getMSXCliComm();
+	for (auto& s : subscriptions) {
+		TclObject changes;
+		if (s->collect(changes, time)) {
+			cliComm.update(CliComm::DEBUG_UPDATE,
+			               StringOp::Builder() << "sub#" << s->getId(),
+			               changes.getString());
+		}
+	}
+}
+
+void DebugSubscriptions::transfer(DebugSubscriptions& other)
+{
+	assert(subscriptions.empty());
+	for (auto& s : other.subscriptions) {
+		s->copyTo(*this);
+	}
+}
+
+int DebugSubscriptions::signalEvent(const std::shared_ptr<const Event>& /*event*/)
+{
+	if (!subscriptions.empty()) {
+		flush();
+	}
+	return 0;
+}
+
+} // namespace openmsx
@@ -0,0 +1,70 @@
+#ifndef DEBUGSUBSCRIPTIONS_HH
+#define DEBUGSUBSCRIPTIONS_HH
+
+#include "EventListener.hh"
+#include "string_ref.hh"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class Debugger;
+class ProbeBase;
+class TclObject;
+
+/** Push-based alternative for polling probes and debuggables.
+ *
+ * A client (typically an external debugger connected via a CliConnection)
+ * subscribes to a probe or to a range in a debuggable (e.g. a part of the
+ * RAM or the 'VDP regs' debuggable). The changes are collected and
+ * delivered as 'debug' updates once per frame and when the emulation
+ * breaks. So the client only has to enable those updates instead of
+ * reading all values every frame.
+ *
+ * Probes notify their observers, so a probe subscription costs nothing
+ * until the probe changes. Multiple changes between two deliveries are
+ * coalesced: only the last value (and the time of that change) is
+ * reported. Debuggables don't have such a notification (e.g. the CPU
+ * writes directly to RAM), so those ranges are compared with a copy on
+ * each delivery, only the changed bytes are reported.
+ */
+class DebugSubscriptions final : private EventListener
+{
+public:
+	explicit DebugSubscriptions(Debugger& debugger);
+	~DebugSubscriptions();
+
+	/** Returns the id of the new subscription. */
+	unsigned subscribeProbe(ProbeBase& probe, unsigned newId = -1);
+	unsigned subscribeDebuggable(std::string debuggable, unsigned begin,
+	                             unsigned size, unsigned newId = -1);
+	/** Remove a subscription, the name has the form 'sub#<id>'. */
+	void unsubscribe(string_ref name);
+	/** One line per subscription. */
+	std::string list() const;
+
+	/** Deliver the changes since the previous delivery. */
+	void flush();
+
+	void transfer(DebugSubscriptions& other);
+
+private:
+	class Subscription;
+	class ProbeSubscription;
+	class DebuggableSubscription;
+
+	void remove(Subscription& subscription);
+
+	// EventListener
+	int signalEvent(const std::shared_ptr<const Event>& event) override;
+
+	Debugger& debugger;
+	std::vector<std::unique_ptr<Subscription>> subscriptions;
+
+	static unsigned lastId;
+};
+
+} // namespace openmsx
+
+#endif
@@ -14,6 +14,25 @@ public:
 	virtual byte read(unsigned address) = 0;
 	virtual void write(unsigned address, byte value) = 0;
 
+	/** Read/write 'num' consecutive bytes, starting at 'address'. The
+	  * caller must make sure the whole block is inside the debuggable.
+	  * The default implementation calls read()/write() for each byte,
+	  * debuggables with a plain memory buffer can override these to
+	  * transfer the whole block at once.
+	  */
+	virtual void readBlock(unsigned address, byte* output, unsigned num)
+	{
+		for (unsigned i = 0; i < num; ++i) {
+			output[i] = read(address + i);
+		}
+	}
+	virtual void writeBlock(unsigned address, const byte* input, unsigned num)
+	{
+		for (unsigned i = 0; i < num; ++i) {
+			write(address + i, input[i]);
+		}
+	}
+
 protected:
 	Debuggable() {}
 	~Debuggable() {}
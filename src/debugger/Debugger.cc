@@ -11,6 +11,7 @@
 #include "TclObject.hh"
 #include "CommandException.hh"
 #include "MemBuffer.hh"
+#include "Base64.hh"
 #include "StringOp.hh"
 #include "KeyRange.hh"
 #include "stl.hh"
@@ -33,6 +34,7 @@ Debugger::Debugger(MSXMotherBoard& motherBoard_)
 	, cmd(motherBoard.getCommandController(),
 	      motherBoard.getStateChangeDistributor(),
 	      motherBoard.getScheduler())
+	, subscriptions(*this)
 	, cpu(nullptr)
 {
 }
@@ -183,6 +185,9 @@ void Debugger::transfer(Debugger& other)
 		}
 	}
 
+	// Copy subscriptions to new machine.
+	subscriptions.transfer(other.subscriptions);
+
 	// Breakpoints and conditions are (currently) global, so no need to
 	// copy those.
 }
@@ -213,12 +218,13 @@ Debugger::Cmd::Cmd(CommandController& commandController_,
 bool Debugger::Cmd::needRecord(array_ref<TclObject> tokens) const
 {
 	// Note: it's crucial for security that only the write and write_block
-	// subcommands are recorded and replayed. The 'set_bp' command for
+	// (and write_block_base64) subcommands are recorded and replayed. The 'set_bp' command for
 	// example would allow to set a callback that can execute arbitrary Tcl
 	// code. See comments in RecordedCommand for more details.
 	if (tokens.size() < 2) return false;
 	string_ref subCmd = tokens[1].getString();
-	return (subCmd == "write") || (subCmd == "write_block");
+	return (subCmd == "write") || (subCmd == "write_block") ||
+	       (subCmd == "write_block_base64");
 }
 
 void Debugger::Cmd::execute(
@@ -231,11 +237,15 @@ void Debugger::Cmd::execute(
 	if (subCmd == "read") {
 		read(tokens, result);
 	} else if (subCmd == "read_block") {
-		readBlock(tokens, result);
+		readBlock(tokens, result, false);
+	} else if (subCmd == "read_block_base64") {
+		readBlock(tokens, result, true);
 	} else if (subCmd == "write") {
 		write(tokens, result);
 	} else if (subCmd == "write_block") {
-		writeBlock(tokens, result);
+		writeBlock(tokens, result, false);
+	} else if (subCmd == "write_block_base64") {
+		writeBlock(tokens, result, true);
 	} else if (subCmd == "size") {
 		size(tokens, result);
 	} else if (subCmd == "desc") {
@@ -272,6 +282,12 @@ void Debugger::Cmd::execute(
 		listConditions(tokens, result);
 	} else if (subCmd == "probe") {
 		probe(tokens, result);
+	} else if (subCmd == "subscribe") {
+		subscribe(tokens, result);
+	} else if (subCmd == "unsubscribe") {
+		unsubscribe(tokens, result);
+	} else if (subCmd == "list_subscriptions") {
+		listSubscriptions(tokens, result);
 	} else {
 		throw SyntaxError();
 	}
@@ -313,7 +329,8 @@ void Debugger::Cmd::read(array_ref<TclObject> tokens, TclObject& result)
 	result.setInt(device.read(addr));
 }
 
-void Debugger::Cmd::readBlock(array_ref<TclObject> tokens, TclObject& result)
+void Debugger::Cmd::readBlock(array_ref<TclObject> tokens, TclObject& result,
+                               bool base64)
 {
 	if (tokens.size() != 5) {
 		throw SyntaxError();
@@ -331,10 +348,12 @@ void Debugger::Cmd::readBlock(array_ref<TclObject> tokens, TclObject& result)
 	}
 
 	MemBuffer<byte> buf(num);
-	for (unsigned i = 0; i < num; ++i) {
-		buf[i] = device.read(addr + i);
+	device.readBlock(addr, buf.data(), num);
+	if (base64) {
+		result.setString(Base64::encode(buf.data(), num));
+	} else {
+		result.setBinary(buf.data(), num);
 	}
-	result.setBinary(buf.data(), num);
 }
 
 void Debugger::Cmd::write(array_ref<TclObject> tokens, TclObject& /*result*/)
@@ -356,7 +375,8 @@ void Debugger::Cmd::write(array_ref<TclObject> tokens, TclObject& /*result*/)
 	device.write(addr, value);
 }
 
-void Debugger::Cmd::writeBlock(array_ref<TclObject> tokens, TclObject& /*result*/)
+void Debugger::Cmd::writeBlock(array_ref<TclObject> tokens, TclObject& /*result*/,
+                                bool base64)
 {
 	if (tokens.size() != 5) {
 		throw SyntaxError();
@@ -368,14 +388,20 @@ void Debugger::Cmd::writeBlock(array_ref<TclObject> tokens, TclObject& /*result*
 		throw CommandException("Invalid address");
 	}
 	unsigned num;
-	const byte* buf = tokens[4].getBinary(num);
+	const byte* buf;
+	std::pair<MemBuffer<byte>, size_t> decoded;
+	if (base64) {
+		decoded = Base64::decode(tokens[4].getString());
+		buf = decoded.first.data();
+		num = unsigned(decoded.second);
+	} else {
+		buf = tokens[4].getBinary(num);
+	}
 	if ((num + addr) > devSize) {
 		throw CommandException("Invalid size");
 	}
 
-	for (unsigned i = 0; i < num; ++i) {
-		device.write(addr + i, static_cast<byte>(buf[i]));
-	}
+	device.writeBlock(addr, buf, num);
 }
 
 void Debugger::Cmd::setBreakPoint(array_ref<TclObject> tokens, TclObject& result)
@@ -755,6 +781,56 @@ void Debugger::Cmd::probeListBreakPoints(
 	result.setString(res);
 }
 
+void Debugger::Cmd::subscribe(array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() < 4) {
+		throw CommandException("Missing argument");
+	}
+	unsigned id;
+	string_ref type = tokens[2].getString();
+	if (type == "probe") {
+		if (tokens.size() != 4) {
+			throw SyntaxError();
+		}
+		auto& probe = debugger().getProbe(tokens[3].getString());
+		id = debugger().subscriptions.subscribeProbe(probe);
+	} else if (type == "debuggable") {
+		if (tokens.size() != 6) {
+			throw SyntaxError();
+		}
+		string name = tokens[3].getString().str();
+		Debuggable& device = debugger().getDebuggable(name);
+		auto& interp = getInterpreter();
+		unsigned begin = tokens[4].getInt(interp);
+		unsigned num   = tokens[5].getInt(interp);
+		unsigned size  = device.getSize();
+		if ((begin >= size) || (num > (size - begin))) {
+			throw CommandException("Invalid range");
+		}
+		id = debugger().subscriptions.subscribeDebuggable(
+			std::move(name), begin, num);
+	} else {
+		throw SyntaxError();
+	}
+	result.setString(StringOp::Builder() << "sub#" << id);
+}
+
+void Debugger::Cmd::unsubscribe(array_ref<TclObject> tokens, TclObject& /*result*/)
+{
+	if (tokens.size() != 3) {
+		throw SyntaxError();
+	}
+	debugger().subscriptions.unsubscribe(tokens[2].getString());
+}
+
+void Debugger::Cmd::listSubscriptions(array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() != 2) {
+		throw SyntaxError();
+	}
+	result.setString(debugger().subscriptions.list());
+}
+
 string Debugger::Cmd::help(const vector<string>& tokens) const
 {
 	static const string generalHelp =
@@ -767,6 +843,8 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"    write             write a byte to a debuggable\n"
 		"    read_block        read a whole block at once\n"
 		"    write_block       write a whole block at once\n"
+		"    read_block_base64  like read_block, but base64 encoded\n"
+		"    write_block_base64 like write_block, but base64 encoded\n"
 		"    set_bp            insert a new breakpoint\n"
 		"    remove_bp         remove a certain breakpoint\n"
 		"    list_bp           list the active breakpoints\n"
@@ -777,6 +855,9 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"    remove_condition  remove a certain condition\n"
 		"    list_conditions   list the active conditions\n"
 		"    probe             probe related subcommands\n"
+		"    subscribe         get notified when a probe or debuggable changes\n"
+		"    unsubscribe       remove a certain subscription\n"
+		"    list_subscriptions  list the active subscriptions\n"
 		"    cont              continue execution after break\n"
 		"    step              execute one instruction\n"
 		"    break             break CPU at current position\n"
@@ -826,6 +907,15 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"  The block has a size and an offset in the debuggable. The "
 		"complete block must fit in the debuggable (see the 'size' "
 		"subcommand).\n";
+	static const string readBlockBase64Help =
+		"debug read_block_base64 <name> <addr> <size>\n"
+		"  Like 'read_block', but the result is base64 encoded. Unlike a "
+		"Tcl binary string this survives being transferred as text, e.g. "
+		"as the reply on an external control connection.\n";
+	static const string writeBlockBase64Help =
+		"debug write_block_base64 <name> <addr> <values>\n"
+		"  Like 'write_block', but the <values> argument must be base64 "
+		"encoded.\n";
 	static const string setBpHelp =
 		"debug set_bp <addr> [<cond>] [<cmd>]\n"
 		"  Insert a new breakpoint at given address. When the CPU is about "
@@ -915,6 +1005,28 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"    set_bp <probe> [<cond>] [<cmd>]  set a breakpoint on the given probe\n"
 		"    remove_bp <id>                   remove the given breakpoint\n"
 		"    list_bp                          returns a list of breakpoints that are set on probes\n";
+	static const string subscribeHelp =
+		"debug subscribe probe <probe>\n"
+		"debug subscribe debuggable <name> <addr> <size>\n"
+		"  Subscribe to the changes of a probe or of a range in a "
+		"debuggable. Instead of reading the values every frame, a client "
+		"(e.g. an external debugger) enables the 'debug' updates (see "
+		"'openmsx_update') and gets notified of the changes. The changes "
+		"are delivered once per frame and when the CPU breaks.\n"
+		"  The name of the update is the subscription ID (the result of "
+		"this command). For a probe the value is the time of the last "
+		"change and the new value, multiple changes within one frame are "
+		"combined. For a debuggable the value is the time followed by "
+		"lists of changed bytes: {<addr> <byte> <byte> ...}. The first "
+		"update reports the initial values.\n";
+	static const string unsubscribeHelp =
+		"debug unsubscribe <id>\n"
+		"  Remove the subscription with given ID again. You can use the "
+		"'list_subscriptions' subcommand to see all valid IDs.\n";
+	static const string listSubscriptionsHelp =
+		"debug list_subscriptions\n"
+		"  Lists all active subscriptions. Each line has the ID, the type "
+		"(probe or debuggable) and the arguments of the subscription.\n";
 	static const string contHelp =
 		"debug cont\n"
 		"  Continue execution after CPU was breaked.\n";
@@ -960,6 +1072,10 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		return readBlockHelp;
 	} else if (tokens[1] == "write_block") {
 		return writeBlockHelp;
+	} else if (tokens[1] == "read_block_base64") {
+		return readBlockBase64Help;
+	} else if (tokens[1] == "write_block_base64") {
+		return writeBlockBase64Help;
 	} else if (tokens[1] == "set_bp") {
 		return setBpHelp;
 	} else if (tokens[1] == "remove_bp") {
@@ -980,6 +1096,12 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		return listCondHelp;
 	} else if (tokens[1] == "probe") {
 		return probeHelp;
+	} else if (tokens[1] == "subscribe") {
+		return subscribeHelp;
+	} else if (tokens[1] == "unsubscribe") {
+		return unsubscribeHelp;
+	} else if (tokens[1] == "list_subscriptions") {
+		return listSubscriptionsHelp;
 	} else if (tokens[1] == "cont") {
 		return contHelp;
 	} else if (tokens[1] == "step") {
@@ -1028,15 +1150,16 @@ void Debugger::Cmd::tabCompletion(vector<string>& tokens) const
 	static const char* const singleArgCmds[] = {
 		"list", "step", "cont", "break", "breaked",
 		"list_bp", "list_watchpoints", "list_conditions",
+		"list_subscriptions",
 	};
 	static const char* const debuggableArgCmds[] = {
-		"desc", "size", "read", "read_block",
-		"write", "write_block",
+		"desc", "size", "read", "read_block", "read_block_base64",
+		"write", "write_block", "write_block_base64",
 	};
 	static const char* const otherCmds[] = {
 		"disasm", "set_bp", "remove_bp", "set_watchpoint",
 		"remove_watchpoint", "set_condition", "remove_condition",
-		"probe",
+		"probe", "subscribe", "unsubscribe",
 	};
 	switch (tokens.size()) {
 	case 2: {
@@ -1074,13 +1197,21 @@ void Debugger::Cmd::tabCompletion(vector<string>& tokens) const
 					"remove_bp", "list_bp",
 				};
 				completeString(tokens, subCmds);
+			} else if (tokens[1] == "subscribe") {
+				static const char* const types[] = {
+					"probe", "debuggable",
+				};
+				completeString(tokens, types);
 			}
 		}
 		break;
 	case 4:
-		if ((tokens[1] == "probe") &&
-		    ((tokens[2] == "desc") || (tokens[2] == "read") ||
-		     (tokens[2] == "set_bp"))) {
+		if ((tokens[1] == "subscribe") && (tokens[2] == "debuggable")) {
+			completeString(tokens, keys(debugger().debuggables));
+		} else if (((tokens[1] == "probe") &&
+		            ((tokens[2] == "desc") || (tokens[2] == "read") ||
+		             (tokens[2] == "set_bp"))) ||
+		           ((tokens[1] == "subscribe") && (tokens[2] == "probe"))) {
 			std::vector<string_ref> probeNames;
 			for (auto* p : debugger().probes) {
 				probeNames.emplace_back(p->getName());
@@ -2,6 +2,7 @@
 #define DEBUGGER_HH
 
 #include "Probe.hh"
+#include "DebugSubscriptions.hh"
 #include "RecordedCommand.hh"
 #include "WatchPoint.hh"
 #include "hash_map.hh"
@@ -77,9 +78,11 @@ private:
 		void desc(array_ref<TclObject> tokens, TclObject& result);
 		void size(array_ref<TclObject> tokens, TclObject& result);
 		void read(array_ref<TclObject> tokens, TclObject& result);
-		void readBlock(array_ref<TclObject> tokens, TclObject& result);
+		void readBlock(array_ref<TclObject> tokens, TclObject& result,
+		               bool base64);
 		void write(array_ref<TclObject> tokens, TclObject& result);
-		void writeBlock(array_ref<TclObject> tokens, TclObject& result);
+		void writeBlock(array_ref<TclObject> tokens, TclObject& result,
+		                bool base64);
 		void setBreakPoint(array_ref<TclObject> tokens, TclObject& result);
 		void removeBreakPoint(array_ref<TclObject> tokens, TclObject& result);
 		void listBreakPoints(array_ref<TclObject> tokens, TclObject& result);
@@ -99,6 +102,9 @@ private:
 		void probeSetBreakPoint(array_ref<TclObject> tokens, TclObject& result);
 		void probeRemoveBreakPoint(array_ref<TclObject> tokens, TclObject& result);
 		void probeListBreakPoints(array_ref<TclObject> tokens, TclObject& result);
+		void subscribe(array_ref<TclObject> tokens, TclObject& result);
+		void unsubscribe(array_ref<TclObject> tokens, TclObject& result);
+		void listSubscriptions(array_ref<TclObject> tokens, TclObject& result);
 	} cmd;
 
 	struct NameFromProbe {
@@ -111,6 +117,7 @@ private:
 	hash_set<ProbeBase*, NameFromProbe, XXHasher>  probes;
 	using ProbeBreakPoints = std::vector<std::unique_ptr<ProbeBreakPoint>>;
 	ProbeBreakPoints probeBreakPoints; // unordered
+	DebugSubscriptions subscriptions;
 	MSXCPU* cpu;
 };
 
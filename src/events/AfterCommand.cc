@@ -1,5 +1,6 @@
 #include "AfterCommand.hh"
 #include "CommandController.hh"
+#include "Interpreter.hh"
 #include "CliComm.hh"
 #include "Schedulable.hh"
 #include "EventDistributor.hh"
@@ -10,11 +11,13 @@
 #include "EmuTime.hh"
 #include "CommandException.hh"
 #include "TclObject.hh"
+#include "StringOp.hh"
 #include "memory.hh"
 #include "stl.hh"
 #include "unreachable.hh"
 #include <algorithm>
 #include <iterator>
+#include <cassert>
 #include <sstream>
 
 using std::ostringstream;
@@ -36,12 +39,15 @@ public:
 protected:
 	AfterCmd(AfterCommand& afterCommand,
 		 const TclObject& command);
-	unique_ptr<AfterCmd> removeSelf();
 
 	AfterCommand& afterCommand;
 	TclObject command;
 	string id;
 	static unsigned lastAfterId;
+private:
+	friend class AfterCommand;
+	unsigned num; // the number in 'id', key in AfterCommand::afterCmds
+	AfterCommand::CmdList* bucket; // list this command is in, or nullptr
 };
 
 class AfterTimedCmd : public AfterCmd, private Schedulable
@@ -252,10 +258,9 @@ void AfterCommand::afterTime(array_ref<TclObject> tokens, TclObject& result)
 	MSXMotherBoard* motherBoard = reactor.getMotherBoard();
 	if (!motherBoard) return;
 	double time = getTime(getInterpreter(), tokens[2]);
-	auto cmd = make_unique<AfterTimeCmd>(
-		motherBoard->getScheduler(), *this, tokens[3], time);
-	result.setString(cmd->getId());
-	afterCmds.push_back(move(cmd));
+	addCmd(make_unique<AfterTimeCmd>(
+		motherBoard->getScheduler(), *this, tokens[3], time),
+	       nullptr, result);
 }
 
 void AfterCommand::afterRealTime(array_ref<TclObject> tokens, TclObject& result)
@@ -264,10 +269,9 @@ void AfterCommand::afterRealTime(array_ref<TclObject> tokens, TclObject& result)
 		throw SyntaxError();
 	}
 	double time = getTime(getInterpreter(), tokens[2]);
-	auto cmd = make_unique<AfterRealTimeCmd>(
-		reactor.getRTScheduler(), *this, tokens[3], time);
-	result.setString(cmd->getId());
-	afterCmds.push_back(move(cmd));
+	addCmd(make_unique<AfterRealTimeCmd>(
+		reactor.getRTScheduler(), *this, tokens[3], time),
+	       nullptr, result);
 }
 
 void AfterCommand::afterTclTime(
@@ -275,10 +279,9 @@ void AfterCommand::afterTclTime(
 {
 	TclObject command;
 	command.addListElements(std::begin(tokens) + 2, std::end(tokens));
-	auto cmd = make_unique<AfterRealTimeCmd>(
-		reactor.getRTScheduler(), *this, command, ms / 1000.0);
-	result.setString(cmd->getId());
-	afterCmds.push_back(move(cmd));
+	addCmd(make_unique<AfterRealTimeCmd>(
+		reactor.getRTScheduler(), *this, command, ms / 1000.0),
+	       nullptr, result);
 }
 
 template<EventType T>
@@ -287,10 +290,8 @@ void AfterCommand::afterEvent(array_ref<TclObject> tokens, TclObject& result)
 	if (tokens.size() != 3) {
 		throw SyntaxError();
 	}
-	auto cmd = make_unique<AfterEventCmd<T>>(
-		*this, tokens[1], tokens[2]);
-	result.setString(cmd->getId());
-	afterCmds.push_back(move(cmd));
+	addCmd(make_unique<AfterEventCmd<T>>(*this, tokens[1], tokens[2]),
+	       &eventCmds[T], result);
 }
 
 void AfterCommand::afterInputEvent(
@@ -299,10 +300,8 @@ void AfterCommand::afterInputEvent(
 	if (tokens.size() != 3) {
 		throw SyntaxError();
 	}
-	auto cmd = make_unique<AfterInputEventCmd>(
-		*this, event, tokens[2]);
-	result.setString(cmd->getId());
-	afterCmds.push_back(move(cmd));
+	addCmd(make_unique<AfterInputEventCmd>(*this, event, tokens[2]),
+	       &inputCmds, result);
 }
 
 void AfterCommand::afterIdle(array_ref<TclObject> tokens, TclObject& result)
@@ -313,16 +312,16 @@ void AfterCommand::afterIdle(array_ref<TclObject> tokens, TclObject& result)
 	MSXMotherBoard* motherBoard = reactor.getMotherBoard();
 	if (!motherBoard) return;
 	double time = getTime(getInterpreter(), tokens[2]);
-	auto cmd = make_unique<AfterIdleCmd>(
-		motherBoard->getScheduler(), *this, tokens[3], time);
-	result.setString(cmd->getId());
-	afterCmds.push_back(move(cmd));
+	addCmd(make_unique<AfterIdleCmd>(
+		motherBoard->getScheduler(), *this, tokens[3], time),
+	       &idleCmds, result);
 }
 
 void AfterCommand::afterInfo(array_ref<TclObject> /*tokens*/, TclObject& result)
 {
 	ostringstream str;
-	for (auto& cmd : afterCmds) {
+	for (auto& p : afterCmds) {
+		auto& cmd = p.second;
 		str << cmd->getId() << ": ";
 		str << cmd->getType() << ' ';
 		if (auto cmd2 = dynamic_cast<const AfterTimedCmd*>(cmd.get())) {
@@ -342,20 +341,24 @@ void AfterCommand::afterCancel(array_ref<TclObject> tokens, TclObject& /*result*
 	}
 	if (tokens.size() == 3) {
 		auto id = tokens[2].getString();
-		auto it = find_if(begin(afterCmds), end(afterCmds),
-			[&](std::unique_ptr<AfterCmd>& e) { return e->getId() == id; });
-		if (it != end(afterCmds)) {
-			afterCmds.erase(it);
-			return;
+		unsigned num;
+		if (id.starts_with("after#") &&
+		    StringOp::stringToUint(id.substr(6).str(), num)) {
+			auto it = afterCmds.find(num);
+			if (it != end(afterCmds)) {
+				removeCmd(*it->second);
+				return;
+			}
 		}
 	}
 	TclObject command;
 	command.addListElements(std::begin(tokens) + 2, std::end(tokens));
 	string_ref cmdStr = command.getString();
 	auto it = find_if(begin(afterCmds), end(afterCmds),
-		[&](std::unique_ptr<AfterCmd>& e) { return e->getCommand() == cmdStr; });
+		[&](const std::pair<const unsigned, unique_ptr<AfterCmd>>& e) {
+			return e.second->getCommand() == cmdStr; });
 	if (it != end(afterCmds)) {
-		afterCmds.erase(it);
+		removeCmd(*it->second);
 		// Tcl manual is not clear about this, but it seems
 		// there's only occurence of this command canceled.
 		// It's also not clear which of the (possibly) several
@@ -390,74 +393,89 @@ void AfterCommand::tabCompletion(vector<string>& tokens) const
 	// TODO : make more complete
 }
 
-// Execute the cmds for which the predicate returns true, and erase those from afterCmds.
-template<typename PRED> void AfterCommand::executeMatches(PRED pred)
+void AfterCommand::addCmd(unique_ptr<AfterCmd> cmd, CmdList* bucket,
+                          TclObject& result)
 {
-	AfterCmds matches;
-	// Usually there are very few matches (typically even 0 or 1), so no
-	// need to reserve() space.
-	auto p = partition_copy_remove(begin(afterCmds), end(afterCmds),
-	                               std::back_inserter(matches), pred);
-	afterCmds.erase(p.second, end(afterCmds));
-	for (auto& c : matches) {
-		c->execute();
-	}
+	result.setString(cmd->getId());
+	cmd->bucket = bucket;
+	if (bucket) bucket->push_back(cmd.get());
+	auto num = cmd->num;
+	afterCmds[num] = move(cmd);
 }
 
-template<EventType T> struct AfterEventPred {
-	bool operator()(const unique_ptr<AfterCmd>& x) const {
-		return dynamic_cast<AfterEventCmd<T>*>(x.get()) != nullptr;
+// Move a command to another list (or to no list at all).
+void AfterCommand::moveCmd(AfterCmd& cmd, CmdList* bucket)
+{
+	if (cmd.bucket) {
+		cmd.bucket->erase(find_unguarded(*cmd.bucket, &cmd));
 	}
-};
-template<EventType T> void AfterCommand::executeEvents()
+	cmd.bucket = bucket;
+	if (bucket) bucket->push_back(&cmd);
+}
+
+unique_ptr<AfterCmd> AfterCommand::removeCmd(AfterCmd& cmd)
 {
-	executeMatches(AfterEventPred<T>());
+	moveCmd(cmd, nullptr);
+	auto it = afterCmds.find(cmd.num);
+	assert(it != end(afterCmds));
+	auto result = move(it->second);
+	afterCmds.erase(it);
+	return result;
 }
 
-struct AfterEmuTimePred {
-	bool operator()(const unique_ptr<AfterCmd>& x) const {
-		if (auto* cmd = dynamic_cast<AfterTimedCmd*>(x.get())) {
-			if (cmd->getTime() == 0.0) {
-				return true;
-			}
-		}
-		return false;
-	}
-};
+// Execute the cmds in the given list for which the predicate returns true,
+// and remove those. The matching cmds are removed before any of them gets
+// executed, so that canceling them from within the executed command has no
+// effect (and commands added by it are only triggered by the next event).
+template<typename PRED>
+void AfterCommand::executeMatches(CmdList& list, PRED pred)
+{
+	CmdList matches;
+	// Usually there are very few matches (typically even 0 or 1), so no
+	// need to reserve() space.
+	auto p = partition_copy_remove(begin(list), end(list),
+	                               std::back_inserter(matches), pred);
+	list.erase(p.second, end(list));
+	executeAll(matches);
+}
 
-struct AfterInputEventPred {
-	explicit AfterInputEventPred(AfterCommand::EventPtr event_)
-		: event(std::move(event_)) {}
-	bool operator()(const unique_ptr<AfterCmd>& x) const {
-		if (auto* cmd = dynamic_cast<AfterInputEventCmd*>(x.get())) {
-			if (cmd->getEvent()->matches(*event)) return true;
-		}
-		return false;
+void AfterCommand::executeAll(CmdList& list)
+{
+	CmdList todo;
+	swap(todo, list);
+	vector<unique_ptr<AfterCmd>> cmds;
+	cmds.reserve(todo.size());
+	for (auto* c : todo) {
+		c->bucket = nullptr; // already removed from the list
+		cmds.push_back(removeCmd(*c));
 	}
-	AfterCommand::EventPtr event;
-};
+	for (auto& c : cmds) {
+		c->execute();
+	}
+}
 
 int AfterCommand::signalEvent(const std::shared_ptr<const Event>& event)
 {
-	if (event->getType() == OPENMSX_FINISH_FRAME_EVENT) {
-		executeEvents<OPENMSX_FINISH_FRAME_EVENT>();
-	} else if (event->getType() == OPENMSX_BREAK_EVENT) {
-		executeEvents<OPENMSX_BREAK_EVENT>();
-	} else if (event->getType() == OPENMSX_BOOT_EVENT) {
-		executeEvents<OPENMSX_BOOT_EVENT>();
-	} else if (event->getType() == OPENMSX_QUIT_EVENT) {
-		executeEvents<OPENMSX_QUIT_EVENT>();
-	} else if (event->getType() == OPENMSX_MACHINE_LOADED_EVENT) {
-		executeEvents<OPENMSX_MACHINE_LOADED_EVENT>();
-	} else if (event->getType() == OPENMSX_AFTER_TIMED_EVENT) {
-		executeMatches(AfterEmuTimePred());
-	} else {
-		executeMatches(AfterInputEventPred(event));
-		for (auto& c : afterCmds) {
-			if (auto* cmd = dynamic_cast<AfterIdleCmd*>(c.get())) {
-				cmd->reschedule();
-			}
+	switch (event->getType()) {
+	case OPENMSX_FINISH_FRAME_EVENT:
+	case OPENMSX_BREAK_EVENT:
+	case OPENMSX_BOOT_EVENT:
+	case OPENMSX_QUIT_EVENT:
+	case OPENMSX_MACHINE_LOADED_EVENT:
+		executeAll(eventCmds[event->getType()]);
+		break;
+	case OPENMSX_AFTER_TIMED_EVENT:
+		executeAll(expiredCmds);
+		break;
+	default:
+		executeMatches(inputCmds, [&](AfterCmd* cmd) {
+			return static_cast<AfterInputEventCmd*>(cmd)->
+				getEvent()->matches(*event);
+		});
+		for (auto* c : idleCmds) {
+			static_cast<AfterIdleCmd*>(c)->reschedule();
 		}
+		break;
 	}
 	return 0;
 }
@@ -469,10 +487,9 @@ unsigned AfterCmd::lastAfterId = 0;
 
 AfterCmd::AfterCmd(AfterCommand& afterCommand_, const TclObject& command_)
 	: afterCommand(afterCommand_), command(command_)
+	, num(++lastAfterId), bucket(nullptr)
 {
-	ostringstream str;
-	str << "after#" << ++lastAfterId;
-	id = str.str();
+	id = StringOp::Builder() << "after#" << num;
 }
 
 string_ref AfterCmd::getCommand() const
@@ -487,24 +504,19 @@ const string& AfterCmd::getId() const
 
 void AfterCmd::execute()
 {
+	auto& interp = afterCommand.getInterpreter();
+	CallbackProfiler::Scope scope(interp.getCallbackProfiler(),
+	                              CallbackProfiler::AFTER, command);
 	try {
-		command.executeCommand(afterCommand.getInterpreter());
+		// Usually the same commands get registered over and over
+		// again (e.g. 'after frame'), so use the cached compiled form.
+		interp.executeCached(command);
 	} catch (CommandException& e) {
 		afterCommand.getCommandController().getCliComm().printWarning(
 			"Error executing delayed command: " + e.getMessage());
 	}
 }
 
-unique_ptr<AfterCmd> AfterCmd::removeSelf()
-{
-	auto it = rfind_if_unguarded(afterCommand.afterCmds,
-		[&](std::unique_ptr<AfterCmd>& e) { return e.get() == this; });
-	auto result = move(*it);
-	afterCommand.afterCmds.erase(it);
-	return result;
-}
-
-
 // class  AfterTimedCmd
 
 AfterTimedCmd::AfterTimedCmd(
@@ -532,13 +544,14 @@ void AfterTimedCmd::reschedule()
 void AfterTimedCmd::executeUntil(EmuTime::param /*time*/)
 {
 	time = 0.0; // execute on next event
+	afterCommand.moveCmd(*this, &afterCommand.expiredCmds);
 	afterCommand.eventDistributor.distributeEvent(
 		std::make_shared<SimpleEvent>(OPENMSX_AFTER_TIMED_EVENT));
 }
 
 void AfterTimedCmd::schedulerDeleted()
 {
-	removeSelf();
+	afterCommand.removeCmd(*this);
 }
 
 
@@ -627,8 +640,8 @@ void AfterRealTimeCmd::executeRT()
 {
 	// Remove self before executing, but keep self alive till the end of
 	// this method. Otherwise execute could execute 'after cancel ..' and
-	// removeSelf() asserts that it can't find itself anymore.
-	auto self = removeSelf();
+	// removeCmd() asserts that it can't find itself anymore.
+	auto self = afterCommand.removeCmd(*this);
 	execute();
 }
 
@@ -4,6 +4,7 @@
 #include "Command.hh"
 #include "EventListener.hh"
 #include "Event.hh"
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -29,8 +30,14 @@ public:
 	void tabCompletion(std::vector<std::string>& tokens) const override;
 
 private:
-	template<typename PRED> void executeMatches(PRED pred);
-	template<EventType T> void executeEvents();
+	using CmdList = std::vector<AfterCmd*>;
+
+	void addCmd(std::unique_ptr<AfterCmd> cmd, CmdList* bucket,
+	            TclObject& result);
+	void moveCmd(AfterCmd& cmd, CmdList* bucket);
+	std::unique_ptr<AfterCmd> removeCmd(AfterCmd& cmd);
+	template<typename PRED> void executeMatches(CmdList& list, PRED pred);
+	void executeAll(CmdList& list);
 	template<EventType T> void afterEvent(
 	                   array_ref<TclObject> tokens, TclObject& result);
 	void afterInputEvent(const EventPtr& event,
@@ -46,8 +53,16 @@ private:
 	// EventListener
 	int signalEvent(const std::shared_ptr<const Event>& event) override;
 
-	using AfterCmds = std::vector<std::unique_ptr<AfterCmd>>;
-	AfterCmds afterCmds;
+	// All pending commands, ordered on id (so in order of creation).
+	std::map<unsigned, std::unique_ptr<AfterCmd>> afterCmds;
+	// Each command is also in (at most) one of these lists, so that an
+	// event only has to look at the commands that can be triggered by
+	// it. Commands that wait for a (realtime) timer are not in a list,
+	// the (RT)Scheduler already keeps those ordered on time.
+	std::map<EventType, CmdList> eventCmds; // frame, break, boot, ...
+	CmdList inputCmds;   // waiting for a specific input event
+	CmdList idleCmds;    // rescheduled on every input event
+	CmdList expiredCmds; // 'time' and 'idle', executed on AFTER_TIMED_EVENT
 	Reactor& reactor;
 	EventDistributor& eventDistributor;
 
@@ -0,0 +1,89 @@
+#include "BinaryCliCommParser.hh"
+#include "endian.hh"
+
+
+BinaryCliCommParser::BinaryCliCommParser(
+		std::function<void(uint32_t, std::string&&)> callback_)
+	: callback(std::move(callback_))
+{
+}
+
+bool BinaryCliCommParser::parse(const char* buf, size_t n)
+{
+	// Usually a buffer contains only complete frames, in that case
+	// there's no need to copy the data.
+	const char* data = buf;
+	size_t size = n;
+	bool buffered = !buffer.empty();
+	if (buffered) {
+		buffer.append(buf, n);
+		data = buffer.data();
+		size = buffer.size();
+	}
+
+	size_t pos = 0;
+	while ((size - pos) >= 4) {
+		uint32_t frameSize = Endian::read_UA_L32(&data[pos]);
+		if ((frameSize < 4) || (frameSize > MAX_FRAME_SIZE)) {
+			return false;
+		}
+		if ((size - pos - 4) < frameSize) break;
+		uint32_t id = Endian::read_UA_L32(&data[pos + 4]);
+		callback(id, std::string(&data[pos + 8], frameSize - 4));
+		pos += 4 + frameSize;
+	}
+
+	if (buffered) {
+		buffer.erase(0, pos);
+	} else {
+		buffer.assign(&data[pos], size - pos);
+	}
+	return true;
+}
+
+
+
+#if 0
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+static string frame(uint32_t id, const string& command)
+{
+	char header[8];
+	Endian::write_UA_L32(&header[0], uint32_t(command.size() + 4));
+	Endian::write_UA_L32(&header[4], id);
+	return string(header, 8) + command;
+}
+
+void test(const string& stream, size_t chunk,
+          const vector<pair<uint32_t, string>>& expected, bool expectedOk = true)
+{
+	vector<pair<uint32_t, string>> result;
+	BinaryCliCommParser parser([&](uint32_t id, string&& cmd) {
+		result.emplace_back(id, move(cmd)); });
+	bool ok = true;
+	for (size_t i = 0; ok && (i < stream.size()); i += chunk) {
+		ok = parser.parse(&stream[i], min(chunk, stream.size() - i));
+	}
+	cout << (((result == expected) && (ok == expectedOk)) ? "ok" : "ERROR")
+	     << endl;
+}
+
+int main()
+{
+	string two = frame(1, "foo") + frame(2, string("a\0b", 3));
+	vector<pair<uint32_t, string>> expected = {
+		{1, "foo"}, {2, string("a\0b", 3)} };
+	test(two, two.size(), expected);
+	test(two, 1, expected);
+	test(two, 5, expected);
+	test(frame(7, ""), 3, {{7, ""}});
+	test(string("\x01\0\0\0", 4), 4, {}, false); // too small
+	test(frame(1, "foo") + string("\xff\xff\xff\xff", 4), 100,
+	     {{1, "foo"}}, false); // too large
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef BINARYCLICOMMPARSER_HH
+#define BINARYCLICOMMPARSER_HH
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/** Parser for the binary control protocol (see openmsx-control.html).
+  * The input is a sequence of frames, each frame is
+  *   size (32-bit little endian, the number of bytes that follow)
+  *   request id (32-bit little endian)
+  *   command (size - 4 bytes, not zero terminated)
+  */
+class BinaryCliCommParser
+{
+public:
+	static const uint32_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+	explicit BinaryCliCommParser(
+		std::function<void(uint32_t, std::string&&)> callback);
+
+	/** Returns false on a protocol error, the connection should then be
+	  * closed because it's not possible to resynchronize.
+	  */
+	bool parse(const char* buf, size_t n);
+
+private:
+	std::function<void(uint32_t, std::string&&)> callback;
+	std::string buffer; // incomplete frame
+};
+
+#endif
@@ -28,6 +28,7 @@ public:
 		EXTENSION,
 		SOUNDDEVICE,
 		CONNECTOR,
+		DEBUG_UPDATE, // DEBUG may give preprocessor name clashes
 		NUM_UPDATES // must be last
 	};
 
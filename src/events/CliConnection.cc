@@ -17,8 +17,11 @@
 #include "unistdp.hh"
 #include "openmsx.hh"
 #include "StringOp.hh"
+#include "endian.hh"
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <tcl.h>
 
 #ifdef _WIN32
 #include "SocketStreamWrapper.hh"
@@ -29,62 +32,95 @@ using std::string;
 
 namespace openmsx {
 
+// The binary protocol is selected by sending this header as the very first
+// bytes on a socket connection. openMSX confirms the switch by sending the
+// same header.
+static const char BINARY_HEADER[8] = { '\0', 'o', 'M', 'S', 'X', 'b', 'i', 'n' };
+
+// Kinds of frames sent in binary mode.
+enum { FRAME_OK = 0, FRAME_NOK = 1, FRAME_LOG = 2, FRAME_UPDATE = 3 };
+
+
 // class CliCommandEvent
 
-class CliCommandEvent : public Event
+void CliCommandEvent::toStringImpl(TclObject& result) const
 {
-public:
-	CliCommandEvent(string command_, const CliConnection* id_)
-		: Event(OPENMSX_CLICOMMAND_EVENT)
-		, command(std::move(command_)), id(id_)
-	{
-	}
-	const string& getCommand() const
-	{
-		return command;
-	}
-	const CliConnection* getId() const
-	{
-		return id;
-	}
-	void toStringImpl(TclObject& result) const override
-	{
-		result.addListElement("CliCmd");
-		result.addListElement(getCommand());
-	}
-	bool lessImpl(const Event& other) const override
-	{
-		auto& otherCmdEvent = checked_cast<const CliCommandEvent&>(other);
-		return getCommand() < otherCmdEvent.getCommand();
-	}
-private:
-	const string command;
-	const CliConnection* id;
-};
+	result.addListElement("CliCmd");
+}
+
+bool CliCommandEvent::lessImpl(const Event& other) const
+{
+	auto& otherCmdEvent = checked_cast<const CliCommandEvent&>(other);
+	return &getConnection() < &otherCmdEvent.getConnection();
+}
 
 
 // class CliConnection
 
 CliConnection::CliConnection(CommandController& commandController_,
                              EventDistributor& eventDistributor_)
-	: parser([this](const std::string& cmd) { execute(cmd); })
+	: parser([this](const std::string& cmd) { queueCommand(cmd, 0); })
 	, commandController(commandController_)
 	, eventDistributor(eventDistributor_)
+	, binaryRequested(false)
+	, binary(false)
 {
 	for (auto& en : updateEnabled) {
 		en = false;
 	}
-
-	eventDistributor.registerEventListener(OPENMSX_CLICOMMAND_EVENT, *this);
 }
 
 CliConnection::~CliConnection()
 {
-	eventDistributor.unregisterEventListener(OPENMSX_CLICOMMAND_EVENT, *this);
+}
+
+void CliConnection::addUpdateFilter(CliComm::UpdateType type, string_ref pattern)
+{
+	if (!updateEnabled[type]) {
+		updateEnabled[type] = true;
+		updateFilters[type].clear();
+	} else if (updateFilters[type].empty()) {
+		return; // already receiving all updates of this type
+	}
+	updateFilters[type].push_back(pattern.str());
+}
+
+bool CliConnection::passesFilter(CliComm::UpdateType type, string_ref name) const
+{
+	auto& filters = updateFilters[type];
+	if (filters.empty()) return true;
+	string n = name.str();
+	return std::any_of(std::begin(filters), std::end(filters),
+		[&](const string& f) {
+			return Tcl_StringMatch(n.c_str(), f.c_str()) != 0; });
+}
+
+static void append32(string& s, uint32_t value)
+{
+	char buf[4];
+	Endian::write_UA_L32(buf, value);
+	s.append(buf, 4);
+}
+
+// Frame layout: size (32-bit, the number of bytes that follow), kind (8-bit),
+// id (32-bit), payload. All numbers are little endian.
+static string frame(byte kind, uint32_t id, string_ref payload)
+{
+	string result;
+	result.reserve(9 + payload.size());
+	append32(result, uint32_t(5 + payload.size()));
+	result += char(kind);
+	append32(result, id);
+	result.append(payload.data(), payload.size());
+	return result;
 }
 
 void CliConnection::log(CliComm::LogLevel level, string_ref message)
 {
+	if (binary) {
+		output(frame(FRAME_LOG, level, message));
+		return;
+	}
 	auto levelStr = CliComm::getLevelStrings();
 	output(StringOp::Builder() <<
 		"<log level=\"" << levelStr[level] << "\">" <<
@@ -95,6 +131,18 @@ void CliConnection::update(CliComm::UpdateType type, string_ref machine,
                               string_ref name, string_ref value)
 {
 	if (!getUpdateEnable(type)) return;
+	if (!passesFilter(type, name)) return;
+
+	if (binary) {
+		// machine, name and value, each preceded by its length
+		string payload;
+		for (auto& s : { machine, name, value }) {
+			append32(payload, uint32_t(s.size()));
+			payload.append(s.data(), s.size());
+		}
+		output(frame(FRAME_UPDATE, type, payload));
+		return;
+	}
 
 	auto updateStr = CliComm::getUpdateStrings();
 	StringOp::Builder tmp;
@@ -122,7 +170,9 @@ void CliConnection::start()
 
 void CliConnection::end()
 {
-	output("</openmsx-output>\n");
+	if (!binary) {
+		output("</openmsx-output>\n");
+	}
 	close();
 
 	poller.abort();
@@ -132,33 +182,85 @@ void CliConnection::end()
 	}
 }
 
-void CliConnection::execute(const string& command)
+void CliConnection::requestBinaryMode()
 {
+	// runs in helper thread
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		binaryRequested = true;
+	}
 	eventDistributor.distributeEvent(
-		std::make_shared<CliCommandEvent>(command, this));
+		std::make_shared<CliCommandEvent>(*this));
 }
 
-static string reply(const string& message, bool status)
+void CliConnection::queueCommand(string command, uint32_t id)
 {
-	return StringOp::Builder() <<
-		"<reply result=\"" << (status ? "ok" : "nok") << "\">" <<
-		XMLElement::XMLEscape(message) << "</reply>\n";
+	// runs in helper thread
+	bool wasEmpty;
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		wasEmpty = pending.empty();
+		pending.push_back({std::move(command), id});
+	}
+	// When commands are sent faster than they are executed, they are
+	// executed in batches with only one event per batch.
+	if (wasEmpty) {
+		eventDistributor.distributeEvent(
+			std::make_shared<CliCommandEvent>(*this));
+	}
 }
 
-int CliConnection::signalEvent(const std::shared_ptr<const Event>& event)
+void CliConnection::executePending()
 {
-	auto& commandEvent = checked_cast<const CliCommandEvent&>(*event);
-	if (commandEvent.getId() == this) {
+	std::vector<PendingCommand> commands;
+	bool switchToBinary;
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		swap(commands, pending);
+		switchToBinary = binaryRequested && !binary;
+	}
+	if (switchToBinary) {
+		output(string_ref(BINARY_HEADER, sizeof(BINARY_HEADER)));
+		binary = true;
+	}
+	for (auto& c : commands) {
 		try {
-			string result = commandController.executeCommand(
-				commandEvent.getCommand(), this).getString().str();
-			output(reply(result, true));
+			reply(c.id, commandController.executeCommand(
+				c.command, this));
 		} catch (CommandException& e) {
-			string result = e.getMessage() + '\n';
-			output(reply(result, false));
+			replyError(c.id, e.getMessage());
 		}
 	}
-	return 0;
+}
+
+void CliConnection::reply(uint32_t id, const TclObject& result)
+{
+	if (binary) {
+		if (result.isBinary()) {
+			// e.g. 'debug read_block', send the raw bytes
+			unsigned length;
+			auto* data = result.getBinary(length);
+			output(frame(FRAME_OK, id, string_ref(
+				reinterpret_cast<const char*>(data), length)));
+		} else {
+			output(frame(FRAME_OK, id, result.getString()));
+		}
+		return;
+	}
+	output(StringOp::Builder() <<
+		"<reply result=\"ok\">" <<
+		XMLElement::XMLEscape(result.getString().str()) << "</reply>\n");
+}
+
+void CliConnection::replyError(uint32_t id, const string& message)
+{
+	if (binary) {
+		output(frame(FRAME_NOK, id, message));
+		return;
+	}
+	output(StringOp::Builder() <<
+		"<reply result=\"nok\">" <<
+		XMLElement::XMLEscape(message + '\n') << "</reply>\n");
 }
 
 
@@ -321,7 +423,9 @@ SocketConnection::SocketConnection(CommandController& commandController_,
                                    EventDistributor& eventDistributor_,
                                    SOCKET sd_)
 	: CliConnection(commandController_, eventDistributor_)
-	, sd(sd_), established(false)
+	, binaryParser([this](uint32_t id, string&& cmd) {
+		queueCommand(std::move(cmd), id); })
+	, sd(sd_), mode(DETECT), detected(0), established(false)
 {
 }
 
@@ -364,7 +468,7 @@ void SocketConnection::run()
 		char buf[BUF_SIZE];
 		int n = sock_recv(sd, buf, BUF_SIZE);
 		if (n > 0) {
-			parser.parse(buf, n);
+			if (!received(buf, n)) break;
 		} else if (n < 0) {
 			break;
 		}
@@ -372,6 +476,33 @@ void SocketConnection::run()
 	closeSocket();
 }
 
+bool SocketConnection::received(const char* buf, size_t n)
+{
+	// runs in helper thread
+	if (mode == DETECT) {
+		// The client chooses the protocol with its first bytes.
+		while (n && (detected < sizeof(BINARY_HEADER))) {
+			if (*buf != BINARY_HEADER[detected]) {
+				mode = XML;
+				// not a binary header after all
+				parser.parse(BINARY_HEADER, detected);
+				break;
+			}
+			++detected; ++buf; --n;
+		}
+		if (mode == DETECT) {
+			if (detected < sizeof(BINARY_HEADER)) return true;
+			mode = BINARY;
+			requestBinaryMode();
+		}
+	}
+	if (mode == BINARY) {
+		return binaryParser.parse(buf, n);
+	}
+	parser.parse(buf, n);
+	return true;
+}
+
 void SocketConnection::output(string_ref message)
 {
 	if (!established) { // TODO needs locking?
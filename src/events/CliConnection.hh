@@ -2,29 +2,39 @@
 #define CLICONNECTION_HH
 
 #include "CliListener.hh"
-#include "EventListener.hh"
+#include "Event.hh"
 #include "Socket.hh"
 #include "CliComm.hh"
 #include "AdhocCliCommParser.hh"
+#include "BinaryCliCommParser.hh"
 #include "Poller.hh"
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
+#include <cstdint>
 
 namespace openmsx {
 
 class CommandController;
 class EventDistributor;
 
-class CliConnection : public CliListener, private EventListener
+class CliConnection : public CliListener
 {
 public:
+	/** Enable or disable all updates of the given type. */
 	void setUpdateEnable(CliComm::UpdateType type, bool value) {
 		updateEnabled[type] = value;
+		updateFilters[type].clear();
 	}
 	bool getUpdateEnable(CliComm::UpdateType type) const {
 		return updateEnabled[type];
 	}
+	/** Enable the updates of the given type for which the name matches
+	  * the given glob pattern. Can be called several times to allow
+	  * several patterns. setUpdateEnable() removes all patterns.
+	  */
+	void addUpdateFilter(CliComm::UpdateType type, string_ref pattern);
 
 	/** Starts the helper thread.
 	  * Called when this CliConnection is added to GlobalCliComm (and
@@ -58,28 +68,73 @@ protected:
 	  */
 	void startOutput();
 
+	/** Switch to the binary protocol. Called from the helper thread,
+	  * when it received the binary protocol header. The switch itself
+	  * (sending the header back) happens in the main thread.
+	  */
+	void requestBinaryMode();
+
+	/** Queue a command for execution in the main thread. Can be called
+	  * from the helper thread.
+	  * @param id Request id, only used in binary mode.
+	  */
+	void queueCommand(std::string command, uint32_t id);
+
 	AdhocCliCommParser parser;
 	Poller poller;
 
 private:
+	friend class GlobalCliComm;
+
+	struct PendingCommand {
+		std::string command;
+		uint32_t id;
+	};
+
 	virtual void run() = 0;
 
-	void execute(const std::string& command);
+	/** Execute all queued commands, called from the main thread when it
+	  * receives a CliCommandEvent for this connection.
+	  */
+	void executePending();
+	void reply(uint32_t id, const TclObject& result);
+	void replyError(uint32_t id, const std::string& message);
+	bool passesFilter(CliComm::UpdateType type, string_ref name) const;
 
 	// CliListener
 	void log(CliComm::LogLevel level, string_ref message) override;
 	void update(CliComm::UpdateType type, string_ref machine,
 	            string_ref name, string_ref value) override;
 
-	// EventListener
-	int signalEvent(const std::shared_ptr<const Event>& event) override;
-
 	CommandController& commandController;
 	EventDistributor& eventDistributor;
 
 	std::thread thread;
 
+	std::mutex pendingMutex; // lock access to 'pending' and 'binaryRequested'
+	std::vector<PendingCommand> pending;
+	bool binaryRequested;
+	bool binary; // only accessed from the main thread
+
 	bool updateEnabled[CliComm::NUM_UPDATES];
+	// glob patterns, when not empty the name must match one of these
+	std::vector<std::string> updateFilters[CliComm::NUM_UPDATES];
+};
+
+/** Sent (from a helper thread) to the main thread when a CliConnection has
+  * commands to execute. GlobalCliComm delivers it to that connection.
+  */
+class CliCommandEvent final : public Event
+{
+public:
+	explicit CliCommandEvent(CliConnection& connection_)
+		: Event(OPENMSX_CLICOMMAND_EVENT), connection(connection_) {}
+	CliConnection& getConnection() const { return connection; }
+private:
+	void toStringImpl(TclObject& result) const override;
+	bool lessImpl(const Event& other) const override;
+
+	CliConnection& connection;
 };
 
 class StdioConnection final : public CliConnection
@@ -130,9 +185,13 @@ private:
 	void close() override;
 	void run() override;
 	void closeSocket();
+	bool received(const char* buf, size_t n);
 
+	BinaryCliCommParser binaryParser;
 	std::mutex sdMutex;
 	SOCKET sd;
+	enum { DETECT, XML, BINARY } mode; // protocol, chosen by the client
+	unsigned detected; // number of matched header bytes (in DETECT mode)
 	bool established;
 };
 
@@ -1,6 +1,8 @@
 #include "GlobalCliComm.hh"
 #include "CliListener.hh"
 #include "CliConnection.hh"
+#include "EventDistributor.hh"
+#include "checked_cast.hh"
 #include "Thread.hh"
 #include "ScopedAssign.hh"
 #include "stl.hh"
@@ -10,16 +12,19 @@
 
 namespace openmsx {
 
-GlobalCliComm::GlobalCliComm()
-	: delivering(false)
+GlobalCliComm::GlobalCliComm(EventDistributor& eventDistributor_)
+	: eventDistributor(eventDistributor_)
+	, delivering(false)
 	, allowExternalCommands(false)
 {
+	eventDistributor.registerEventListener(OPENMSX_CLICOMMAND_EVENT, *this);
 }
 
 GlobalCliComm::~GlobalCliComm()
 {
 	assert(Thread::isMainThread());
 	assert(!delivering);
+	eventDistributor.unregisterEventListener(OPENMSX_CLICOMMAND_EVENT, *this);
 }
 
 void GlobalCliComm::addListener(std::unique_ptr<CliListener> listener)
@@ -101,6 +106,24 @@ void GlobalCliComm::update(UpdateType type, string_ref name, string_ref value)
 	updateHelper(type, {}, name, value);
 }
 
+int GlobalCliComm::signalEvent(const std::shared_ptr<const Event>& event)
+{
+	// Deliver the event only to the connection that sent it (if that
+	// connection still exists).
+	auto& connection = checked_cast<const CliCommandEvent&>(*event).getConnection();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (none_of(begin(listeners), end(listeners),
+		            [&](const std::unique_ptr<CliListener>& l) {
+					return l.get() == &connection; })) {
+			return 0;
+		}
+	}
+	// don't hold the lock while executing, commands can print messages
+	connection.executePending();
+	return 0;
+}
+
 void GlobalCliComm::updateHelper(UpdateType type, string_ref machine,
                                  string_ref name, string_ref value)
 {
@@ -2,6 +2,7 @@
 #define GLOBALCLICOMM_HH
 
 #include "CliComm.hh"
+#include "EventListener.hh"
 #include "hash_map.hh"
 #include "xxhash.hh"
 #include <memory>
@@ -11,14 +12,15 @@
 namespace openmsx {
 
 class CliListener;
+class EventDistributor;
 
-class GlobalCliComm final : public CliComm
+class GlobalCliComm final : public CliComm, private EventListener
 {
 public:
 	GlobalCliComm(const GlobalCliComm&) = delete;
 	GlobalCliComm& operator=(const GlobalCliComm&) = delete;
 
-	GlobalCliComm();
+	explicit GlobalCliComm(EventDistributor& eventDistributor);
 	~GlobalCliComm();
 
 	void addListener(std::unique_ptr<CliListener> listener);
@@ -37,6 +39,11 @@ private:
 	void updateHelper(UpdateType type, string_ref machine,
 	                  string_ref name, string_ref value);
 
+	// EventListener
+	int signalEvent(const std::shared_ptr<const Event>& event) override;
+
+	EventDistributor& eventDistributor;
+
 	hash_map<std::string, std::string, XXHasher> prevValues[NUM_UPDATES];
 
 	std::vector<std::unique_ptr<CliListener>> listeners; // unordered
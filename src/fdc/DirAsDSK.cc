@@ -3,10 +3,12 @@
 #include "Scheduler.hh"
 #include "CliComm.hh"
 #include "BootBlocks.hh"
+#include "DirWatcher.hh"
 #include "File.hh"
 #include "FileException.hh"
 #include "ReadDir.hh"
 #include "StringOp.hh"
+#include "memory.hh"
 #include "stl.hh"
 #include <algorithm>
 #include <cassert>
@@ -319,22 +321,35 @@ DirAsDSK::DirAsDSK(DiskChanger& diskChanger_, CliComm& cliComm_,
 	// No host files are mapped to this disk yet.
 	assert(mapDirs.empty());
 
-	// Import the host filesystem.
-	syncWithHost();
+	// Start watching before the initial import, so that no changes get
+	// lost.
+	watcher = make_unique<DirWatcher>(hostDir);
+
+	// Import the host filesystem. The watcher only reports changes that
+	// happen from now on, so this must be a full scan.
+	rescanHost();
 }
 
+DirAsDSK::~DirAsDSK() = default;
+
 bool DirAsDSK::isWriteProtectedImpl() const
 {
 	return syncMode == SYNC_READONLY;
 }
 
+bool DirAsDSK::longAgo(EmuTime::param now) const
+{
+	// 'lastAccess' can be in the future when a reverse snapshot was
+	// restored in place, treat that like a long pause as well.
+	return (now < lastAccess) || ((now - lastAccess) > EmuDuration::sec(1));
+}
+
 void DirAsDSK::checkCaches()
 {
 	bool needSync;
 	if (auto* scheduler = diskChanger.getScheduler()) {
 		auto now = scheduler->getCurrentTime();
-		auto delta = now - lastAccess;
-		needSync = delta > EmuDuration::sec(1);
+		needSync = longAgo(now);
 		// Do not update lastAccess because we don't actually call
 		// syncWithHost().
 	} else {
@@ -358,15 +373,13 @@ void DirAsDSK::readSectorImpl(size_t sector, SectorBuffer& buf)
 		bool needSync;
 		if (auto* scheduler = diskChanger.getScheduler()) {
 			auto now = scheduler->getCurrentTime();
-			auto delta = now - lastAccess;
+			needSync = longAgo(now);
 			lastAccess = now;
-			needSync = delta > EmuDuration::sec(1);
 		} else {
 			// Happens when dirasdisk is used in virtual_drive.
 			needSync = true;
 		}
-		if (needSync) {
-			syncWithHost();
+		if (needSync && syncWithHost()) {
 			flushCaches(); // e.g. sha1sum
 			// Let the diskdrive report the disk has been ejected.
 			// E.g. a turbor machine uses this to flush its
@@ -379,7 +392,26 @@ void DirAsDSK::readSectorImpl(size_t sector, SectorBuffer& buf)
 	memcpy(&buf, &sectors[sector], sizeof(buf));
 }
 
-void DirAsDSK::syncWithHost()
+// Returns false if it's certain nothing changed on the host side.
+bool DirAsDSK::syncWithHost()
+{
+	if (watcher->isActive()) {
+		std::set<string> changes;
+		if (watcher->getChanges(changes)) {
+			if (changes.empty()) return false;
+			syncChangedHostFiles(changes);
+			return true;
+		}
+		// Some changes were lost, start over with a fresh watcher and
+		// do a full rescan.
+		watcher = make_unique<DirWatcher>(hostDir);
+	}
+	rescanHost();
+	return true;
+}
+
+// Compare the whole host directory tree with the virtual disk.
+void DirAsDSK::rescanHost()
 {
 	// Check for removed host files. This frees up space in the virtual
 	// disk. Do this first because otherwise later actions may fail (run
@@ -396,6 +428,54 @@ void DirAsDSK::syncWithHost()
 	addNewHostFiles({}, firstDirSector);
 }
 
+// Same as the full sync above, but only look at the given host paths
+// (relative to 'hostDir'), as reported by the DirWatcher. The cost of this
+// only depends on the number of changes, not on the size of the host tree.
+void DirAsDSK::syncChangedHostFiles(const std::set<string>& hostPaths)
+{
+	// Same order as in syncWithHost(): first remove, then update, then
+	// add. 'hostPaths' is sorted, so a new directory is added before
+	// the files in it (those are then already added along with it).
+	for (auto& hostPath : hostPaths) {
+		DirIndex dirIndex = findHostFileInDSK(hostPath);
+		if (dirIndex.sector != unsigned(-1)) {
+			checkDeletedHostFile(dirIndex);
+		}
+	}
+	for (auto& hostPath : hostPaths) {
+		DirIndex dirIndex = findHostFileInDSK(hostPath);
+		if (dirIndex.sector != unsigned(-1)) {
+			checkModifiedHostFile(dirIndex);
+		}
+	}
+	for (auto& hostPath : hostPaths) {
+		if (checkFileUsedInDSK(hostPath)) continue;
+		string_ref hostSubDir, hostName;
+		StringOp::splitOnLast(hostPath, '/', hostSubDir, hostName);
+		if (StringOp::startsWith(hostName, '.')) continue;
+
+		unsigned msxDirSector = firstDirSector;
+		if (!hostSubDir.empty()) {
+			DirIndex dirIndex = findHostFileInDSK(hostSubDir.str());
+			if (dirIndex.sector == unsigned(-1)) {
+				// parent directory isn't present on the
+				// virtual disk (e.g. disk full)
+				continue;
+			}
+			unsigned cluster = msxDir(dirIndex).startCluster;
+			if (!(msxDir(dirIndex).attrib & MSXDirEntry::ATT_DIRECTORY) ||
+			    (cluster < FIRST_CLUSTER) || (cluster >= maxCluster)) {
+				continue;
+			}
+			msxDirSector = clusterToSector(cluster);
+		}
+		string subDir = hostSubDir.empty() ? string{} : hostSubDir.str() + '/';
+		if (FileOperations::exists(hostDir + hostPath)) {
+			addNewHostPath(subDir, hostName.str(), msxDirSector);
+		}
+	}
+}
+
 void DirAsDSK::checkDeletedHostFiles()
 {
 	// This handles both host files and directories.
@@ -412,22 +492,25 @@ void DirAsDSK::checkDeletedHostFiles()
 			// mapDirs. Ignore it.
 			continue;
 		}
-		const DirIndex& dirIndex = p.first;
-		MapDir& mapDir = p.second;
-		string fullHostName = hostDir + mapDir.hostName;
-		bool isMSXDirectory = (msxDir(dirIndex).attrib &
-		                       MSXDirEntry::ATT_DIRECTORY) != 0;
-		FileOperations::Stat fst;
-		if ((!FileOperations::getStat(fullHostName, fst)) ||
-		    (FileOperations::isDirectory(fst) != isMSXDirectory)) {
-			// TODO also check access permission
-			// Error stat-ing file, or directory/file type is not
-			// the same on the msx and host side (e.g. a host file
-			// has been removed and a host directory with the same
-			// name has been created). In both cases delete the msx
-			// entry (if needed it will be recreated soon).
-			deleteMSXFile(dirIndex);
-		}
+		checkDeletedHostFile(p.first);
+	}
+}
+
+void DirAsDSK::checkDeletedHostFile(DirIndex dirIndex)
+{
+	string fullHostName = hostDir + mapDirs[dirIndex].hostName;
+	bool isMSXDirectory = (msxDir(dirIndex).attrib &
+	                       MSXDirEntry::ATT_DIRECTORY) != 0;
+	FileOperations::Stat fst;
+	if ((!FileOperations::getStat(fullHostName, fst)) ||
+	    (FileOperations::isDirectory(fst) != isMSXDirectory)) {
+		// TODO also check access permission
+		// Error stat-ing file, or directory/file type is not
+		// the same on the msx and host side (e.g. a host file
+		// has been removed and a host directory with the same
+		// name has been created). In both cases delete the msx
+		// entry (if needed it will be recreated soon).
+		deleteMSXFile(dirIndex);
 	}
 }
 
@@ -502,33 +585,37 @@ void DirAsDSK::checkModifiedHostFiles()
 			// See comment in checkDeletedHostFiles().
 			continue;
 		}
-		const DirIndex& dirIndex = p.first;
-		MapDir& mapDir = p.second;
-		string fullHostName = hostDir + mapDir.hostName;
-		bool isMSXDirectory = (msxDir(dirIndex).attrib &
-		                       MSXDirEntry::ATT_DIRECTORY) != 0;
-		FileOperations::Stat fst;
-		if (FileOperations::getStat(fullHostName, fst) &&
-		    (FileOperations::isDirectory(fst) == isMSXDirectory)) {
-			// Detect changes in host file.
-			// Heuristic: we use filesize and modification time to detect
-			// changes in file content.
-			//  TODO do we need both filesize and mtime or is mtime alone
-			//       enough?
-			// We ignore time/size changes in directories,
-			// typically such a change indicates one of the files
-			// in that directory is changed/added/removed. But such
-			// changes are handled elsewhere.
-			if (!isMSXDirectory &&
-			    ((mapDir.mtime    != fst.st_mtime) ||
-			     (mapDir.filesize != size_t(fst.st_size)))) {
-				importHostFile(dirIndex, fst);
-			}
-		} else {
-			// Only very rarely happens (because checkDeletedHostFiles()
-			// checked this just recently).
-			deleteMSXFile(dirIndex);
+		checkModifiedHostFile(p.first);
+	}
+}
+
+void DirAsDSK::checkModifiedHostFile(DirIndex dirIndex)
+{
+	const MapDir& mapDir = mapDirs[dirIndex];
+	string fullHostName = hostDir + mapDir.hostName;
+	bool isMSXDirectory = (msxDir(dirIndex).attrib &
+	                       MSXDirEntry::ATT_DIRECTORY) != 0;
+	FileOperations::Stat fst;
+	if (FileOperations::getStat(fullHostName, fst) &&
+	    (FileOperations::isDirectory(fst) == isMSXDirectory)) {
+		// Detect changes in host file.
+		// Heuristic: we use filesize and modification time to detect
+		// changes in file content.
+		//  TODO do we need both filesize and mtime or is mtime alone
+		//       enough?
+		// We ignore time/size changes in directories,
+		// typically such a change indicates one of the files
+		// in that directory is changed/added/removed. But such
+		// changes are handled elsewhere.
+		if (!isMSXDirectory &&
+		    ((mapDir.mtime    != fst.st_mtime) ||
+		     (mapDir.filesize != size_t(fst.st_size)))) {
+			importHostFile(dirIndex, fst);
 		}
+	} else {
+		// Only very rarely happens (because checkDeletedHostFiles()
+		// checked this just recently).
+		deleteMSXFile(dirIndex);
 	}
 }
 
@@ -704,28 +791,34 @@ void DirAsDSK::addNewHostFiles(const string& hostSubDir, unsigned msxDirSector)
 	     [](const string& l, const string& r) { return weight(l) < weight(r); });
 
 	for (auto& hostName : hostNames) {
-		try {
-			if (StringOp::startsWith(hostName, '.')) {
-				// skip '.' and '..'
-				// also skip hidden files on unix
-				continue;
-			}
-			string fullHostName = hostDir + hostSubDir + hostName;
-			FileOperations::Stat fst;
-			if (!FileOperations::getStat(fullHostName, fst)) {
-				throw MSXException("Error accessing " + fullHostName);
-			}
-			if (FileOperations::isDirectory(fst)) {
-				addNewDirectory(hostSubDir, hostName, msxDirSector, fst);
-			} else if (FileOperations::isRegularFile(fst)) {
-				addNewHostFile(hostSubDir, hostName, msxDirSector, fst);
-			} else {
-				throw MSXException("Not a regular file: " +
-				                   fullHostName);
-			}
-		} catch (MSXException& e) {
-			cliComm.printWarning(e.getMessage());
+		if (StringOp::startsWith(hostName, '.')) {
+			// skip '.' and '..'
+			// also skip hidden files on unix
+			continue;
+		}
+		addNewHostPath(hostSubDir, hostName, msxDirSector);
+	}
+}
+
+void DirAsDSK::addNewHostPath(const string& hostSubDir, const string& hostName,
+                              unsigned msxDirSector)
+{
+	try {
+		string fullHostName = hostDir + hostSubDir + hostName;
+		FileOperations::Stat fst;
+		if (!FileOperations::getStat(fullHostName, fst)) {
+			throw MSXException("Error accessing " + fullHostName);
 		}
+		if (FileOperations::isDirectory(fst)) {
+			addNewDirectory(hostSubDir, hostName, msxDirSector, fst);
+		} else if (FileOperations::isRegularFile(fst)) {
+			addNewHostFile(hostSubDir, hostName, msxDirSector, fst);
+		} else {
+			throw MSXException("Not a regular file: " +
+			                   fullHostName);
+		}
+	} catch (MSXException& e) {
+		cliComm.printWarning(e.getMessage());
 	}
 }
 
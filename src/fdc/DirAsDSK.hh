@@ -6,11 +6,14 @@
 #include "FileOperations.hh"
 #include "EmuTime.hh"
 #include <map>
+#include <memory>
+#include <set>
 
 namespace openmsx {
 
 class DiskChanger;
 class CliComm;
+class DirWatcher;
 
 class DirAsDSK final : public SectorBasedDisk
 {
@@ -22,6 +25,7 @@ public:
 	DirAsDSK(DiskChanger& diskChanger, CliComm& cliComm,
 	         const Filename& hostDir, SyncMode syncMode,
 	         BootSectorType bootSectorType);
+	~DirAsDSK();
 
 	// SectorBasedDisk
 	void readSectorImpl (size_t sector,       SectorBuffer& buf) override;
@@ -61,12 +65,18 @@ private:
 	void writeDataSector(unsigned sector, const SectorBuffer& buf);
 	void writeDIREntry(DirIndex dirIndex, DirIndex dirDirIndex,
 	                   const MSXDirEntry& newEntry);
-	void syncWithHost();
+	bool longAgo(EmuTime::param now) const;
+	bool syncWithHost();
+	void rescanHost();
+	void syncChangedHostFiles(const std::set<std::string>& hostPaths);
 	void checkDeletedHostFiles();
+	void checkDeletedHostFile(DirIndex dirIndex);
 	void deleteMSXFile(DirIndex dirIndex);
 	void deleteMSXFilesInDir(unsigned msxDirSector);
 	void freeFATChain(unsigned cluster);
 	void addNewHostFiles(const std::string& hostSubDir, unsigned msxDirSector);
+	void addNewHostPath(const std::string& hostSubDir, const std::string& hostName,
+	                    unsigned msxDirSector);
 	void addNewDirectory(const std::string& hostSubDir, const std::string& hostName,
                              unsigned msxDirSector, FileOperations::Stat& fst);
 	void addNewHostFile(const std::string& hostSubDir, const std::string& hostName,
@@ -81,6 +91,7 @@ private:
 	bool checkMSXFileExists(const std::string& msxfilename,
 	                        unsigned msxDirSector);
 	void checkModifiedHostFiles();
+	void checkModifiedHostFile(DirIndex dirIndex);
 	void setMSXTimeStamp(DirIndex dirIndex, FileOperations::Stat& fst);
 	void importHostFile(DirIndex dirIndex, FileOperations::Stat& fst);
 	void exportToHost(DirIndex dirIndex, DirIndex dirDirIndex);
@@ -121,6 +132,11 @@ private:
 
 	EmuTime lastAccess; // last time there was a sector read/write
 
+	// Reports changes in the host directory, so that a sync only has to
+	// look at the changed files instead of rescanning the whole tree.
+	// Null or inactive when not supported, then we fall back to polling.
+	std::unique_ptr<DirWatcher> watcher;
+
 	// For each directory entry that has a mapped host file/directory we
 	// store the name, last modification time and size of the corresponding
 	// host file/dir.
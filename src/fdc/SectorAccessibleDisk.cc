@@ -58,6 +58,59 @@ void SectorAccessibleDisk::writeSector(size_t sector, const SectorBuffer& buf)
 	flushCaches();
 }
 
+void SectorAccessibleDisk::readSectorRange(
+	size_t startSector, SectorBuffer* buffers, size_t nbSectors)
+{
+	if (hasPatches() || isDummyDisk() || (startSector <= 1)) {
+		// Let readSector() handle all the special cases.
+		for (auto i : xrange(nbSectors)) {
+			readSector(startSector + i, buffers[i]);
+		}
+		return;
+	}
+	if (getNbSectors() < (startSector + nbSectors)) {
+		throw NoSuchSectorException("No such sector");
+	}
+	try {
+		readSectorsImpl(startSector, buffers, nbSectors);
+	} catch (MSXException& e) {
+		throw DiskIOErrorException("Disk I/O error: " + e.getMessage());
+	}
+}
+
+void SectorAccessibleDisk::writeSectorRange(
+	size_t startSector, const SectorBuffer* buffers, size_t nbSectors)
+{
+	if (isWriteProtected()) {
+		throw WriteProtectedException({});
+	}
+	if (!isDummyDisk() && (getNbSectors() < (startSector + nbSectors))) {
+		throw NoSuchSectorException("No such sector");
+	}
+	try {
+		writeSectorsImpl(startSector, buffers, nbSectors);
+	} catch (MSXException& e) {
+		throw DiskIOErrorException("Disk I/O error: " + e.getMessage());
+	}
+	flushCaches();
+}
+
+void SectorAccessibleDisk::readSectorsImpl(
+	size_t startSector, SectorBuffer* buffers, size_t nbSectors)
+{
+	for (auto i : xrange(nbSectors)) {
+		readSectorImpl(startSector + i, buffers[i]);
+	}
+}
+
+void SectorAccessibleDisk::writeSectorsImpl(
+	size_t startSector, const SectorBuffer* buffers, size_t nbSectors)
+{
+	for (auto i : xrange(nbSectors)) {
+		writeSectorImpl(startSector + i, buffers[i]);
+	}
+}
+
 size_t SectorAccessibleDisk::getNbSectors() const
 {
 	return getNbSectorsImpl();
@@ -109,9 +162,7 @@ int SectorAccessibleDisk::readSectors (
 	SectorBuffer* buffers, size_t startSector, size_t nbSectors)
 {
 	try {
-		for (auto i : xrange(nbSectors)) {
-			readSector(startSector + i, buffers[i]);
-		}
+		readSectorRange(startSector, buffers, nbSectors);
 		return 0;
 	} catch (MSXException&) {
 		return -1;
@@ -122,9 +173,7 @@ int SectorAccessibleDisk::writeSectors(
 	const SectorBuffer* buffers, size_t startSector, size_t nbSectors)
 {
 	try {
-		for (auto i : xrange(nbSectors)) {
-			writeSector(startSector + i, buffers[i]);
-		}
+		writeSectorRange(startSector, buffers, nbSectors);
 		return 0;
 	} catch (MSXException&) {
 		return -1;
@@ -22,6 +22,17 @@ public:
 	void writeSector(size_t sector, const SectorBuffer& buf);
 	size_t getNbSectors() const;
 
+	/** Read/write a range of consecutive sectors. This has the same
+	 * effect as calling readSector()/writeSector() for each sector in
+	 * the range, but subclasses can implement it more efficiently (e.g.
+	 * as a single file operation).
+	 * @throws same exceptions as readSector()/writeSector()
+	 */
+	void readSectorRange (size_t startSector,       SectorBuffer* buffers,
+	                      size_t nbSectors);
+	void writeSectorRange(size_t startSector, const SectorBuffer* buffers,
+	                      size_t nbSectors);
+
 	// write protected stuff
 	bool isWriteProtected() const;
 	void forceWriteProtect();
@@ -39,7 +50,6 @@ public:
 	Sha1Sum getSha1Sum(FilePool& filepool);
 
 	// For compatibility with nowind
-	//  - read/write multiple sectors instead of one-per-one
 	//  - use error codes instead of exceptions
 	//  - different order of parameters
 	int readSectors (      SectorBuffer* buffers, size_t startSector,
@@ -64,6 +74,11 @@ protected:
 private:
 	virtual void readSectorImpl (size_t sector,       SectorBuffer& buf) = 0;
 	virtual void writeSectorImpl(size_t sector, const SectorBuffer& buf) = 0;
+	// Default implementation calls read/writeSectorImpl() for each sector.
+	virtual void readSectorsImpl (size_t startSector,       SectorBuffer* buffers,
+	                              size_t nbSectors);
+	virtual void writeSectorsImpl(size_t startSector, const SectorBuffer* buffers,
+	                              size_t nbSectors);
 	virtual size_t getNbSectorsImpl() const = 0;
 	virtual bool isWriteProtectedImpl() const = 0;
 
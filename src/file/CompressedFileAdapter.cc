@@ -1,8 +1,15 @@
 #include "CompressedFileAdapter.hh"
+#include "InflateIndex.hh"
+#include "ZlibInflate.hh"
 #include "FileException.hh"
+#include "FileOperations.hh"
+#include "StringOp.hh"
 #include "hash_set.hh"
 #include "xxhash.hh"
+#include "memory.hh"
+#include <algorithm>
 #include <cstring>
+#include <mutex>
 
 using std::string;
 
@@ -15,15 +22,22 @@ struct GetURLFromDecompressed {
 };
 static hash_set<std::shared_ptr<CompressedFileAdapter::Decompressed>,
                 GetURLFromDecompressed, XXHasher> decompressCache;
+// Files can be opened from multiple threads (e.g. FilePool scanning).
+static std::mutex decompressCacheMutex;
+
+// Files that decompress to at least this size are not decompressed in one
+// go, instead they're decompressed on demand (see InflateIndex).
+static const size_t STREAMING_THRESHOLD = 32 * 1024 * 1024;
 
 
 CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_)
-	: file(std::move(file_)), pos(0)
+	: file(std::move(file_)), streamData(nullptr), streamSize(0), pos(0)
 {
 }
 
 CompressedFileAdapter::~CompressedFileAdapter()
 {
+	std::lock_guard<std::mutex> lock(decompressCacheMutex);
 	auto it = decompressCache.find(getURL());
 	decompressed.reset();
 	if (it != end(decompressCache) && it->unique()) {
@@ -32,29 +46,116 @@ CompressedFileAdapter::~CompressedFileAdapter()
 	}
 }
 
+// Deflate can't compress better than about 1:1032, so a larger 'uncompressed
+// size' in the header is certainly wrong.
+static size_t sanitizeSizeHint(size_t hint, size_t compressedSize)
+{
+	return std::min(hint, compressedSize * 1032);
+}
+
+// Prepare for reading: small files are decompressed completely, for big
+// files we switch to streaming mode.
+void CompressedFileAdapter::open()
+{
+	if (decompressed || index) return;
+	bool cached;
+	{
+		std::lock_guard<std::mutex> lock(decompressCacheMutex);
+		cached = decompressCache.contains(getURL());
+	}
+	if (cached) {
+		// someone already has the full data, share it
+		decompress();
+		return;
+	}
+
+	size_t size;
+	const byte* data = file->mmap(size);
+	// only parses the header, so doesn't need the full (possibly >4GB) input
+	ZlibInflate zlib(data, std::min<size_t>(size, 1 << 30));
+	string name;
+	size_t hint = sanitizeSizeHint(readHeader(zlib, data, size, name), size);
+	if (std::max(hint, size) < STREAMING_THRESHOLD) {
+		decompress();
+		return;
+	}
+	streamOriginalName = std::move(name);
+	openStreaming(data, size, zlib.getInputPos() - data);
+}
+
+// Get the index for the deflate stream starting at data[start]. Building the
+// index requires decompressing the whole stream once, so store it in the
+// user data directory. It's keyed on URL, size and modification time.
+void CompressedFileAdapter::openStreaming(
+	const byte* data, size_t size, size_t start)
+{
+	string url = getURL();
+	string key = StringOp::Builder() << url << '\n' << size << '\n'
+	                                 << getModificationDate();
+	string indexFile = FileOperations::getUserDataDir() + "/inflateindex/" +
+	                   StringOp::toHexString(xxhash(url), 8) + ".idx";
+	streamData = data + start;
+	streamSize = size - start;
+	try {
+		index = make_unique<InflateIndex>(indexFile, key);
+	} catch (MSXException&) {
+		index = make_unique<InflateIndex>(streamData, streamSize);
+		index->save(indexFile, key);
+	}
+}
+
+// Fully decompress the file in memory (shared with other adapters for the
+// same file). Always used for mmap().
 void CompressedFileAdapter::decompress()
 {
 	if (decompressed) return;
 
 	string url = getURL();
-	auto it = decompressCache.find(url);
-	if (it != end(decompressCache)) {
-		decompressed = *it;
-	} else {
-		decompressed = std::make_shared<Decompressed>();
-		decompress(*file, *decompressed);
-		decompressed->cachedModificationDate = getModificationDate();
-		decompressed->cachedURL = std::move(url);
-		decompressCache.insert_noDuplicateCheck(decompressed);
+	{
+		std::lock_guard<std::mutex> lock(decompressCacheMutex);
+		auto it = decompressCache.find(url);
+		if (it != end(decompressCache)) {
+			decompressed = *it;
+		}
+	}
+	if (!decompressed) {
+		// decompress without holding the lock
+		auto tmp = std::make_shared<Decompressed>();
+		size_t size;
+		const byte* data = file->mmap(size);
+		ZlibInflate zlib(data, size);
+		size_t hint = sanitizeSizeHint(
+			readHeader(zlib, data, size, tmp->originalName), size);
+		tmp->size = zlib.inflate(tmp->buf, hint ? hint : 65536);
+		tmp->cachedModificationDate = getModificationDate();
+		tmp->cachedURL = std::move(url);
+
+		std::lock_guard<std::mutex> lock(decompressCacheMutex);
+		auto it = decompressCache.find(tmp->cachedURL);
+		if (it != end(decompressCache)) {
+			// another thread was faster
+			decompressed = *it;
+		} else {
+			decompressed = std::move(tmp);
+			decompressCache.insert_noDuplicateCheck(decompressed);
+		}
 	}
 
 	// close original file after succesful decompress
+	index.reset();
+	streamData = nullptr;
 	file.reset();
 }
 
 void CompressedFileAdapter::read(void* buffer, size_t num)
 {
-	decompress();
+	open();
+	if (!decompressed) {
+		index->read(streamData, streamSize, pos,
+		            static_cast<byte*>(buffer), num);
+		pos += num;
+		return;
+	}
 	if (decompressed->size < (pos + num)) {
 		throw FileException("Read beyond end of file");
 	}
@@ -82,8 +183,8 @@ void CompressedFileAdapter::munmap()
 
 size_t CompressedFileAdapter::getSize()
 {
-	decompress();
-	return decompressed->size;
+	open();
+	return decompressed ? decompressed->size : index->getSize();
 }
 
 void CompressedFileAdapter::seek(size_t newpos)
@@ -113,8 +214,8 @@ const string CompressedFileAdapter::getURL() const
 
 const string CompressedFileAdapter::getOriginalName()
 {
-	decompress();
-	return decompressed->originalName;
+	open();
+	return decompressed ? decompressed->originalName : streamOriginalName;
 }
 
 bool CompressedFileAdapter::isReadOnly() const
@@ -122,6 +223,11 @@ bool CompressedFileAdapter::isReadOnly() const
 	return true;
 }
 
+bool CompressedFileAdapter::isCompressed() const
+{
+	return true;
+}
+
 time_t CompressedFileAdapter::getModificationDate()
 {
 	return file ? file->getModificationDate()
@@ -7,6 +7,9 @@
 
 namespace openmsx {
 
+class ZlibInflate;
+class InflateIndex;
+
 class CompressedFileAdapter : public FileBase
 {
 public:
@@ -30,18 +33,40 @@ public:
 	const std::string getURL() const final override;
 	const std::string getOriginalName() final override;
 	bool isReadOnly() const final override;
+	bool isCompressed() const final override;
 	time_t getModificationDate() final override;
 
 protected:
 	explicit CompressedFileAdapter(std::unique_ptr<FileBase> file);
 	~CompressedFileAdapter();
-	virtual void decompress(FileBase& file, Decompressed& decompressed) = 0;
+
+	/** Parse the header of the compressed file. On return 'zlib' must be
+	 * positioned at the start of the raw deflate stream.
+	 * @param zlib Reads from the start of the compressed file.
+	 * @param data Pointer to the complete compressed file.
+	 * @param size Size of the compressed file.
+	 * @param originalName Filled in with the name of the compressed file.
+	 * @result The uncompressed size as stored in the file, or 0 if
+	 *         unknown. This is only used as a hint.
+	 */
+	virtual size_t readHeader(ZlibInflate& zlib, const byte* data,
+	                          size_t size, std::string& originalName) = 0;
 
 private:
+	void open();
 	void decompress();
+	void openStreaming(const byte* data, size_t size, size_t start);
 
 	std::unique_ptr<FileBase> file;
 	std::shared_ptr<Decompressed> decompressed;
+
+	// Streaming mode (only for big files): decompress on demand via an
+	// index, 'file' stays open (and mmap'ed) while in this mode.
+	std::unique_ptr<InflateIndex> index;
+	const byte* streamData;
+	size_t streamSize;
+	std::string streamOriginalName;
+
 	size_t pos;
 };
 
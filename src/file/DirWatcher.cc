@@ -0,0 +1,127 @@
+#include "DirWatcher.hh"
+#include "ReadDir.hh"
+#include "FileOperations.hh"
+#include "StringOp.hh"
+#include <cerrno>
+#include <cstdint>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+
+namespace openmsx {
+
+#ifdef __linux__
+static const uint32_t WATCH_MASK =
+	IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+	IN_MOVED_FROM | IN_MOVED_TO | IN_MOVE_SELF | IN_DELETE_SELF |
+	IN_ONLYDIR;
+#endif
+
+DirWatcher::DirWatcher(const string& dir_)
+	: dir(dir_)
+	, fd(-1)
+{
+#ifdef __linux__
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1) return;
+	if (!addWatches({})) {
+		// too many subdirectories, caller must poll instead
+		close(fd);
+		fd = -1;
+		watches.clear();
+	}
+#endif
+}
+
+DirWatcher::~DirWatcher()
+{
+#ifdef __linux__
+	if (fd != -1) close(fd);
+#endif
+}
+
+// Watch the given subdirectory and (recursively) all its subdirectories.
+bool DirWatcher::addWatches(const string& subDir)
+{
+#ifdef __linux__
+	if (watches.size() >= MAX_WATCHES) return false;
+	int wd = inotify_add_watch(fd, (dir + subDir).c_str(), WATCH_MASK);
+	if (wd == -1) {
+		// The directory may already be removed again, the parent
+		// watch reports that. All other errors are fatal.
+		return errno == ENOENT;
+	}
+	watches[wd] = subDir;
+
+	ReadDir readDir(dir + subDir);
+	while (auto* d = readDir.getEntry()) {
+		string name = d->d_name;
+		if (StringOp::startsWith(name, '.')) {
+			// skip '.' and '..', also skip hidden directories
+			continue;
+		}
+		string path = subDir + name;
+		if (FileOperations::isDirectory(dir + path)) {
+			if (!addWatches(path + '/')) return false;
+		}
+	}
+	return true;
+#else
+	(void)subDir;
+	return false;
+#endif
+}
+
+bool DirWatcher::getChanges(std::set<string>& paths)
+{
+#ifdef __linux__
+	if (fd == -1) return false;
+	bool complete = true;
+	alignas(inotify_event) char buf[4096];
+	while (true) {
+		auto len = read(fd, buf, sizeof(buf));
+		if (len <= 0) break; // EAGAIN: no more pending events
+		for (char* p = buf; p < (buf + len); /**/) {
+			auto* event = reinterpret_cast<const inotify_event*>(p);
+			p += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				complete = false;
+				continue;
+			}
+			if (event->mask & IN_IGNORED) {
+				// watch removed (directory was deleted)
+				watches.erase(event->wd);
+				continue;
+			}
+			auto it = watches.find(event->wd);
+			if (it == end(watches)) continue;
+			if (event->mask & IN_MOVE_SELF) {
+				// A watched directory got renamed, the paths we
+				// stored for it (and its subdirectories) are
+				// now wrong.
+				complete = false;
+				continue;
+			}
+			if (event->len == 0) continue; // event on the dir itself
+
+			string path = it->second + event->name;
+			paths.insert(path);
+			if ((event->mask & IN_ISDIR) &&
+			    (event->mask & (IN_CREATE | IN_MOVED_TO)) &&
+			    !StringOp::startsWith(string_ref(event->name), '.')) {
+				if (!addWatches(path + '/')) complete = false;
+			}
+		}
+	}
+	return complete;
+#else
+	(void)paths;
+	return false;
+#endif
+}
+
+} // namespace openmsx
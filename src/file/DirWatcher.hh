@@ -0,0 +1,58 @@
+#ifndef DIRWATCHER_HH
+#define DIRWATCHER_HH
+
+#include <map>
+#include <set>
+#include <string>
+
+namespace openmsx {
+
+/** Keeps track of changes in a host directory tree.
+ *
+ * On Linux this uses inotify: checking for changes is then cheap and does
+ * not depend on the size of the tree. Hidden entries (starting with '.')
+ * are not watched. On other platforms, or when inotify can't be used (e.g.
+ * because the per-user limit on the number of watches is reached, or the
+ * tree has more than MAX_WATCHES directories), isActive() returns false and
+ * the caller has to rescan the tree itself.
+ */
+class DirWatcher
+{
+public:
+	DirWatcher(const DirWatcher&) = delete;
+	DirWatcher& operator=(const DirWatcher&) = delete;
+
+	/** @param dir The directory to watch, must end with a '/'. */
+	explicit DirWatcher(const std::string& dir);
+	~DirWatcher();
+
+	/** Can this object report changes? */
+	bool isActive() const { return fd != -1; }
+
+	/** Collect the paths (relative to the watched directory) of all
+	 * files and directories that were created, deleted or modified
+	 * since the previous call. For a newly created directory only the
+	 * directory itself is reported, not its content.
+	 * @return false if changes may have been lost (e.g. event queue
+	 *         overflow or a directory was renamed). The caller should
+	 *         then rescan the whole tree and create a new DirWatcher.
+	 */
+	bool getChanges(std::set<std::string>& paths);
+
+private:
+	// Each watched directory uses kernel memory and counts towards the
+	// per-user limit (shared with all other processes), so don't watch
+	// arbitrarily large trees. A disk image can't hold that many
+	// directories anyway.
+	static const unsigned MAX_WATCHES = 256;
+
+	bool addWatches(const std::string& subDir);
+
+	const std::string dir;
+	std::map<int, std::string> watches; // watch descriptor -> subdir
+	int fd;
+};
+
+} // namespace openmsx
+
+#endif
@@ -142,6 +142,11 @@ bool File::isReadOnly() const
 	return file->isReadOnly();
 }
 
+bool File::isCompressed() const
+{
+	return file->isCompressed();
+}
+
 time_t File::getModificationDate()
 {
 	return file->getModificationDate();
@@ -134,6 +134,12 @@ public:
 	 */
 	bool isReadOnly() const;
 
+	/** Check if this file is transparently decompressed. For such files
+	 * mmap() is expensive: it has to decompress the whole file.
+	 * @result true iff file is (g)zipped
+	 */
+	bool isCompressed() const;
+
 	/** Get the date/time of last modification
 	 * @throws FileException
 	 */
@@ -55,6 +55,11 @@ const string FileBase::getLocalReference()
 	return {};
 }
 
+bool FileBase::isCompressed() const
+{
+	return false;
+}
+
 const string FileBase::getOriginalName()
 {
 	// default implementation just returns filename portion of URL
@@ -30,6 +30,7 @@ public:
 	virtual const std::string getLocalReference();
 	virtual const std::string getOriginalName();
 	virtual bool isReadOnly() const = 0;
+	virtual bool isCompressed() const;
 	virtual time_t getModificationDate() = 0;
 
 private:
@@ -16,13 +16,16 @@
 #include "StringOp.hh"
 #include "memory.hh"
 #include "sha1.hh"
-#include "stl.hh"
+#include "endian.hh"
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <thread>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 
 using std::ifstream;
-using std::get;
-using std::make_tuple;
 using std::ofstream;
 using std::string;
 using std::vector;
@@ -41,7 +44,8 @@ private:
 };
 
 
-const char* const FILE_CACHE = "/.filecache";
+const char* const FILE_CACHE     = "/.filecache";
+const char* const FILE_CACHE_BIN = "/.filecache.bin";
 
 static string initialFilePoolSettingValue()
 {
@@ -73,11 +77,11 @@ FilePool::FilePool(CommandController& controller, Reactor& reactor_)
 		initialFilePoolSettingValue())
 	, reactor(reactor_)
 	, quit(false)
+	, needWrite(false)
 {
 	filePoolSetting.attach(*this);
 	reactor.getEventDistributor().registerEventListener(OPENMSX_QUIT_EVENT, *this);
 	readSha1sums();
-	needWrite = false;
 
 	sha1SumCommand = make_unique<Sha1SumCommand>(controller, *this);
 }
@@ -91,46 +95,32 @@ FilePool::~FilePool()
 	filePoolSetting.detach(*this);
 }
 
-void FilePool::insert(const Sha1Sum& sum, time_t time, const string& filename)
+FilePool::Pool::iterator FilePool::insert(
+	const Sha1Sum& sum, time_t time, const string& filename)
 {
-	auto it = upper_bound(begin(pool), end(pool), sum,
-	                      LessTupleElement<0>());
-	pool.insert(it, make_tuple(sum, time, filename));
+	auto it = pool.emplace(sum, FileInfo{time, filename});
+	filenameIndex.insert_noDuplicateCheck(
+		std::make_pair(string_ref(it->second.filename), it));
 	needWrite = true;
+	return it;
 }
 
 void FilePool::remove(Pool::iterator it)
 {
+	filenameIndex.erase(string_ref(it->second.filename));
 	pool.erase(it);
 	needWrite = true;
 }
 
-// Change the sha1sum of the element pointed to by 'it' into 'newSum'.
-// Also re-arrange the items so that pool remains sorted on sha1sum. Internally
-// this method doesn't actually sort, it merely rotates the elements.
-// Returns false if the new position is before (or at) the old position.
-// Returns true  if the new position is after          the old position.
-bool FilePool::adjust(Pool::iterator it, const Sha1Sum& newSum)
+// Change the sha1sum (and timestamp) of the element pointed to by 'it'. This
+// moves the element to a new position in the pool (the iterator to that new
+// position is returned), iterators to other elements remain valid.
+FilePool::Pool::iterator FilePool::adjust(
+	Pool::iterator it, const Sha1Sum& newSum, time_t newTime)
 {
-	needWrite = true;
-	auto newIt = upper_bound(begin(pool), end(pool), newSum,
-	                         LessTupleElement<0>());
-	get<0>(*it) = newSum; // update sum
-	if (newIt > it) {
-		// move to back
-		rotate(it, it + 1, newIt);
-		return true;
-	} else {
-		if (newIt < it) {
-			// move to front
-			rotate(newIt, it, it + 1);
-		} else {
-			// (unlikely) sha1sum has changed, but after
-			// resorting item would remain in the same
-			// position
-		}
-		return false;
-	}
+	string filename = it->second.filename; // copy, 'it' gets removed
+	remove(it);
+	return insert(newSum, newTime, filename);
 }
 
 static bool parse(const string& line, Sha1Sum& sha1, time_t& time, string& filename)
@@ -150,11 +140,69 @@ static bool parse(const string& line, Sha1Sum& sha1, time_t& time, string& filen
 	return true;
 }
 
+// The cache is stored in a binary format:
+//   8 bytes     magic
+//   4 bytes     number of entries (little endian)
+// followed by that many entries:
+//   20 bytes    sha1sum
+//   8 bytes     timestamp (little endian)
+//   4 bytes     length of the filename (little endian)
+//   N bytes     filename
+// The entries are sorted on sha1sum.
+static const char BINARY_MAGIC[8] = { 'o','M','S','X','p','o','o','2' };
+
 void FilePool::readSha1sums()
 {
 	assert(pool.empty());
 
-	string cacheFile = FileOperations::getUserDataDir() + FILE_CACHE;
+	string dir = FileOperations::getUserDataDir();
+	if (!readBinarySha1sums(dir + FILE_CACHE_BIN)) {
+		// no (valid) binary cache, fall back to the old text format
+		pool.clear();
+		filenameIndex.clear();
+		readTextSha1sums(dir + FILE_CACHE);
+	}
+}
+
+bool FilePool::readBinarySha1sums(const string& cacheFile)
+{
+	try {
+		File file(cacheFile);
+		size_t size;
+		const byte* data = file.mmap(size);
+		const byte* last = data + size;
+		if ((size < 12) ||
+		    (memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)) {
+			return false;
+		}
+		unsigned num = Endian::read_UA_L32(data + 8);
+		data += 12;
+		filenameIndex.reserve(num);
+		Sha1Sum sum;
+		for (unsigned i = 0; i < num; ++i) {
+			if ((last - data) < (20 + 8 + 4)) return false;
+			sum.parse20(data);
+			auto time = time_t(Endian::read_UA_L64(data + 20));
+			size_t len = Endian::read_UA_L32(data + 28);
+			data += 32;
+			if (size_t(last - data) < len) return false;
+			string filename(reinterpret_cast<const char*>(data), len);
+			data += len;
+			// entries are sorted, so always insert at the end
+			auto it = pool.emplace_hint(
+				end(pool), sum, FileInfo{time, std::move(filename)});
+			filenameIndex.insert_noDuplicateCheck(
+				std::make_pair(string_ref(it->second.filename), it));
+		}
+		return true;
+	} catch (MSXException&) {
+		// file doesn't exist or can't be mapped
+		return false;
+	}
+}
+
+void FilePool::readTextSha1sums(const string& cacheFile)
+{
 	ifstream file(cacheFile.c_str());
 	string line;
 	Sha1Sum sum;
@@ -162,33 +210,53 @@ void FilePool::readSha1sums()
 	time_t time;
 	while (file.good()) {
 		getline(file, line);
-		if (parse(line, sum, time, filename)) {
-			pool.emplace_back(sum, time, filename);
+		if (parse(line, sum, time, filename) &&
+		    !filenameIndex.contains(string_ref(filename))) {
+			insert(sum, time, filename);
 		}
 	}
-
-	if (!std::is_sorted(begin(pool), end(pool), LessTupleElement<0>())) {
-		// This should _rarely_ happen. In fact it should only happen
-		// when .filecache was manually edited. Though because it's
-		// very important that pool is indeed sorted I've added this
-		// safety mechanism.
-		sort(begin(pool), end(pool), LessTupleElement<0>());
-	}
+	// convert to the binary format on exit
+	needWrite = true;
 }
 
 void FilePool::writeSha1sums()
 {
-	string cacheFile = FileOperations::getUserDataDir() + FILE_CACHE;
-	ofstream file;
-	FileOperations::openofstream(file, cacheFile);
-	if (!file.is_open()) {
-		return;
+	// Write to a temporary file first: other instances may have the cache
+	// mmap'ed (see readBinarySha1sums()), it must not be changed in place.
+	string cacheFile = FileOperations::getUserDataDir() + FILE_CACHE_BIN;
+	string tmpName = cacheFile + ".tmp" + StringOp::toString(Timer::getTime());
+	{
+		ofstream file;
+		FileOperations::openofstream(file, tmpName,
+		                             std::ios::out | std::ios::binary);
+		if (!file.is_open()) {
+			return;
+		}
+		byte buf[12];
+		memcpy(buf, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+		Endian::write_UA_L32(buf + 8, unsigned(pool.size()));
+		file.write(reinterpret_cast<const char*>(buf), 12);
+		for (auto& p : pool) {
+			const auto& filename = p.second.filename;
+			byte entry[20 + 8 + 4];
+			p.first.write20(entry);
+			Endian::write_UA_L64(entry + 20, uint64_t(p.second.time));
+			Endian::write_UA_L32(entry + 28, unsigned(filename.size()));
+			file.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+			file << filename;
+		}
+		if (!file.good()) {
+			file.close();
+			FileOperations::unlink(tmpName);
+			return;
+		}
 	}
-	for (auto& p : pool) {
-		file << get<0>(p).toString()      << "  " // sum
-		     << Date::toString(get<1>(p)) << "  " // date
-		     << get<2>(p)                         // filename
-		     << '\n';
+	if (std::rename(tmpName.c_str(), cacheFile.c_str()) != 0) {
+		// e.g. on windows when the destination exists
+		FileOperations::unlink(cacheFile);
+		if (std::rename(tmpName.c_str(), cacheFile.c_str()) != 0) {
+			FileOperations::unlink(tmpName);
+		}
 	}
 }
 
@@ -337,15 +405,16 @@ static Sha1Sum calcSha1sum(File& file, Reactor& reactor)
 
 File FilePool::getFromPool(const Sha1Sum& sha1sum)
 {
-	auto bound = equal_range(begin(pool), end(pool), sha1sum,
-	                         LessTupleElement<0>());
-	// use indices instead of iterators
-	auto i    = distance(begin(pool), bound.first);
-	auto last = distance(begin(pool), bound.second);
-	while (i != last) {
-		auto it = begin(pool) + i;
-		auto& time           = get<1>(*it);
-		const auto& filename = get<2>(*it);
+	// Adjusting an entry moves it to another position in the pool, so
+	// first collect all candidates (this doesn't invalidate iterators).
+	auto bound = pool.equal_range(sha1sum);
+	vector<Pool::iterator> candidates;
+	for (auto it = bound.first; it != bound.second; ++it) {
+		candidates.push_back(it);
+	}
+	for (auto it : candidates) {
+		auto time = it->second.time;
+		const auto& filename = it->second.filename;
 		try {
 			File file(filename);
 			auto newTime = file.getModificationDate();
@@ -355,28 +424,19 @@ File FilePool::getFromPool(const Sha1Sum& sha1sum)
 				// expensive sha1sum calculation.
 				return file;
 			}
-			time = newTime; // update timestamp
-			needWrite = true;
 			auto newSum = calcSha1sum(file, reactor);
+			// update timestamp (and sha1sum)
+			adjust(it, newSum, newTime);
 			if (newSum == sha1sum) {
 				// Modification time was changed, but
 				// (recalculated) sha1sum is still the same.
 				return file;
 			}
-			// Sha1sum has changed: update sha1sum, move entry to
-			// new position new sum and continue searching.
-			if (adjust(it, newSum)) {
-				// after
-				--last; // no ++i
-			} else {
-				// before (or at)
-				++i;
-			}
+			// Sha1sum has changed, continue searching.
 		} catch (FileException&) {
 			// Error reading file: remove from db and continue
 			// searching.
 			remove(it);
-			--last;
 		}
 	}
 	return File(); // not found
@@ -385,6 +445,19 @@ File FilePool::getFromPool(const Sha1Sum& sha1sum)
 File FilePool::scanDirectory(
 	const Sha1Sum& sha1sum, const string& directory, const string& poolPath,
 	ScanProgress& progress)
+{
+	// First walk the directory tree: files that are already in the
+	// database (with matching timestamp) are checked immediately, all
+	// others are collected and then hashed in parallel.
+	vector<HashJob> jobs;
+	File result = collectFiles(sha1sum, directory, poolPath, progress, jobs);
+	if (result.is_open() || quit || jobs.empty()) return result;
+	return hashFiles(sha1sum, jobs, poolPath);
+}
+
+File FilePool::collectFiles(
+	const Sha1Sum& sha1sum, const string& directory, const string& poolPath,
+	ScanProgress& progress, vector<HashJob>& jobs)
 {
 	ReadDir dir(directory);
 	while (dirent* d = dir.getEntry()) {
@@ -400,10 +473,12 @@ File FilePool::scanDirectory(
 		if (FileOperations::getStat(path, st)) {
 			File result;
 			if (FileOperations::isRegularFile(st)) {
-				result = scanFile(sha1sum, path, st, poolPath, progress);
+				result = scanFile(sha1sum, path, st, poolPath,
+				                  progress, jobs);
 			} else if (FileOperations::isDirectory(st)) {
 				if ((file != ".") && (file != "..")) {
-					result = scanDirectory(sha1sum, path, poolPath, progress);
+					result = collectFiles(sha1sum, path, poolPath,
+					                      progress, jobs);
 				}
 			}
 			if (result.is_open()) return result;
@@ -414,7 +489,7 @@ File FilePool::scanDirectory(
 
 File FilePool::scanFile(const Sha1Sum& sha1sum, const string& filename,
                         const FileOperations::Stat& st, const string& poolPath,
-                        ScanProgress& progress)
+                        ScanProgress& progress, vector<HashJob>& jobs)
 {
 	++progress.amountScanned;
 	// Periodically send a progress message with the current filename
@@ -431,62 +506,113 @@ File FilePool::scanFile(const Sha1Sum& sha1sum, const string& filename,
 	// deliver, so it's ok to call on each file.
 	reactor.getEventDistributor().deliverEvents();
 
+	auto time = FileOperations::getModificationDate(st);
 	auto it = findInDatabase(filename);
-	if (it == end(pool)) {
-		// not in pool
-		try {
-			File file(filename);
-			auto sum = calcSha1sum(file, reactor);
-			auto time = FileOperations::getModificationDate(st);
-			insert(sum, time, filename);
-			if (sum == sha1sum) {
-				return file;
+	if ((it != end(pool)) && (time == it->second.time)) {
+		// db is still up to date
+		if (it->first == sha1sum) {
+			try {
+				return File(filename);
+			} catch (FileException&) {
+				// error reading file, remove from db
+				remove(it);
 			}
-		} catch (FileException&) {
-			// ignore
 		}
 	} else {
-		// already in pool
-		assert(filename == get<2>(*it));
-		try {
-			auto time = FileOperations::getModificationDate(st);
-			if (time == get<1>(*it)) {
-				// db is still up to date
-				if (get<0>(*it) == sha1sum) {
-					return File(filename);
+		// not in pool or db outdated
+		jobs.push_back(HashJob{filename, time, Sha1Sum(), false, false});
+	}
+	return File(); // not found
+}
+
+File FilePool::hashFiles(const Sha1Sum& sha1sum, vector<HashJob>& jobs,
+                         const string& poolPath)
+{
+	std::atomic<size_t> next(0);
+	std::atomic<size_t> done(0);
+	std::atomic<unsigned> active(0);
+	std::atomic<bool> stop(false);
+
+	auto worker = [&]() {
+		while (!stop) {
+			size_t i = next++;
+			if (i >= jobs.size()) break;
+			auto& job = jobs[i];
+			try {
+				File file(job.filename);
+				size_t size;
+				const byte* data = file.mmap(size);
+				job.sum = SHA1::calc(data, size);
+				job.ok = true;
+				if (job.sum == sha1sum) {
+					// found, no need to hash the other files
+					stop = true;
 				}
+			} catch (FileException&) {
+				job.ok = false;
+			}
+			job.hashed = true;
+			++done;
+		}
+		--active;
+	};
+
+	unsigned numThreads = std::max(1u, std::thread::hardware_concurrency());
+	numThreads = unsigned(std::min<size_t>(numThreads, jobs.size()));
+	active = numThreads;
+	vector<std::thread> threads;
+	for (unsigned i = 0; i < numThreads; ++i) {
+		threads.emplace_back(worker);
+	}
+
+	// Meanwhile keep the application responsive and show progress.
+	auto lastTime = Timer::getTime();
+	while (active != 0) {
+		Timer::sleep(10000); // 10ms
+		reactor.getEventDistributor().deliverEvents();
+		if (quit) stop = true;
+		auto now = Timer::getTime();
+		if (now > (lastTime + 250000)) { // 4Hz
+			lastTime = now;
+			reactor.getCliComm().printProgress(
+				"Searching for file with sha1sum " +
+				sha1sum.toString() + "...\nCalculating SHA1 sums in " +
+				poolPath + ": [" + StringOp::toString(size_t(done)) +
+				'/' + StringOp::toString(jobs.size()) + ']');
+		}
+	}
+	for (auto& t : threads) t.join();
+
+	// Store the results in the database (only done in this thread).
+	File result;
+	for (auto& job : jobs) {
+		if (!job.hashed) continue;
+		auto it = findInDatabase(job.filename);
+		if (job.ok) {
+			if (it == end(pool)) {
+				insert(job.sum, job.time, job.filename);
 			} else {
-				// db outdated
-				File file(filename);
-				auto sum = calcSha1sum(file, reactor);
-				get<1>(*it) = time;
-				adjust(it, sum);
-				if (sum == sha1sum) {
-					return file;
+				adjust(it, job.sum, job.time);
+			}
+			if (!result.is_open() && (job.sum == sha1sum)) {
+				try {
+					result = File(job.filename);
+				} catch (FileException&) {
+					// ignore
 				}
 			}
-		} catch (FileException&) {
+		} else if (it != end(pool)) {
 			// error reading file, remove from db
 			remove(it);
 		}
 	}
-	return File(); // not found
+	return result;
 }
 
 FilePool::Pool::iterator FilePool::findInDatabase(const string& filename)
 {
-	// Linear search in pool for filename.
-	// Search from back to front because often, soon after this search, we
-	// will insert/remove an element from the vector. This requires
-	// shifting all elements in the vector starting from a certain
-	// position. Starting the search from the back increases the likelihood
-	// that the to-be-shifted elements are already in the memory cache.
-	for (auto it = pool.rbegin(); it != pool.rend(); ++it) {
-		if (get<2>(*it) == filename) {
-			return it.base() - 1;
-		}
-	}
-	return end(pool); // not found
+	auto it = filenameIndex.find(string_ref(filename));
+	return (it != end(filenameIndex)) ? it->second : end(pool);
 }
 
 Sha1Sum FilePool::getSha1Sum(File& file)
@@ -495,10 +621,10 @@ Sha1Sum FilePool::getSha1Sum(File& file)
 	const auto& filename = file.getURL();
 
 	auto it = findInDatabase(filename);
-	if ((it != end(pool)) && (get<1>(*it) == time)) {
+	if ((it != end(pool)) && (it->second.time == time)) {
 		// in database and modification time matches,
 		// assume sha1sum also matches
-		return get<0>(*it);
+		return it->first;
 	}
 
 	// not in database or timestamp mismatch
@@ -508,8 +634,7 @@ Sha1Sum FilePool::getSha1Sum(File& file)
 		insert(sum, time, filename);
 	} else {
 		// was already in database, but with wrong timestamp (and sha1sum)
-		get<1>(*it) = time;
-		adjust(it, sum);
+		adjust(it, sum, time);
 	}
 	return sum;
 }
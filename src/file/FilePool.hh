@@ -6,9 +6,12 @@
 #include "Observer.hh"
 #include "EventListener.hh"
 #include "sha1.hh"
+#include "hash_map.hh"
+#include "xxhash.hh"
+#include "string_ref.hh"
+#include <map>
 #include <memory>
 #include <string>
-#include <tuple>
 #include <vector>
 #include <ctime>
 #include <cstdint>
@@ -52,15 +55,34 @@ private:
 		int types;
 	};
 	using Directories = std::vector<Entry>;
+	struct FileInfo {
+		time_t time;
+		std::string filename;
+	};
+	// A file that still needs its sha1sum calculated during a scan.
+	struct HashJob {
+		std::string filename;
+		time_t time;
+		Sha1Sum sum;
+		bool hashed;
+		bool ok;
+	};
 
-	// <sha1sum, timestamp, filename>, sorted on sha1sum
-	using Pool = std::vector<std::tuple<Sha1Sum, time_t, std::string>>;
+	// Sorted on sha1sum. Iterators remain valid on insert/remove, so an
+	// index on filename can point directly into this structure (and the
+	// key of that index points to the filename stored here).
+	using Pool = std::multimap<Sha1Sum, FileInfo>;
+	using FilenameIndex = hash_map<string_ref, Pool::iterator, XXHasher>;
 
-	void insert(const Sha1Sum& sum, time_t time, const std::string& filename);
+	Pool::iterator insert(const Sha1Sum& sum, time_t time,
+	                      const std::string& filename);
 	void remove(Pool::iterator it);
-	bool adjust(Pool::iterator it, const Sha1Sum& newSum);
+	Pool::iterator adjust(Pool::iterator it, const Sha1Sum& newSum,
+	                      time_t newTime);
 
 	void readSha1sums();
+	bool readBinarySha1sums(const std::string& filename);
+	void readTextSha1sums(const std::string& filename);
 	void writeSha1sums();
 
 	File getFromPool(const Sha1Sum& sha1sum);
@@ -68,11 +90,20 @@ private:
 	                   const std::string& directory,
 	                   const std::string& poolPath,
 	                   ScanProgress& progress);
+	File collectFiles(const Sha1Sum& sha1sum,
+	                  const std::string& directory,
+	                  const std::string& poolPath,
+	                  ScanProgress& progress,
+	                  std::vector<HashJob>& jobs);
 	File scanFile(const Sha1Sum& sha1sum,
 	              const std::string& filename,
 	              const FileOperations::Stat& st,
 	              const std::string& poolPath,
-	              ScanProgress& progress);
+	              ScanProgress& progress,
+	              std::vector<HashJob>& jobs);
+	File hashFiles(const Sha1Sum& sha1sum,
+	               std::vector<HashJob>& jobs,
+	               const std::string& poolPath);
 	Pool::iterator findInDatabase(const std::string& filename);
 
 	Directories getDirectories() const;
@@ -88,6 +119,7 @@ private:
 	Reactor& reactor;
 
 	Pool pool;
+	FilenameIndex filenameIndex;
 	bool quit;
 	bool needWrite;
 
@@ -1,6 +1,7 @@
 #include "GZFileAdapter.hh"
 #include "ZlibInflate.hh"
 #include "FileException.hh"
+#include "endian.hh"
 
 namespace openmsx {
 
@@ -53,15 +54,14 @@ static bool skipHeader(ZlibInflate& zlib, std::string& originalName)
 	return true;
 }
 
-void GZFileAdapter::decompress(FileBase& f, Decompressed& d)
+size_t GZFileAdapter::readHeader(ZlibInflate& zlib, const byte* data,
+                                 size_t size, std::string& originalName)
 {
-	size_t size;
-	const byte* data = f.mmap(size);
-	ZlibInflate zlib(data, size);
-	if (!skipHeader(zlib, d.originalName)) {
+	if (!skipHeader(zlib, originalName)) {
 		throw FileException("Not a gzip header");
 	}
-	d.size = zlib.inflate(d.buf);
+	// The trailer contains the uncompressed size (modulo 2^32).
+	return (size >= 18) ? Endian::read_UA_L32(data + size - 4) : 0;
 }
 
 } // namespace openmsx
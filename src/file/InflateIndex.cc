@@ -0,0 +1,296 @@
+#include "InflateIndex.hh"
+#include "File.hh"
+#include "FileException.hh"
+#include "FileOperations.hh"
+#include "StringOp.hh"
+#include "Timer.hh"
+#include "endian.hh"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <zlib.h>
+
+namespace openmsx {
+
+// Distance (in decompressed bytes) between two access points. Each access
+// point costs WINDOW_SIZE bytes, so this is a trade-off between the size of
+// the index and the amount of work for a random access.
+static const size_t SPAN = 1024 * 1024;
+
+// Maximum number of decompressed spans that are kept in memory.
+static const size_t NUM_SPANS = 16;
+
+static const char INDEX_MAGIC[8] = { 'o','M','S','X','z','i','d','x' };
+
+namespace {
+// Small wrapper around a raw (no zlib or gzip header) inflate stream. The
+// input is fed in chunks, so that inputs larger than 4GB also work.
+struct Inflater
+{
+	Inflater(const byte* input_, size_t inputSize_, size_t inPos_)
+		: input(input_), inputSize(inputSize_), inPos(inPos_)
+	{
+		memset(&s, 0, sizeof(s));
+		int err = inflateInit2(&s, -MAX_WBITS);
+		if (err != Z_OK) {
+			throw FileException(StringOp::Builder()
+				<< "Error initializing inflate struct: " << zError(err));
+		}
+	}
+	~Inflater()
+	{
+		inflateEnd(&s);
+	}
+
+	// Returns the zlib status. Z_BUF_ERROR means the input is exhausted.
+	int inflate(int flush)
+	{
+		if (s.avail_in == 0) {
+			size_t chunk = std::min<size_t>(inputSize - inPos, 1 << 30);
+			s.next_in = const_cast<byte*>(input + inPos);
+			s.avail_in = uInt(chunk);
+			inPos += chunk;
+		}
+		return ::inflate(&s, flush);
+	}
+
+	// Position in the input of the next byte that will be consumed.
+	size_t getInputPos() const
+	{
+		return inPos - s.avail_in;
+	}
+
+	z_stream s;
+	const byte* input;
+	size_t inputSize;
+	size_t inPos;
+};
+} // namespace
+
+static void checkError(int err)
+{
+	if (err == Z_BUF_ERROR) {
+		throw FileException(
+			"Error while decompressing: unexpected end of file.");
+	}
+	if ((err != Z_OK) && (err != Z_STREAM_END)) {
+		throw FileException(StringOp::Builder()
+			<< "Error while decompressing: " << zError(err));
+	}
+}
+
+InflateIndex::InflateIndex(const byte* input, size_t inputSize)
+	: totalOut(0), useCounter(0)
+{
+	// The start of the stream is always a valid access point. It has no
+	// preceding output, zero the window so that no uninitialized data
+	// ends up in the index (and in the saved file).
+	byte window[WINDOW_SIZE] = {};
+	addPoint(0, 0, 0, WINDOW_SIZE, window);
+
+	Inflater zlib(input, inputSize, 0);
+	size_t last = 0;
+	while (true) {
+		if (zlib.s.avail_out == 0) {
+			zlib.s.next_out = window;
+			zlib.s.avail_out = WINDOW_SIZE;
+		}
+		// Z_BLOCK: stop at the end of each deflate block
+		auto before = zlib.s.avail_out;
+		int err = zlib.inflate(Z_BLOCK);
+		totalOut += before - zlib.s.avail_out;
+		if (err == Z_STREAM_END) break;
+		if (err == Z_NEED_DICT) err = Z_DATA_ERROR;
+		checkError(err);
+
+		// Bit 7 of data_type: at the end of a block. Bit 6: that was
+		// the last block, so there's no next block to restart from.
+		if ((zlib.s.data_type & 128) && !(zlib.s.data_type & 64) &&
+		    ((totalOut - last) > SPAN)) {
+			addPoint(zlib.s.data_type & 7, zlib.getInputPos(),
+			         totalOut, zlib.s.avail_out, window);
+			last = totalOut;
+		}
+	}
+}
+
+void InflateIndex::addPoint(unsigned bits, size_t in, size_t out,
+                            unsigned left, const byte* window)
+{
+	points.push_back(Point{out, in, bits});
+
+	// The window is a circular buffer, 'left' bytes at the end are not
+	// yet overwritten in this round. Store it in linear order.
+	auto w = windows.size();
+	windows.resize(w + WINDOW_SIZE);
+	if (left) {
+		memcpy(&windows[w], window + WINDOW_SIZE - left, left);
+	}
+	if (left < WINDOW_SIZE) {
+		memcpy(&windows[w + left], window, WINDOW_SIZE - left);
+	}
+}
+
+InflateIndex::InflateIndex(const std::string& filename, string_ref key)
+	: useCounter(0)
+{
+	File file(filename);
+	size_t size;
+	const byte* data = file.mmap(size);
+	const byte* last = data + size;
+
+	size_t headerSize = 8 + 4 + key.size() + 8 + 4;
+	if ((size < headerSize) ||
+	    (memcmp(data, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) ||
+	    (Endian::read_UA_L32(data + 8) != key.size()) ||
+	    (memcmp(data + 12, key.data(), key.size()) != 0)) {
+		throw FileException("Invalid inflate index");
+	}
+	data += 12 + key.size();
+	totalOut = size_t(Endian::read_UA_L64(data));
+	size_t num = Endian::read_UA_L32(data + 8);
+	data += 12;
+	if ((num == 0) ||
+	    (size_t(last - data) != num * (17 + WINDOW_SIZE))) {
+		throw FileException("Invalid inflate index");
+	}
+	points.reserve(num);
+	for (size_t i = 0; i < num; ++i) {
+		points.push_back(Point{
+			size_t(Endian::read_UA_L64(data + 0)),
+			size_t(Endian::read_UA_L64(data + 8)),
+			data[16]});
+		data += 17;
+	}
+	windows.assign(data, last);
+}
+
+void InflateIndex::save(const std::string& filename, string_ref key) const
+{
+	std::vector<byte> header(8 + 4 + key.size() + 8 + 4);
+	memcpy(header.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	Endian::write_UA_L32(&header[8], unsigned(key.size()));
+	memcpy(&header[12], key.data(), key.size());
+	Endian::write_UA_L64(&header[12 + key.size()], totalOut);
+	Endian::write_UA_L32(&header[20 + key.size()], unsigned(points.size()));
+	for (auto& p : points) {
+		byte buf[17];
+		Endian::write_UA_L64(buf + 0, p.out);
+		Endian::write_UA_L64(buf + 8, p.in);
+		buf[16] = byte(p.bits);
+		header.insert(header.end(), buf, buf + sizeof(buf));
+	}
+
+	// Write to a temporary file first, so that concurrently running
+	// instances never see a half written index.
+	std::string tmpName = filename + ".tmp" + StringOp::toString(Timer::getTime());
+	try {
+		FileOperations::mkdirp(FileOperations::getDirName(filename));
+		std::ofstream out;
+		FileOperations::openofstream(out, tmpName,
+		                             std::ios::out | std::ios::binary);
+		if (!out.is_open()) return;
+		out.write(reinterpret_cast<const char*>(header.data()), header.size());
+		out.write(reinterpret_cast<const char*>(windows.data()), windows.size());
+		if (!out.good()) {
+			out.close();
+			FileOperations::unlink(tmpName);
+			return;
+		}
+	} catch (MSXException&) {
+		return;
+	}
+	if (std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+		// e.g. on windows when the destination exists
+		FileOperations::unlink(filename);
+		if (std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+			FileOperations::unlink(tmpName);
+		}
+	}
+}
+
+void InflateIndex::read(const byte* input, size_t inputSize,
+                        size_t offset, byte* output, size_t num)
+{
+	if ((offset > totalOut) || (num > (totalOut - offset))) {
+		throw FileException("Read beyond end of file");
+	}
+	while (num) {
+		// find last access point at or before 'offset'
+		auto it = std::upper_bound(begin(points), end(points), offset,
+			[](size_t o, const Point& p) { return o < p.out; });
+		size_t point = (it - begin(points)) - 1;
+		size_t spanEnd = (it != end(points)) ? it->out : totalOut;
+
+		auto& span = getSpan(input, inputSize, point);
+		size_t skip = offset - points[point].out;
+		size_t n = std::min(num, spanEnd - offset);
+		memcpy(output, span.data.data() + skip, n);
+		output += n;
+		offset += n;
+		num    -= n;
+	}
+}
+
+InflateIndex::Span& InflateIndex::getSpan(
+	const byte* input, size_t inputSize, size_t point)
+{
+	++useCounter;
+	for (auto& span : spans) {
+		if (span.point == point) {
+			span.lastUse = useCounter;
+			return span;
+		}
+	}
+
+	// not cached, reuse the least recently used span
+	if (spans.size() < NUM_SPANS) {
+		spans.push_back(Span{size_t(-1), 0, MemBuffer<byte>()});
+	}
+	auto& span = *std::min_element(begin(spans), end(spans),
+		[](const Span& a, const Span& b) { return a.lastUse < b.lastUse; });
+	size_t spanEnd = (point + 1 < points.size()) ? points[point + 1].out
+	                                              : totalOut;
+	span.point = size_t(-1); // in case decompression throws
+	span.data.resize(spanEnd - points[point].out);
+	decompressSpan(input, inputSize, point, span.data.data());
+	span.point = point;
+	span.lastUse = useCounter;
+	return span;
+}
+
+void InflateIndex::decompressSpan(const byte* input, size_t inputSize,
+                                  size_t point, byte* output)
+{
+	const auto& p = points[point];
+	size_t spanEnd = (point + 1 < points.size()) ? points[point + 1].out
+	                                              : totalOut;
+	size_t len = spanEnd - p.out;
+	if (len == 0) return;
+	if ((p.in > inputSize) || (p.bits && (p.in == 0))) {
+		throw FileException("Invalid inflate index");
+	}
+
+	Inflater zlib(input, inputSize, p.in);
+	if (p.bits) {
+		// the access point starts in the middle of a byte
+		inflatePrime(&zlib.s, p.bits, input[p.in - 1] >> (8 - p.bits));
+	}
+	inflateSetDictionary(&zlib.s, &windows[point * WINDOW_SIZE], WINDOW_SIZE);
+
+	zlib.s.next_out = output;
+	zlib.s.avail_out = uInt(len);
+	while (zlib.s.avail_out) {
+		int err = zlib.inflate(Z_NO_FLUSH);
+		if (err == Z_STREAM_END) break;
+		checkError(err);
+	}
+	if (zlib.s.avail_out) {
+		throw FileException(
+			"Error while decompressing: unexpected end of stream.");
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,93 @@
+#ifndef INFLATEINDEX_HH
+#define INFLATEINDEX_HH
+
+#include "MemBuffer.hh"
+#include "string_ref.hh"
+#include "openmsx.hh"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace openmsx {
+
+/** Random access into a raw deflate stream.
+ *
+ * This uses the technique from zlib's examples/zran.c: one pass over the
+ * whole stream records, roughly every SPAN bytes of output, the state that
+ * is needed to restart decompression at that point (the position of a
+ * deflate block boundary in the input plus the preceding 32kB of output).
+ * A later read only needs to decompress starting from the nearest
+ * preceding access point. The most recently decompressed spans are kept in
+ * a small LRU cache, so memory usage stays bounded, even for huge streams.
+ *
+ * The index can be saved to a file so that it only has to be built once.
+ */
+class InflateIndex
+{
+public:
+	/** Build an index by decompressing the complete stream once.
+	 * @param input Pointer to the start of the raw deflate stream.
+	 * @param inputSize Size of the input (may extend past the end of
+	 *                  the stream).
+	 * @throws FileException
+	 */
+	InflateIndex(const byte* input, size_t inputSize);
+
+	/** Load a previously saved index.
+	 * @param filename The file to load from.
+	 * @param key Must be equal to the key that was given to save().
+	 * @throws MSXException if the file doesn't exist, is invalid or
+	 *                      belongs to a different key.
+	 */
+	InflateIndex(const std::string& filename, string_ref key);
+
+	/** Store this index in a file. Errors are silently ignored.
+	 * @param filename The file to write to.
+	 * @param key An arbitrary string that identifies the input stream.
+	 */
+	void save(const std::string& filename, string_ref key) const;
+
+	/** Size of the decompressed data. */
+	size_t getSize() const { return totalOut; }
+
+	/** Decompress (part of) the stream.
+	 * @param input The same input that was used to build this index.
+	 * @param inputSize The size of that input.
+	 * @param offset Position in the decompressed data.
+	 * @param output Destination buffer.
+	 * @param num Number of bytes to read.
+	 * @throws FileException
+	 */
+	void read(const byte* input, size_t inputSize,
+	          size_t offset, byte* output, size_t num);
+
+private:
+	static const size_t WINDOW_SIZE = 32768;
+
+	struct Point {
+		size_t out; // position in the output (decompressed) data
+		size_t in;  // position of the first full byte in the input
+		unsigned bits; // number of bits (1-7) from the byte before 'in'
+	};
+	struct Span {
+		size_t point; // index in 'points', or size_t(-1) if unused
+		unsigned lastUse;
+		MemBuffer<byte> data;
+	};
+
+	void addPoint(unsigned bits, size_t in, size_t out,
+	              unsigned left, const byte* window);
+	Span& getSpan(const byte* input, size_t inputSize, size_t point);
+	void decompressSpan(const byte* input, size_t inputSize,
+	                    size_t point, byte* output);
+
+	std::vector<Point> points;
+	std::vector<byte> windows; // WINDOW_SIZE bytes per access point
+	std::vector<Span> spans; // LRU cache of decompressed spans
+	size_t totalOut;
+	unsigned useCounter;
+};
+
+} // namespace openmsx
+
+#endif
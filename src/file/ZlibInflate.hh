@@ -21,6 +21,9 @@ public:
 	std::string getString(size_t len);
 	std::string getCString();
 
+	/** Current position in the input buffer. */
+	const byte* getInputPos() const { return s.next_in; }
+
 	size_t inflate(MemBuffer<byte>& output, size_t sizeHint = 65536);
 
 private:
@@ -13,9 +13,11 @@
 #include "HDCommand.hh"
 #include "Timer.hh"
 #include "serialize.hh"
+#include "serialize_stl.hh"
 #include "memory.hh"
-#include "xrange.hh"
 #include <cassert>
+#include <cstring>
+#include <vector>
 
 namespace openmsx {
 
@@ -24,6 +26,9 @@ using std::string;
 HD::HD(const DeviceConfig& config)
 	: motherBoard(config.getMotherBoard())
 	, name("hdX")
+	, mapping(nullptr)
+	, mappingFailed(false)
+	, overlayEnabled(config.getChildDataAsBool("overlay", false))
 {
 	hdInUse = motherBoard.getSharedStuff<HDInUse>("hdInUse");
 
@@ -51,8 +56,7 @@ HD::HD(const DeviceConfig& config)
 		filename = Filename(cliImage, userFileContext());
 	}
 
-	file = File(filename, mode);
-	filesize = file.getSize();
+	openFile(filename, mode);
 	if (mode == File::CREATE && filesize == 0) {
 		// OK, the file was just newly created. Now make sure the file
 		// is of the right (default) size
@@ -75,6 +79,7 @@ HD::HD(const DeviceConfig& config)
 
 HD::~HD()
 {
+	saveTigerTree();
 	motherBoard.getMSXCliComm().update(CliComm::HARDWARE, name, "remove");
 
 	unsigned id = name[2] - 'a';
@@ -82,11 +87,22 @@ HD::~HD()
 	(*hdInUse)[id] = false;
 }
 
+void HD::openFile(const Filename& name, File::OpenMode mode)
+{
+	file = File(name, mode);
+	filesize = file.getSize();
+	mapping = nullptr;
+	// mmap() of a compressed file decompresses the whole image, while
+	// read() can decompress on demand
+	mappingFailed = file.isCompressed();
+}
+
 void HD::switchImage(const Filename& newFilename)
 {
-	file = File(newFilename);
+	saveTigerTree();
+	openFile(newFilename, File::NORMAL);
+	overlay.clear(); // these changes were for the old image
 	filename = newFilename;
-	filesize = file.getSize();
 	tigerTree = make_unique<TigerTree>(*this, filesize,
 			filename.getResolved());
 	motherBoard.getMSXCliComm().update(CliComm::MEDIA, getName(),
@@ -98,28 +114,126 @@ size_t HD::getNbSectorsImpl() const
 	return filesize / sizeof(SectorBuffer);
 }
 
+uint8_t* HD::getMapping()
+{
+	if (!mapping && !mappingFailed) {
+		try {
+			// Earlier writes may still be buffered in stdio, those
+			// must be visible in the mapping.
+			file.flush();
+			size_t size;
+			// The mapping is private (copy-on-write), so it's
+			// safe to also apply our own writes to it.
+			mapping = const_cast<uint8_t*>(file.mmap(size));
+			if (size < filesize) {
+				file.munmap();
+				mapping = nullptr;
+				mappingFailed = true;
+			}
+		} catch (MSXException&) {
+			// e.g. not enough address space for a huge image on a
+			// 32-bit host, fall back to regular file I/O
+			mapping = nullptr;
+			mappingFailed = true;
+		}
+	}
+	return mapping;
+}
+
 void HD::readSectorImpl(size_t sector, SectorBuffer& buf)
 {
-	file.seek(sector * sizeof(buf));
-	file.read(&buf, sizeof(buf));
+	readSectorsImpl(sector, &buf, 1);
 }
 
 void HD::writeSectorImpl(size_t sector, const SectorBuffer& buf)
 {
-	file.seek(sector * sizeof(buf));
-	file.write(&buf, sizeof(buf));
-	tigerTree->notifyChange(sector * sizeof(buf), sizeof(buf),
-	                        file.getModificationDate());
+	writeSectorsImpl(sector, &buf, 1);
+}
+
+void HD::readSectorsImpl(
+	size_t startSector, SectorBuffer* buffers, size_t nbSectors)
+{
+	readFromFile(startSector * sizeof(SectorBuffer), buffers,
+	             nbSectors * sizeof(SectorBuffer));
+	size_t endSector = startSector + nbSectors;
+	for (auto it = overlay.lower_bound(startSector);
+	     (it != end(overlay)) && (it->first < endSector); ++it) {
+		buffers[it->first - startSector] = it->second;
+	}
+}
+
+void HD::writeSectorsImpl(
+	size_t startSector, const SectorBuffer* buffers, size_t nbSectors)
+{
+	if (overlayEnabled) {
+		for (size_t i = 0; i < nbSectors; ++i) {
+			overlay[startSector + i] = buffers[i];
+		}
+	} else {
+		writeToFile(startSector * sizeof(SectorBuffer), buffers,
+		            nbSectors * sizeof(SectorBuffer));
+	}
+}
+
+void HD::readFromFile(size_t offset, void* data, size_t size)
+{
+	if (auto* mem = getMapping()) {
+		memcpy(data, mem + offset, size);
+	} else {
+		file.seek(offset);
+		file.read(data, size);
+	}
+}
+
+void HD::writeToFile(size_t offset, const void* data, size_t size)
+{
+	file.seek(offset);
+	file.write(data, size);
+	if (mapping) {
+		memcpy(mapping + offset, data, size);
+	}
+	tigerTree->notifyChange(offset, size, file.getModificationDate());
+}
+
+void HD::setOverlay(bool enabled)
+{
+	if (!enabled && !overlay.empty()) {
+		throw MSXException(
+			"The overlay contains changes, commit or discard them "
+			"first.");
+	}
+	overlayEnabled = enabled;
+}
+
+void HD::commitOverlay()
+{
+	if (file.isReadOnly()) {
+		throw MSXException("Image " + filename.getResolved() +
+		                   " is read-only.");
+	}
+	for (auto& p : overlay) {
+		writeToFile(p.first * sizeof(SectorBuffer), &p.second,
+		            sizeof(SectorBuffer));
+	}
+	overlay.clear();
+	flushCaches();
+}
+
+void HD::discardOverlay()
+{
+	overlay.clear();
+	flushCaches();
 }
 
 bool HD::isWriteProtectedImpl() const
 {
-	return file.isReadOnly();
+	// with an overlay, the (shared) image itself is never written
+	return !overlayEnabled && file.isReadOnly();
 }
 
 Sha1Sum HD::getSha1SumImpl(FilePool& filePool)
 {
-	if (hasPatches()) {
+	if (hasPatches() || !overlay.empty()) {
 		return SectorAccessibleDisk::getSha1SumImpl(filePool);
 	}
 	return filePool.getSha1Sum(file);
@@ -152,6 +266,18 @@ std::string HD::getTigerTreeHash()
 	return tigerTree->calcHash(callback).toString(); // calls HD::getData()
 }
 
+void HD::saveTigerTree()
+{
+	if (!file.is_open()) return; // e.g. closed in serialize()
+	try {
+		// flush first, so that we store the final modification time
+		file.flush();
+		tigerTree->save(file.getModificationDate());
+	} catch (MSXException&) {
+		// ignore, the persistent tree is only an optimization
+	}
+}
+
 uint8_t* HD::getData(size_t offset, size_t size)
 {
 	assert(size <= 1024);
@@ -165,11 +291,11 @@ uint8_t* HD::getData(size_t offset, size_t size)
 	};
 	static Work work; // not reentrant
 
-	size_t sector = offset / sizeof(SectorBuffer);
-	for (auto i : xrange(size / sizeof(SectorBuffer))) {
-		// This possibly applies IPS patches.
-		readSector(sector++, work.bufs[i]);
-	}
+	// The tree describes the image file itself: the content of the
+	// overlay is not included (it's stored separately in savestates,
+	// and writes to it are not reported via notifyChange()). HDs
+	// never have IPS patches, so read the file directly.
+	readFromFile(offset, work.bufs, size);
 	return work.bufs[0].raw;
 }
 
@@ -206,13 +332,46 @@ int HD::insertDisk(string_ref newDisk)
 	}
 }
 
+template<typename Archive>
+void HD::serializeOverlay(Archive& ar)
+{
+	// Stored as a list of sector numbers plus one blob with the content
+	// of those sectors (in the same order).
+	std::vector<unsigned> sectors;
+	std::vector<SectorBuffer> data;
+	if (!ar.isLoader()) {
+		for (auto& p : overlay) {
+			sectors.push_back(unsigned(p.first));
+			data.push_back(p.second);
+		}
+	}
+	ar.serialize("overlaySectors", sectors);
+	if (sectors.empty()) {
+		overlay.clear();
+		return;
+	}
+	data.resize(sectors.size());
+	ar.serialize_blob("overlayData", data.data(),
+	                  data.size() * sizeof(SectorBuffer));
+	if (ar.isLoader()) {
+		overlay.clear();
+		for (size_t i = 0; i < sectors.size(); ++i) {
+			overlay[sectors[i]] = data[i];
+		}
+	}
+}
+
 // version 1: initial version
 // version 2: replaced 'checksum'(=sha1) with 'tthsum`
+// version 3: added copy-on-write overlay
 template<typename Archive>
 void HD::serialize(Archive& ar, unsigned version)
 {
 	Filename tmp = file.is_open() ? filename : Filename();
 	ar.serialize("filename", tmp);
+	if (ar.versionAtLeast(version, 3)) {
+		ar.serialize("overlayEnabled", overlayEnabled);
+	}
 	if (ar.isLoader()) {
 		if (tmp.empty()) {
 			// Lazily open file specified in config. And close if
@@ -231,7 +390,9 @@ void HD::serialize(Archive& ar, unsigned version)
 			//  - So to get in the same state as the initial
 			//    savestate we again close the file. Otherwise the
 			//    checksum-check code below goes wrong.
+			saveTigerTree();
 			file.close();
+			mapping = nullptr;
 		} else {
 			tmp.updateAfterLoadState();
 			if (filename != tmp) switchImage(tmp);
@@ -243,7 +404,30 @@ void HD::serialize(Archive& ar, unsigned version)
 	if (file.is_open()) {
 		bool mismatch = false;
 
-		if (ar.versionAtLeast(version, 2)) {
+		if (overlayEnabled && ar.versionAtLeast(version, 3)) {
+			// The image itself isn't modified, so only reference it
+			// by sha1 (cached by the file pool) and store the
+			// modified sectors.
+			auto& filepool = motherBoard.getReactor().getFilePool();
+			string baseSha1 = ar.isLoader()
+			                ? string{}
+			                : filepool.getSha1Sum(file).toString();
+			ar.serialize("baseSha1", baseSha1);
+			if (ar.isLoader()) {
+				Sha1Sum oldSum(baseSha1);
+				if (filepool.getSha1Sum(file) != oldSum) {
+					// try to locate the original image
+					File base = filepool.getFile(FilePool::DISK, oldSum);
+					if (base.is_open()) {
+						tmp = Filename(base.getURL());
+						switchImage(tmp);
+					} else {
+						mismatch = true;
+					}
+				}
+			}
+			serializeOverlay(ar);
+		} else if (ar.versionAtLeast(version, 2)) {
 			// use tiger-tree-hash
 			string oldTiger = ar.isLoader() ? string{} : getTigerTreeHash();
 			ar.serialize("tthsum", oldTiger);
@@ -8,6 +8,7 @@
 #include "TigerTree.hh"
 #include "serialize_meta.hh"
 #include <bitset>
+#include <map>
 #include <string>
 #include <memory>
 
@@ -30,6 +31,18 @@ public:
 
 	std::string getTigerTreeHash();
 
+	/** Copy-on-write overlay. While enabled, writes don't go to the image
+	  * file but are kept (in memory) per sector. The image file itself is
+	  * then only read, so it can be shared between several instances.
+	  */
+	bool isOverlayEnabled() const { return overlayEnabled; }
+	size_t getOverlaySectors() const { return overlay.size(); }
+	void setOverlay(bool enabled);
+	/** Write all sectors in the overlay to the image file. */
+	void commitOverlay();
+	/** Forget all sectors in the overlay. */
+	void discardOverlay();
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -39,6 +52,10 @@ private:
 	// SectorAccessibleDisk:
 	void readSectorImpl (size_t sector,       SectorBuffer& buf) override;
 	void writeSectorImpl(size_t sector, const SectorBuffer& buf) override;
+	void readSectorsImpl (size_t startSector,       SectorBuffer* buffers,
+	                      size_t nbSectors) override;
+	void writeSectorsImpl(size_t startSector, const SectorBuffer* buffers,
+	                      size_t nbSectors) override;
 	size_t getNbSectorsImpl() const override;
 	bool isWriteProtectedImpl() const override;
 	Sha1Sum getSha1SumImpl(FilePool& filePool) override;
@@ -54,6 +71,12 @@ private:
 	bool isCacheStillValid(time_t& time) override;
 
 	void showProgress(size_t position, size_t maxPosition);
+	void saveTigerTree();
+	void openFile(const Filename& name, File::OpenMode mode);
+	uint8_t* getMapping();
+	void readFromFile(size_t offset, void* data, size_t size);
+	void writeToFile(size_t offset, const void* data, size_t size);
+	template<typename Archive> void serializeOverlay(Archive& ar);
 
 	MSXMotherBoard& motherBoard;
 	std::string name;
@@ -64,6 +87,14 @@ private:
 	Filename filename;
 	size_t filesize;
 
+	// Lazily created memory mapping of 'file'. Writes go to the file and
+	// are also applied to this (private) mapping, so it stays in sync.
+	uint8_t* mapping;
+	bool mappingFailed;
+
+	std::map<size_t, SectorBuffer> overlay;
+	bool overlayEnabled;
+
 	static const unsigned MAX_HD = 26;
 	using HDInUse = std::bitset<MAX_HD>;
 	std::shared_ptr<HDInUse> hdInUse;
@@ -73,7 +104,7 @@ private:
 };
 
 REGISTER_BASE_CLASS(HD, "HD");
-SERIALIZE_CLASS_VERSION(HD, 2);
+SERIALIZE_CLASS_VERSION(HD, 3);
 
 } // namespace openmsx
 
@@ -5,6 +5,8 @@
 #include "CommandException.hh"
 #include "BooleanSetting.hh"
 #include "TclObject.hh"
+#include "MSXException.hh"
+#include "StringOp.hh"
 
 namespace openmsx {
 
@@ -31,11 +33,19 @@ void HDCommand::execute(array_ref<TclObject> tokens, TclObject& result,
 		result.addListElement(hd.getName() + ':');
 		result.addListElement(hd.getImageName().getResolved());
 
+		TclObject options;
 		if (hd.isWriteProtected()) {
-			TclObject options;
 			options.addListElement("readonly");
+		}
+		if (hd.isOverlayEnabled()) {
+			options.addListElement("overlay");
+		}
+		if (options.getListLength(getInterpreter()) != 0) {
 			result.addListElement(options);
 		}
+	} else if ((tokens.size() >= 2) && (tokens[1] == "overlay")) {
+		// to insert an image named 'overlay' use 'insert overlay'
+		overlay(tokens, result);
 	} else if ((tokens.size() == 2) ||
 	           ((tokens.size() == 3) && tokens[1] == "insert")) {
 		if (powerSetting.getBoolean()) {
@@ -68,22 +78,75 @@ void HDCommand::execute(array_ref<TclObject> tokens, TclObject& result,
 	}
 }
 
+void HDCommand::overlay(array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() == 2) {
+		result.addListElement(hd.isOverlayEnabled() ? "on" : "off");
+		result.addListElement(StringOp::toString(
+			hd.getOverlaySectors()) + " modified sectors");
+		return;
+	}
+	if (tokens.size() != 3) {
+		throw SyntaxError();
+	}
+	try {
+		string_ref subCmd = tokens[2].getString();
+		if (subCmd == "on") {
+			hd.setOverlay(true);
+		} else if (subCmd == "off") {
+			hd.setOverlay(false);
+		} else if (subCmd == "commit") {
+			hd.commitOverlay();
+		} else if (subCmd == "discard") {
+			if (powerSetting.getBoolean()) {
+				throw CommandException(
+					"Can only discard the overlay when MSX "
+					"is powered down.");
+			}
+			hd.discardOverlay();
+		} else {
+			throw CommandException(
+				"Invalid overlay subcommand: " + subCmd);
+		}
+	} catch (CommandException&) {
+		throw;
+	} catch (MSXException& e) {
+		throw CommandException(e.getMessage());
+	}
+}
+
 string HDCommand::help(const vector<string>& /*tokens*/) const
 {
-	return hd.getName() + ": change the hard disk image for this hard disk drive\n";
+	return hd.getName() + " [insert] <filename>: change the hard disk image for this hard disk drive\n"
+	       "    (use 'insert' for an image that's named like a subcommand)\n" +
+	       hd.getName() + " overlay [on|off|commit|discard]: copy-on-write overlay,\n"
+	       "    while enabled writes are kept in memory instead of written to the image\n";
 }
 
 void HDCommand::tabCompletion(vector<string>& tokens) const
 {
+	if ((tokens.size() == 3) && (tokens[1] == "overlay")) {
+		static const char* const subCmds[] = {
+			"on", "off", "commit", "discard"
+		};
+		completeString(tokens, subCmds);
+		return;
+	}
 	vector<const char*> extra;
 	if (tokens.size() < 3) {
-		extra = { "insert" };
+		extra = { "insert", "overlay" };
 	}
 	completeFileName(tokens, userFileContext(), extra);
 }
 
 bool HDCommand::needRecord(array_ref<TclObject> tokens) const
 {
+	// Querying the overlay status doesn't change the state. Committing
+	// the overlay only writes to the image file, replaying it would
+	// write to that file again.
+	if ((tokens.size() >= 2) && (tokens[1] == "overlay")) {
+		return (tokens.size() == 3) && (tokens[2] != "commit");
+	}
 	return tokens.size() > 1;
 }
 
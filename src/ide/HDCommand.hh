@@ -26,6 +26,8 @@ public:
 	void tabCompletion(std::vector<std::string>& tokens) const override;
 	bool needRecord(array_ref<TclObject> tokens) const override;
 private:
+	void overlay(array_ref<TclObject> tokens, TclObject& result);
+
 	HD& hd;
 	const BooleanSetting& powerSetting;
 };
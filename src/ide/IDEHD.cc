@@ -75,10 +75,9 @@ void IDEHD::writeBlockComplete(AlignedBuffer& buf, unsigned count)
 	try {
 		assert((count % 512) == 0);
 		unsigned num = count / 512;
-		for (unsigned i = 0; i < num; ++i) {
-			writeSector(transferSectorNumber++,
-			            *aligned_cast<SectorBuffer*>(buf + 512 * i));
-		}
+		writeSectorRange(transferSectorNumber,
+		                 aligned_cast<SectorBuffer*>(buf), num);
+		transferSectorNumber += num;
 	} catch (MSXException&) {
 		abortWriteTransfer(UNC);
 	}
@@ -274,12 +274,10 @@ unsigned SCSIHD::readSectors(unsigned& blocks)
 	unsigned counter = currentLength * SECTOR_SIZE;
 
 	try {
-		for (unsigned i = 0; i < numSectors; ++i) {
-			auto* sbuf = aligned_cast<SectorBuffer*>(buffer);
-			readSector(currentSector, sbuf[i]);
-			++currentSector;
-			--currentLength;
-		}
+		auto* sbuf = aligned_cast<SectorBuffer*>(buffer);
+		readSectorRange(currentSector, sbuf, numSectors);
+		currentSector += numSectors;
+		currentLength -= numSectors;
 		blocks = currentLength;
 		return counter;
 	} catch (MSXException&) {
@@ -308,12 +306,10 @@ unsigned SCSIHD::writeSectors(unsigned& blocks)
 	unsigned numSectors = std::min(currentLength, BUFFER_BLOCK_SIZE);
 
 	try {
-		for (unsigned i = 0; i < numSectors; ++i) {
-			auto* sbuf = aligned_cast<const SectorBuffer*>(buffer);
-			writeSector(currentSector, sbuf[i]);
-			++currentSector;
-			--currentLength;
-		}
+		auto* sbuf = aligned_cast<const SectorBuffer*>(buffer);
+		writeSectorRange(currentSector, sbuf, numSectors);
+		currentSector += numSectors;
+		currentLength -= numSectors;
 
 		unsigned tmp = std::min(currentLength, BUFFER_BLOCK_SIZE);
 		blocks = currentLength - tmp;
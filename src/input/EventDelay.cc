@@ -202,4 +202,10 @@ void EventDelay::flush()
 	removeSyncPoints();
 }
 
+void EventDelay::resync()
+{
+	prevEmu = getCurrentTime();
+	prevReal = Timer::getTime();
+}
+
 } // namespace openmsx
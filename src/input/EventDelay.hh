@@ -35,6 +35,11 @@ public:
 	void sync(EmuTime::param time);
 	void flush();
 
+	/** Restart the timing measurement, needed when the emulated time
+	  * jumped (see ReverseManager::restoreInPlace()).
+	  */
+	void resync();
+
 private:
 	using EventPtr = std::shared_ptr<const Event>;
 
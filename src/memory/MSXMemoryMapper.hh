@@ -22,6 +22,11 @@ public:
 	byte* getWriteCacheLine(word start) const override;
 	byte peekMem(word address, EmuTime::param time) const override;
 
+	/** Returns the segment that is currently selected for the page
+	  * that contains the given address.
+	  */
+	unsigned getSegment(word address) const { return calcAddress(address) >> 14; }
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
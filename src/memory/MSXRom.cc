@@ -20,6 +20,11 @@ byte* MSXRom::getWriteCacheLine(word /*address*/) const
 	return unmappedWrite;
 }
 
+int MSXRom::getRomOffset(word /*address*/) const
+{
+	return -1;
+}
+
 void MSXRom::getExtraDeviceInfo(TclObject& result) const
 {
 	//
@@ -14,6 +14,12 @@ public:
 
 	void getExtraDeviceInfo(TclObject& result) const override;
 
+	/** Returns the offset in the ROM image of the byte that's visible at
+	  * the given address, or -1 if that's unknown or if it's not part of
+	  * the ROM image (e.g. SRAM or unmapped memory).
+	  */
+	virtual int getRomOffset(word address) const;
+
 protected:
 	MSXRom(const DeviceConfig& config, Rom&& rom);
 
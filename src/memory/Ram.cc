@@ -22,6 +22,8 @@ public:
 	              const string& description, Ram& ram);
 	byte read(unsigned address) override;
 	void write(unsigned address, byte value) override;
+	void readBlock(unsigned address, byte* output, unsigned num) override;
+	void writeBlock(unsigned address, const byte* input, unsigned num) override;
 private:
 	Ram& ram;
 };
@@ -111,6 +113,16 @@ void RamDebuggable::write(unsigned address, byte value)
 	ram[address] = value;
 }
 
+void RamDebuggable::readBlock(unsigned address, byte* output, unsigned num)
+{
+	memcpy(output, &ram[address], num);
+}
+
+void RamDebuggable::writeBlock(unsigned address, const byte* input, unsigned num)
+{
+	memcpy(&ram[address], input, num);
+}
+
 
 template<typename Archive>
 void Ram::serialize(Archive& ar, unsigned /*version*/)
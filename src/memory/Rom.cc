@@ -20,6 +20,7 @@
 #include "sha1.hh"
 #include "memory.hh"
 #include <limits>
+#include <map>
 #include <cstring>
 
 using std::string;
@@ -36,12 +37,41 @@ public:
 	const std::string& getDescription() const override;
 	byte read(unsigned address) override;
 	void write(unsigned address, byte value) override;
+	void readBlock(unsigned address, byte* output, unsigned num) override;
 	void moved(Rom& r);
 private:
 	Debugger& debugger;
 	Rom* rom;
 };
 
+// Content of all currently used (unpatched) ROM files, indexed by sha1sum.
+// Machines that use the same ROM (e.g. machines created via clone_machine)
+// share this content, instead of each locating, opening and (in case of
+// compressed files) decompressing the file again.
+namespace {
+struct SharedRomFile {
+	std::weak_ptr<File> file;
+	const byte* data;
+	size_t size;
+};
+}
+static std::map<Sha1Sum, SharedRomFile> sharedRomFiles;
+
+static std::shared_ptr<File> getSharedRomFile(
+	const Sha1Sum& sha1, const byte*& data, size_t& size)
+{
+	auto it = sharedRomFiles.find(sha1);
+	if (it == end(sharedRomFiles)) return nullptr;
+	auto result = it->second.file.lock();
+	if (result) {
+		data = it->second.data;
+		size = it->second.size;
+	} else {
+		sharedRomFiles.erase(it); // no longer in use
+	}
+	return result;
+}
+
 
 Rom::Rom(string name_, string description_,
          const DeviceConfig& config, const string& id /*= {}*/)
@@ -113,10 +143,22 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 	} else if (resolvedFilenameElem || resolvedSha1Elem ||
 	           !sums.empty() || !filenames.empty()) {
 		auto& filepool = motherBoard.getReactor().getFilePool();
-		// first try already resolved filename ..
-		if (resolvedFilenameElem) {
+		// The content of a patched ROM is modified in-place, so it
+		// can't be shared.
+		bool shareable = !config.findChild("patches");
+		size_t size2 = 0;
+		// first check whether this ROM is already in use (only when
+		// we know the exact content, e.g. for cloned machines) ..
+		if (shareable && resolvedSha1Elem) {
+			Sha1Sum sha1(resolvedSha1Elem->getData());
+			file = getSharedRomFile(sha1, rom, size2);
+			if (file) originalSha1 = sha1;
+		}
+		File newFile;
+		// .. then try already resolved filename ..
+		if (!file && resolvedFilenameElem) {
 			try {
-				file = File(resolvedFilenameElem->getData());
+				newFile = File(resolvedFilenameElem->getData());
 			} catch (FileException&) {
 				// ignore
 			}
@@ -124,20 +166,20 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 		// .. then try the actual sha1sum ..
 		auto fileType = context.isUserContext()
 			? FilePool::ROM : FilePool::SYSTEM_ROM;
-		if (!file.is_open() && resolvedSha1Elem) {
+		if (!file && !newFile.is_open() && resolvedSha1Elem) {
 			Sha1Sum sha1(resolvedSha1Elem->getData());
-			file = filepool.getFile(fileType, sha1);
-			if (file.is_open()) {
+			newFile = filepool.getFile(fileType, sha1);
+			if (newFile.is_open()) {
 				// avoid recalculating same sha1 later
 				originalSha1 = sha1;
 			}
 		}
 		// .. and then try filename as originally given by user ..
-		if (!file.is_open()) {
+		if (!file && !newFile.is_open()) {
 			for (auto& f : filenames) {
 				try {
 					Filename filename(f->getData(), context);
-					file = File(filename);
+					newFile = File(filename);
 				} catch (FileException&) {
 					// ignore
 				}
@@ -145,11 +187,11 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 		}
 		// .. then try all alternative sha1sums ..
 		// (this might retry the actual sha1sum)
-		if (!file.is_open()) {
+		if (!file && !newFile.is_open()) {
 			for (auto& s : sums) {
 				Sha1Sum sha1(s->getData());
-				file = filepool.getFile(fileType, sha1);
-				if (file.is_open()) {
+				newFile = filepool.getFile(fileType, sha1);
+				if (newFile.is_open()) {
 					// avoid recalculating same sha1 later
 					originalSha1 = sha1;
 					break;
@@ -157,7 +199,7 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 			}
 		}
 		// .. still no file, then error
-		if (!file.is_open()) {
+		if (!file && !newFile.is_open()) {
 			StringOp::Builder error;
 			error << "Couldn't find ROM file for \""
 			      << name << '"';
@@ -181,24 +223,30 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 				"inside a <rom> section are no longer "
 				"supported.");
 		}
-		try {
-			size_t size2;
-			rom = file.mmap(size2);
-			if (size2 > std::numeric_limits<decltype(size)>::max()) {
-				throw MSXException("Rom file too big: " +
-				                   file.getURL());
+		if (!file) {
+			file = std::make_shared<File>(std::move(newFile));
+			try {
+				rom = file->mmap(size2);
+			} catch (FileException&) {
+				throw MSXException("Error reading ROM image: " +
+						   file->getURL());
 			}
-			size = unsigned(size2);
-		} catch (FileException&) {
-			throw MSXException("Error reading ROM image: " +
-					   file.getURL());
-		}
 
-		// For file-based roms, calc sha1 via File::getSha1Sum(). It can
-		// possibly use the FilePool cache to avoid the calculation.
-		if (originalSha1.empty()) {
-			originalSha1 = filepool.getSha1Sum(file);
+			// For file-based roms, calc sha1 via File::getSha1Sum(). It can
+			// possibly use the FilePool cache to avoid the calculation.
+			if (originalSha1.empty()) {
+				originalSha1 = filepool.getSha1Sum(*file);
+			}
+			if (shareable) {
+				sharedRomFiles[originalSha1] =
+					SharedRomFile{file, rom, size2};
+			}
 		}
+		if (size2 > std::numeric_limits<decltype(size)>::max()) {
+			throw MSXException("Rom file too big: " +
+			                   file->getURL());
+		}
+		size = unsigned(size2);
 
 		// verify SHA1
 		if (!checkSHA1(config)) {
@@ -206,7 +254,7 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 				StringOp::Builder() <<
 				"SHA1 sum for '" << name <<
 				"' does not match with sum of '" <<
-				file.getURL() << "'.");
+				file->getURL() << "'.");
 		}
 
 		// We loaded an extrenal file, so check.
@@ -270,7 +318,7 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 			name = title.str();
 		} else {
 			// unknown ROM, use file name
-			name = file.getOriginalName();
+			name = file->getOriginalName();
 		}
 	}
 
@@ -294,7 +342,7 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 		const auto& actualSha1Elem = mutableConfig.getCreateChild(
 			"resolvedSha1", patchedSha1Str);
 		if (actualSha1Elem.getData() != patchedSha1Str) {
-			string tmp = file.is_open() ? file.getURL() : name;
+			string tmp = file ? file->getURL() : name;
 			// can only happen in case of loadstate
 			motherBoard.getMSXCliComm().printWarning(
 				"The content of the rom " + tmp + " has "
@@ -352,7 +400,7 @@ Rom::~Rom() = default;
 
 string Rom::getFilename() const
 {
-	return file.is_open() ? file.getURL() : string{};
+	return file ? file->getURL() : string{};
 }
 
 const Sha1Sum& Rom::getOriginalSHA1() const
@@ -410,6 +458,12 @@ void RomDebuggable::write(unsigned /*address*/, byte /*value*/)
 	// ignore
 }
 
+void RomDebuggable::readBlock(unsigned address, byte* output, unsigned num)
+{
+	assert((address + num) <= getSize());
+	memcpy(output, &(*rom)[address], num);
+}
+
 void RomDebuggable::moved(Rom& r)
 {
 	rom = &r;
@@ -48,7 +48,8 @@ private:
 	const byte* rom;
 	MemBuffer<byte> extendedRom;
 
-	File file; // can be a closed file
+	// Shared between all Rom objects that use the same (unpatched) file.
+	std::shared_ptr<File> file; // can be nullptr
 
 	mutable Sha1Sum originalSha1;
 	std::string name;
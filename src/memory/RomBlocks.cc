@@ -75,6 +75,16 @@ const byte* RomBlocks<BANK_SIZE>::getReadCacheLine(word address) const
 	return &bankPtr[address / BANK_SIZE][address & BANK_MASK];
 }
 
+template <unsigned BANK_SIZE>
+int RomBlocks<BANK_SIZE>::getRomOffset(word address) const
+{
+	const byte* p = &bankPtr[address / BANK_SIZE][address & BANK_MASK];
+	if ((&rom[0] <= p) && (p <= &rom[rom.getSize() - 1])) {
+		return int(p - &rom[0]);
+	}
+	return -1;
+}
+
 template <unsigned BANK_SIZE>
 void RomBlocks<BANK_SIZE>::setBank(byte region, const byte* adr, int block)
 {
@@ -6,6 +6,7 @@
 #include "FileOperations.hh"
 #include "GlobalCommandController.hh"
 #include "CliComm.hh"
+#include "Timer.hh"
 #include "StringOp.hh"
 #include "String32.hh"
 #include "hash_map.hh"
@@ -14,7 +15,12 @@
 #include "unreachable.hh"
 #include "stl.hh"
 #include "xxhash.hh"
+#include "Version.hh"
+#include "endian.hh"
+#include <fstream>
 #include <stdexcept>
+#include <type_traits>
+#include <cstdio>
 
 using std::string;
 using std::vector;
@@ -563,13 +569,210 @@ static void parseDB(CliComm& cliComm, char* buf, char* bufStart,
 	}
 }
 
+// Compiled form of the database, stored in the user data directory. It is
+// regenerated whenever (one of) the softwaredb.xml files changes. Layout:
+//   8 bytes    magic
+//   4 bytes    length of build key, followed by the build key itself
+//   4 bytes    number of source files, and for each source file:
+//                4 bytes length of path, path, 8 bytes size, 8 bytes time
+//   4 bytes    number of entries
+//   4 bytes    size of the string pool
+//   padding up to a multiple of 8 bytes
+//   entries    raw (sorted) RomDatabase::RomDB::value_type objects
+//   string pool
+// All integers are little endian. The entries are stored in the in-memory
+// format, so that the mapped file can directly be used for lookups. That's
+// only possible when String32 is an index (not a pointer), so on other
+// hosts there's no cache.
+static const char CACHE_MAGIC[8] = { 'o','M','S','X','s','d','b','1' };
+static const char* const CACHE_FILE = "/softwaredb.cache";
+static const bool CACHE_SUPPORTED = std::is_same<String32, uint32_t>::value;
+
+static string getBuildKey()
+{
+	// RomType values and the layout of RomInfo may change between versions.
+	return Version::full() + ' ' + Version::BUILD_FLAVOUR + ' ' +
+	       StringOp::toString(sizeof(RomDatabase::RomDB::value_type));
+}
+
+static void appendString(string& out, string_ref str)
+{
+	char len[4];
+	Endian::write_UA_L32(len, unsigned(str.size()));
+	out.append(len, 4);
+	out.append(str.data(), str.size());
+}
+
+template<typename T> static void appendInt(string& out, T value)
+{
+	char buf[8];
+	Endian::write_UA_L64(buf, uint64_t(value));
+	out.append(buf, sizeof(T) == 8 ? 8 : 4);
+}
+
+// Reads from a memory block, throws on reading beyond the end.
+class CacheReader
+{
+public:
+	CacheReader(const char* data_, size_t size_)
+		: data(data_), size(size_), pos(0) {}
+
+	const char* get(size_t num) {
+		if ((size - pos) < num) throw MSXException("Truncated cache");
+		auto* result = data + pos;
+		pos += num;
+		return result;
+	}
+	uint32_t get32() { return Endian::read_UA_L32(get(4)); }
+	uint64_t get64() { return Endian::read_UA_L64(get(8)); }
+	string_ref getString() {
+		auto len = get32();
+		return string_ref(get(len), len);
+	}
+	void align(size_t alignment) {
+		get((alignment - (pos % alignment)) % alignment);
+	}
+
+private:
+	const char* data;
+	size_t size;
+	size_t pos;
+};
+
+bool RomDatabase::loadCache(const vector<Source>& sources)
+{
+	if (!CACHE_SUPPORTED) return false;
+	try {
+		File file(FileOperations::getUserDataDir() + CACHE_FILE);
+		size_t size;
+		auto* data = reinterpret_cast<const char*>(file.mmap(size));
+		CacheReader reader(data, size);
+		if (memcmp(reader.get(8), CACHE_MAGIC, 8) != 0) return false;
+		if (reader.getString() != getBuildKey()) return false;
+		if (reader.get32() != sources.size()) return false;
+		for (auto& src : sources) {
+			if ((reader.getString() != src.path) ||
+			    (reader.get64() != src.size) ||
+			    (int64_t(reader.get64()) != src.time)) {
+				return false;
+			}
+		}
+		auto numEntries = reader.get32();
+		auto poolSize   = reader.get32();
+		reader.align(8);
+		auto* entries = reinterpret_cast<const Entry*>(
+			reader.get(numEntries * sizeof(Entry)));
+		auto* pool = reader.get(poolSize);
+		if ((poolSize == 0) || (pool[poolSize - 1] != 0)) return false;
+
+		cacheFile = std::move(file); // keep mapping alive
+		dbBegin = entries;
+		dbEnd = entries + numEntries;
+		bufStart = pool;
+		return true;
+	} catch (MSXException&) {
+		// no cache yet, or it's corrupt
+		return false;
+	}
+}
+
+void RomDatabase::writeCache(const vector<Source>& sources) const
+{
+	if (!CACHE_SUPPORTED) return;
+
+	// Copy all strings to a compact pool. Offset 0 is the empty string.
+	string pool(1, '\0');
+	hash_map<string_ref, String32, XXHasher> poolIndex;
+	auto add = [&](string_ref str) {
+		String32 result;
+		if (str.empty()) {
+			toString32(pool.data(), pool.data(), result);
+			return result;
+		}
+		auto it = poolIndex.find(str);
+		if (it != end(poolIndex)) return it->second;
+		toString32(pool.data(), pool.data() + pool.size(), result);
+		pool.append(str.data(), str.size());
+		pool += '\0';
+		poolIndex[str] = result; // refers to the (stable) xml buffer
+		return result;
+	};
+	const char* buf = buffer.data();
+	vector<Entry> entries;
+	entries.reserve(db.size());
+	for (auto& e : db) {
+		const auto& info = e.second;
+		entries.emplace_back(e.first, RomInfo(
+			add(info.getTitle(buf)), add(info.getYear(buf)),
+			add(info.getCompany(buf)), add(info.getCountry(buf)),
+			info.getOriginal(), add(info.getOrigType(buf)),
+			add(info.getRemark(buf)), info.getRomType(),
+			info.getGenMSXid()));
+	}
+
+	string header(CACHE_MAGIC, 8);
+	appendString(header, getBuildKey());
+	appendInt(header, uint32_t(sources.size()));
+	for (auto& src : sources) {
+		appendString(header, src.path);
+		appendInt(header, src.size);
+		appendInt(header, src.time);
+	}
+	appendInt(header, uint32_t(entries.size()));
+	appendInt(header, uint32_t(pool.size()));
+	header.resize((header.size() + 7) & ~7, '\0');
+
+	// Write to a temporary file first, so that concurrently starting
+	// instances never see a half written cache.
+	string cacheName = FileOperations::getUserDataDir() + CACHE_FILE;
+	string tmpName = cacheName + ".tmp" + StringOp::toString(Timer::getTime());
+	{
+		std::ofstream out;
+		FileOperations::openofstream(out, tmpName,
+		                             std::ios::out | std::ios::binary);
+		if (!out.is_open()) return;
+		out.write(header.data(), header.size());
+		out.write(reinterpret_cast<const char*>(entries.data()),
+		          entries.size() * sizeof(Entry));
+		out.write(pool.data(), pool.size());
+		if (!out.good()) {
+			out.close();
+			FileOperations::unlink(tmpName);
+			return;
+		}
+	}
+	if (std::rename(tmpName.c_str(), cacheName.c_str()) != 0) {
+		// e.g. on windows when the destination exists
+		FileOperations::unlink(cacheName);
+		if (std::rename(tmpName.c_str(), cacheName.c_str()) != 0) {
+			FileOperations::unlink(tmpName);
+		}
+	}
+}
+
 RomDatabase::RomDatabase(GlobalCommandController& commandController, CliComm& cliComm)
-	: softwareInfoTopic(commandController.getOpenMSXInfoCommand())
+	: dbBegin(nullptr)
+	, dbEnd(nullptr)
+	, bufStart(nullptr)
+	, softwareInfoTopic(commandController.getOpenMSXInfoCommand())
 {
-	db.reserve(3500);
-	UnknownTypes unknownTypes;
 	// first user- then system-directory
 	vector<string> paths = systemFileContext().getPaths();
+
+	vector<Source> sources;
+	for (auto& p : paths) {
+		string path = FileOperations::join(p, "softwaredb.xml");
+		FileOperations::Stat st;
+		if (FileOperations::getStat(path, st) &&
+		    FileOperations::isRegularFile(st)) {
+			sources.push_back(Source{path, uint64_t(st.st_size),
+				int64_t(FileOperations::getModificationDate(st))});
+		}
+	}
+	if (!sources.empty() && loadCache(sources)) return;
+
+	db.reserve(3500);
+	UnknownTypes unknownTypes;
 	vector<File> files;
 	size_t bufferSize = 0;
 	for (auto& p : paths) {
@@ -602,6 +805,9 @@ RomDatabase::RomDatabase(GlobalCommandController& commandController, CliComm& cl
 		}
 	}
 	if (bufferSize) buffer[0] = 0;
+	dbBegin = db.data();
+	dbEnd = db.data() + db.size();
+	bufStart = buffer.data();
 	if (db.empty()) {
 		cliComm.printWarning(
 			"Couldn't load software database.\n"
@@ -615,13 +821,16 @@ RomDatabase::RomDatabase(GlobalCommandController& commandController, CliComm& cl
 		}
 		cliComm.printWarning(output);
 	}
+	if (!db.empty() && !sources.empty()) {
+		writeCache(sources);
+	}
 }
 
 const RomInfo* RomDatabase::fetchRomInfo(const Sha1Sum& sha1sum) const
 {
-	auto it = lower_bound(begin(db), end(db), sha1sum,
-	                      LessTupleElement<0>());
-	return ((it != end(db)) && (it->first == sha1sum))
+	auto it = std::lower_bound(dbBegin, dbEnd, sha1sum,
+	                           LessTupleElement<0>());
+	return ((it != dbEnd) && (it->first == sha1sum))
 		? &it->second : nullptr;
 }
 
@@ -650,7 +859,7 @@ void RomDatabase::SoftwareInfoTopic::execute(
 			"Software with sha1sum " + sha1sum.toString() + " not found");
 	}
 
-	const char* bufStart = romDatabase.buffer.data();
+	const char* bufStart = romDatabase.getBufferStart();
 	result.addListElement("title");
 	result.addListElement(romInfo->getTitle(bufStart));
 	result.addListElement("year");
@@ -2,9 +2,11 @@
 #define ROMDATABASE_HH
 
 #include "RomInfo.hh"
+#include "File.hh"
 #include "MemBuffer.hh"
 #include "InfoTopic.hh"
 #include "sha1.hh"
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -25,11 +27,28 @@ public:
 	 */
 	const RomInfo* fetchRomInfo(const Sha1Sum& sha1sum) const;
 
-	const char* getBufferStart() const { return buffer.data(); }
+	const char* getBufferStart() const { return bufStart; }
 
 private:
+	struct Source {
+		std::string path;
+		uint64_t size;
+		int64_t time;
+	};
+	using Entry = RomDB::value_type;
+
+	bool loadCache(const std::vector<Source>& sources);
+	void writeCache(const std::vector<Source>& sources) const;
+
+	// Either points to 'db' and 'buffer' (after parsing the XML files) or
+	// into the memory mapped 'cacheFile'.
+	const Entry* dbBegin;
+	const Entry* dbEnd;
+	const char* bufStart;
+
 	RomDB db;
 	MemBuffer<char> buffer;
+	File cacheFile;
 
 	struct SoftwareInfoTopic final : InfoTopic {
 		explicit SoftwareInfoTopic(InfoCommand& openMSXInfoCommand);
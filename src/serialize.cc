@@ -245,7 +245,14 @@ void MemInputArchive::serialize_blob(const char*, void* data, size_t len, bool /
 		// is possible that certain blobs are stored in the savestate,
 		// but skipped while loading. That's why we do need the index.
 		unsigned deltaBlockIdx; load(deltaBlockIdx);
-		deltaBlocks[deltaBlockIdx]->apply(static_cast<uint8_t*>(data), len);
+		auto& block = *deltaBlocks[deltaBlockIdx];
+		if (inPlaceRestore) {
+			// 'data' still holds the current content (e.g. of a
+			// RAM device), only overwrite what changed.
+			block.applyChanged(static_cast<uint8_t*>(data), len);
+		} else {
+			block.apply(static_cast<uint8_t*>(data), len);
+		}
 	} else {
 		memcpy(data, buffer.getCurrentPos(), len);
 		buffer.skip(len);
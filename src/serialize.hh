@@ -198,6 +198,12 @@ public:
 	/** Is this a reverse-snapshot? */
 	bool isReverseSnapshot() const { return false; }
 
+	/** Does this (input) archive load the state into an already existing
+	 * object tree (as opposed to a freshly constructed one)? See
+	 * ReverseManager::goTo().
+	 */
+	bool isInPlaceRestore() const { return false; }
+
 	/** Does this archive store enums as strings.
 	 * See also struct serialize_as_enum.
 	 */
@@ -664,13 +670,16 @@ class MemInputArchive final : public InputArchiveBase<MemInputArchive>
 {
 public:
 	MemInputArchive(const byte* data, size_t size,
-	                const std::vector<std::shared_ptr<DeltaBlock>>& deltaBlocks_)
+	                const std::vector<std::shared_ptr<DeltaBlock>>& deltaBlocks_,
+	                bool inPlaceRestore_ = false)
 		: buffer(data, size)
 		, deltaBlocks(deltaBlocks_)
+		, inPlaceRestore(inPlaceRestore_)
 	{
 	}
 
 	bool needVersion() const { return false; }
+	bool isInPlaceRestore() const { return inPlaceRestore; }
 	inline bool versionAtLeast(unsigned /*actual*/, unsigned /*required*/) const
 	{
 		return true;
@@ -712,6 +721,7 @@ private:
 
 	InputBuffer buffer;
 	const std::vector<std::shared_ptr<DeltaBlock>>& deltaBlocks;
+	const bool inPlaceRestore;
 };
 
 ////
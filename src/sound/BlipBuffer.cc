@@ -3,6 +3,12 @@
 #include <algorithm>
 #include <cstring>
 #include <cassert>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
 
 namespace openmsx {
 
@@ -19,6 +25,38 @@ BlipBuffer::BlipBuffer()
 	memset(buffer, 0, sizeof(buffer));
 }
 
+#ifdef __SSE2__
+// Multiply four 32-bit integers, keep the lower 32 bits of each result.
+static inline __m128i mullo32(__m128i a, __m128i b)
+{
+#ifdef __SSE4_1__
+	return _mm_mullo_epi32(a, b);
+#else
+	// SSE2 only has a 32x32->64 bit multiply on the even elements. The
+	// lower 32 bits of the product are the same for signed and unsigned
+	// inputs, so that's good enough. 'b' is a broadcast value here, so
+	// it doesn't need to be shifted for the odd elements.
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd  = _mm_mul_epu32(_mm_srli_si128(a, 4), b);
+	return _mm_unpacklo_epi32(
+		_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+		_mm_shuffle_epi32(odd,  _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+
+static inline void stampImpulse(int* __restrict out, const int* __restrict imp,
+                                __m128i delta)
+{
+	static_assert(BLIP_IMPULSE_WIDTH % 4 == 0, "");
+	for (int i = 0; i < BLIP_IMPULSE_WIDTH; i += 4) {
+		__m128i* p = reinterpret_cast<__m128i*>(out + i);
+		__m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(imp + i));
+		_mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p),
+		                                  mullo32(k, delta)));
+	}
+}
+#endif
+
 void BlipBuffer::addDelta(TimeIndex time, int delta)
 {
 	unsigned tmp = time.toInt() + BLIP_IMPULSE_WIDTH;
@@ -28,9 +66,13 @@ void BlipBuffer::addDelta(TimeIndex time, int delta)
 	unsigned phase = time.fractAsInt();
 	unsigned ofst = time.toInt() + offset;
 	if (likely((ofst + BLIP_IMPULSE_WIDTH) <= BUFFER_SIZE)) {
+#ifdef __SSE2__
+		stampImpulse(&buffer[ofst], impulses[phase], _mm_set1_epi32(delta));
+#else
 		for (int i = 0; i < BLIP_IMPULSE_WIDTH; ++i) {
 			buffer[ofst + i] += impulses[phase][i] * delta;
 		}
+#endif
 	} else {
 		for (int i = 0; i < BLIP_IMPULSE_WIDTH; ++i) {
 			buffer[(ofst + i) & BUFFER_MASK] += impulses[phase][i] * delta;
@@ -46,7 +88,11 @@ void BlipBuffer::readSamplesHelper(int* __restrict out, unsigned samples) __rest
 {
 	assert((offset + samples) <= BUFFER_SIZE);
 	int acc = accum;
-	unsigned ofst = offset;
+	const int* in = &buffer[offset];
+	// Note: this leaky integrator can't be turned into a (vectorizable)
+	// prefix sum without changing the rounding of 'acc >> BASS_SHIFT',
+	// so it stays a serial loop. Keep the loop body minimal though: the
+	// consumed part of the buffer is cleared in one go afterwards.
 	for (unsigned i = 0; i < samples; ++i) {
 		out[i * PITCH] = acc >> SAMPLE_SHIFT;
 		// Note: the following has different rounding behaviour
@@ -54,12 +100,11 @@ void BlipBuffer::readSamplesHelper(int* __restrict out, unsigned samples) __rest
 		//  code used 'acc / (1<< BASS_SHIFT)' to avoid this,
 		//  but it generates less efficient code.
 		acc -= (acc >> BASS_SHIFT);
-		acc += buffer[ofst];
-		buffer[ofst] = 0;
-		++ofst;
+		acc += in[i];
 	}
+	memset(&buffer[offset], 0, samples * sizeof(int));
 	accum = acc;
-	offset = ofst & BUFFER_MASK;
+	offset = (offset + samples) & BUFFER_MASK;
 }
 
 template <unsigned PITCH>
@@ -0,0 +1,171 @@
+// Benchmark and regression test for BlipBuffer.
+//
+// Runs a couple of typical workloads through BlipBuffer and through a plain
+// scalar reference implementation, verifies both produce identical output
+// and reports the speed of the real implementation.
+//
+// Build (manually) with something like:
+//   g++ -O3 -march=native -Isrc/sound -Isrc/utils -Iderived/<flavour>/config
+//       src/sound/BlipBufferTest.cc src/sound/BlipBuffer.cc
+//       src/thread/Timer.cc -o blipbuffer-test
+
+#include "BlipBuffer.hh"
+#include "Timer.hh"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+using namespace openmsx;
+
+namespace openmsx {
+#include "BlipTable.ii"
+}
+
+// Straightforward implementation of the original algorithm.
+class RefBlipBuffer
+{
+public:
+	RefBlipBuffer() { memset(buffer, 0, sizeof(buffer)); }
+
+	void addDelta(BlipBuffer::TimeIndex time, int delta) {
+		unsigned phase = time.fractAsInt();
+		unsigned ofst = time.toInt() + offset;
+		for (int i = 0; i < BLIP_IMPULSE_WIDTH; ++i) {
+			buffer[(ofst + i) & MASK] += impulses[phase][i] * delta;
+		}
+	}
+	void readSamples(int* out, unsigned samples) {
+		for (unsigned i = 0; i < samples; ++i) {
+			out[i] = accum >> (BLIP_SAMPLE_BITS - 16);
+			accum -= accum >> 9;
+			accum += buffer[offset];
+			buffer[offset] = 0;
+			offset = (offset + 1) & MASK;
+		}
+	}
+
+private:
+	static const unsigned MASK = (1 << 14) - 1;
+	int buffer[1 << 14];
+	unsigned offset = 0;
+	int accum = 0;
+};
+
+struct Event
+{
+	BlipBuffer::TimeIndex time;
+	int delta;
+};
+struct Block
+{
+	vector<Event> events;
+	unsigned samples;
+};
+using Workload = vector<Block>;
+
+static uint32_t rnd()
+{
+	static uint32_t x = 2463534242u;
+	x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+	return x;
+}
+
+// Generates deltas for a signal that changes 'inRate' times per second,
+// rendered at 'outRate' samples per second, in blocks of 'blockSize'.
+template<typename NextValue>
+static Workload makeWorkload(double inRate, double outRate, unsigned blockSize,
+                             unsigned blocks, NextValue next)
+{
+	Workload result;
+	double step = outRate / inRate;
+	double pos = 0.0;
+	int last = 0;
+	for (unsigned b = 0; b < blocks; ++b) {
+		Block block;
+		block.samples = blockSize;
+		for (/**/; pos < blockSize; pos += step) {
+			int value = next();
+			if (value != last) {
+				block.events.push_back(Event{
+					BlipBuffer::TimeIndex(pos), value - last});
+				last = value;
+			}
+		}
+		pos -= blockSize;
+		result.push_back(move(block));
+	}
+	return result;
+}
+
+static bool run(const char* name, const Workload& workload, unsigned repeat)
+{
+	vector<int> out, ref;
+	unsigned events = 0;
+	{
+		// reference run, only once
+		RefBlipBuffer refBlip;
+		vector<int> tmp;
+		for (auto& block : workload) {
+			for (auto& e : block.events) refBlip.addDelta(e.time, e.delta);
+			tmp.resize(block.samples);
+			refBlip.readSamples(tmp.data(), block.samples);
+			ref.insert(ref.end(), tmp.begin(), tmp.end());
+			events += unsigned(block.events.size());
+		}
+	}
+
+	uint64_t best = uint64_t(-1);
+	for (unsigned r = 0; r < repeat; ++r) {
+		BlipBuffer blip;
+		out.clear();
+		vector<int> tmp;
+		uint64_t start = Timer::getTime();
+		for (auto& block : workload) {
+			for (auto& e : block.events) blip.addDelta(e.time, e.delta);
+			tmp.resize(block.samples);
+			if (!blip.readSamples<1>(tmp.data(), block.samples)) {
+				fill(tmp.begin(), tmp.end(), 0);
+			}
+			out.insert(out.end(), tmp.begin(), tmp.end());
+		}
+		best = min(best, Timer::getTime() - start);
+	}
+
+	bool ok = out == ref;
+	double sec = best / 1000000.0;
+	cout << name << ": " << events << " deltas, " << out.size()
+	     << " samples, " << sec << "s, "
+	     << (out.size() / sec / 1000000.0) << " Msamples/s, "
+	     << (events / sec / 1000000.0) << " Mdeltas/s"
+	     << (ok ? "" : "  MISMATCH!") << endl;
+	return ok;
+}
+
+int main()
+{
+	const unsigned BLOCK = 1024;
+	const unsigned BLOCKS = 4000; // about 90 seconds of audio at 44.1kHz
+	bool ok = true;
+
+	// turboR PCM: 8-bit samples at 15.7kHz
+	ok &= run("pcm 15.7kHz",
+	          makeWorkload(15700.0, 44100.0, BLOCK, BLOCKS,
+	                       [] { return int(rnd() & 0xFF) - 128; }),
+	          5);
+	// sample playback through the PSG volume register: ~100kHz updates
+	ok &= run("psg sample",
+	          makeWorkload(100000.0, 44100.0, BLOCK, BLOCKS,
+	                       [] { return int(rnd() & 0xF) * 256; }),
+	          5);
+	// high-pitched square wave as seen by ResampleBlip
+	int sq = 0;
+	ok &= run("square 55kHz",
+	          makeWorkload(2 * 55000.0, 44100.0, BLOCK, BLOCKS,
+	                       [&] { sq = 4096 - sq; return sq; }),
+	          5);
+
+	return ok ? 0 : 1;
+}
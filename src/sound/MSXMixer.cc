@@ -13,6 +13,10 @@
 #include "AviRecorder.hh"
 #include "Filename.hh"
 #include "CliComm.hh"
+#include "Timer.hh"
+#include "MemBuffer.hh"
+#include "endian.hh"
+#include "build-info.hh"
 #include "Math.hh"
 #include "StringOp.hh"
 #include "memory.hh"
@@ -30,6 +34,9 @@
 #ifdef __SSE2__
 #include "emmintrin.h"
 #endif
+#if ASM_X86 && defined(__GNUC__)
+#include <x86intrin.h>
+#endif
 
 using std::string;
 using std::vector;
@@ -47,6 +54,7 @@ MSXMixer::MSXMixer(Mixer& mixer_, MSXMotherBoard& motherBoard_,
 	, throttleManager(globalSettings.getThrottleManager())
 	, prevTime(getCurrentTime(), 44100)
 	, soundDeviceInfo(commandController.getMachineInfoCommand())
+	, soundchipGenerateCmd(commandController)
 	, recorder(nullptr)
 	, synchronousCounter(0)
 {
@@ -135,6 +143,11 @@ void MSXMixer::unregisterSound(SoundDevice& device)
 	commandController.getCliComm().update(CliComm::SOUNDDEVICE, device.getName(), "remove");
 }
 
+CliComm& MSXMixer::getCliComm()
+{
+	return commandController.getCliComm();
+}
+
 void MSXMixer::setSynchronousMode(bool synchronous)
 {
 	// TODO ATM synchronous is not used anymore
@@ -646,6 +659,12 @@ void MSXMixer::setMixerParams(unsigned newFragmentSize, unsigned newSampleRate)
 	}
 }
 
+void MSXMixer::resetStreams()
+{
+	// the resamplers are created relative to 'prevTime'
+	setMixerParams(fragmentSize, hostSampleRate);
+}
+
 void MSXMixer::setRecorder(AviRecorder* newRecorder)
 {
 	if ((recorder != nullptr) != (newRecorder != nullptr)) {
@@ -840,4 +859,133 @@ void MSXMixer::SoundDeviceInfoTopic::tabCompletion(vector<string>& tokens) const
 	}
 }
 
+
+// SoundchipGenerateCmd
+
+static inline uint64_t readCycleCounter()
+{
+#if ASM_X86 && defined(__GNUC__)
+	return __rdtsc();
+#else
+	return 0; // not supported, 'cycles_per_sample' won't be reported
+#endif
+}
+
+MSXMixer::SoundchipGenerateCmd::SoundchipGenerateCmd(
+		CommandController& commandController_)
+	: Command(commandController_, "soundchip_generate")
+{
+}
+
+MSXMixer::SoundchipGenerateCmd::Stats& MSXMixer::SoundchipGenerateCmd::getStats(
+	string_ref name)
+{
+	auto it = find_if(begin(stats), end(stats),
+		[&](const Stats& s) { return s.name == name; });
+	if (it != end(stats)) return *it;
+	stats.emplace_back();
+	stats.back().name = name.str();
+	return stats.back();
+}
+
+void MSXMixer::SoundchipGenerateCmd::generate(
+	SoundDevice& device, Stats& st, unsigned num)
+{
+	// Generate in chunks, so that the buffer size remains bounded. Only
+	// the actual generation is timed, not the hashing.
+	static const unsigned CHUNK = 8192;
+	unsigned stereo = device.isStereo() ? 2 : 1;
+	MemBuffer<int, SSE2_ALIGNMENT> buf(stereo * CHUNK + 4);
+	MemBuffer<uint8_t> bytes(4 * stereo * CHUNK);
+	while (num) {
+		unsigned n = std::min(num, CHUNK);
+		uint64_t t0 = Timer::getTime();
+		uint64_t c0 = readCycleCounter();
+		bool nonSilent = device.generateDirect(buf.data(), n);
+		st.cycles += readCycleCounter() - c0;
+		st.time += Timer::getTime() - t0;
+
+		// Hash the amplified output in a host independent format, so
+		// that hashes can be compared across platforms and cores.
+		int factor = device.getAmplificationFactor();
+		for (unsigned i = 0; i < stereo * n; ++i) {
+			int s = nonSilent ? buf[i] * factor : 0;
+			Endian::writeL32(&bytes[4 * i], uint32_t(s));
+		}
+		st.sha1.update(bytes.data(), 4 * stereo * n);
+		st.samples += n;
+		num -= n;
+	}
+}
+
+void MSXMixer::SoundchipGenerateCmd::execute(
+	array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() != 3) {
+		throw SyntaxError();
+	}
+	auto& msxMixer = OUTER(MSXMixer, soundchipGenerateCmd);
+	string_ref name = tokens[1].getString();
+	SoundDevice* device = msxMixer.findDevice(name);
+	if (!device) {
+		throw CommandException("Unknown sound device: " + name);
+	}
+	auto& st = getStats(name);
+
+	string_ref subCmd = tokens[2].getString();
+	if (subCmd == "reset") {
+		st = Stats();
+		st.name = name.str();
+	} else if (subCmd == "rate") {
+		result.setInt(device->getInputRate());
+	} else if (subCmd == "stats") {
+		double seconds = st.time / 1000000.0;
+		result.addListElement("samples");
+		result.addListElement(double(st.samples));
+		result.addListElement("seconds");
+		result.addListElement(seconds);
+		result.addListElement("samples_per_second");
+		result.addListElement((st.time != 0) ? (st.samples / seconds) : 0.0);
+		if (st.cycles != 0) {
+			result.addListElement("cycles_per_sample");
+			result.addListElement((st.samples != 0)
+				? (double(st.cycles) / st.samples) : 0.0);
+		}
+		result.addListElement("hash");
+		SHA1 copy = st.sha1; // digest() finalizes, keep the original
+		result.addListElement(copy.digest().toString());
+	} else {
+		int num = tokens[2].getInt(getInterpreter());
+		if (num <= 0) {
+			throw CommandException("Number of samples must be positive");
+		}
+		generate(*device, st, num);
+	}
+}
+
+string MSXMixer::SoundchipGenerateCmd::help(const vector<string>& /*tokens*/) const
+{
+	return "Benchmark and verify the emulation of a sound chip.\n"
+	       "  soundchip_generate <device> <samples>  generate the given number of samples (at the native rate of the chip)\n"
+	       "  soundchip_generate <device> rate       return the native sample rate of the chip\n"
+	       "  soundchip_generate <device> stats      return the number of generated samples, the time it took (also as samples per second and host cycles per sample) and a sha1 hash over all generated samples\n"
+	       "  soundchip_generate <device> reset      reset the statistics and the hash\n"
+	       "Note: generating samples directly advances the internal state of the sound chip, so only use this on a machine dedicated to benchmarking (see the 'soundchip_benchmark' script).\n";
+}
+
+void MSXMixer::SoundchipGenerateCmd::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		vector<string_ref> devices;
+		auto& msxMixer = OUTER(MSXMixer, soundchipGenerateCmd);
+		for (auto& info : msxMixer.infos) {
+			devices.emplace_back(info.device->getName());
+		}
+		completeString(tokens, devices);
+	} else if (tokens.size() == 3) {
+		static const char* const cmds[] = { "rate", "stats", "reset" };
+		completeString(tokens, cmds);
+	}
+}
+
 } // namespace openmsx
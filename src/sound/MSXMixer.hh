@@ -4,6 +4,8 @@
 #include "Schedulable.hh"
 #include "Observer.hh"
 #include "InfoTopic.hh"
+#include "Command.hh"
+#include "sha1.hh"
 #include "EmuTime.hh"
 #include "DynamicClock.hh"
 #include <cstdint>
@@ -23,6 +25,7 @@ class StringSetting;
 class BooleanSetting;
 class Setting;
 class AviRecorder;
+class CliComm;
 
 class MSXMixer final : private Schedulable, private Observer<Setting>
                      , private Observer<ThrottleManager>
@@ -102,8 +105,15 @@ public:
 
 	SoundDevice* findDevice(string_ref name) const;
 
+	CliComm& getCliComm();
+
 	void reInit();
 
+	/** Like reInit(), but also restart the resamplers of all sound
+	  * devices. Needed when the emulated time jumped backwards.
+	  */
+	void resetStreams();
+
 private:
 	struct SoundDeviceInfo {
 		SoundDevice* device;
@@ -159,6 +169,27 @@ private:
 		void tabCompletion(std::vector<std::string>& tokens) const override;
 	} soundDeviceInfo;
 
+	class SoundchipGenerateCmd final : public Command {
+	public:
+		explicit SoundchipGenerateCmd(CommandController& commandController);
+		void execute(array_ref<TclObject> tokens,
+		             TclObject& result) override;
+		std::string help(const std::vector<std::string>& tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	private:
+		struct Stats {
+			std::string name;
+			SHA1 sha1;
+			uint64_t samples = 0;
+			uint64_t time = 0;   // in us
+			uint64_t cycles = 0; // host CPU cycles (0 if unsupported)
+		};
+		Stats& getStats(string_ref name);
+		void generate(SoundDevice& device, Stats& stats, unsigned num);
+
+		std::vector<Stats> stats;
+	} soundchipGenerateCmd;
+
 	AviRecorder* recorder;
 	unsigned synchronousCounter;
 
@@ -79,12 +79,12 @@ void Mixer::reloadDriver()
 	// this means we end up without driver if creating the new one failed
 	// for some reason.
 
-	driver = make_unique<NullSoundDriver>();
+	driver = make_unique<NullSoundDriver>(frequencySetting.getInt());
 
 	try {
 		switch (soundDriverSetting.getEnum()) {
 		case SND_NULL:
-			driver = make_unique<NullSoundDriver>();
+			driver = make_unique<NullSoundDriver>(frequencySetting.getInt());
 			break;
 		case SND_SDL:
 			driver = make_unique<SDLSoundDriver>(
@@ -12,7 +12,7 @@ void NullSoundDriver::unmute()
 
 unsigned NullSoundDriver::getFrequency() const
 {
-	return 44100;
+	return frequency;
 }
 
 unsigned NullSoundDriver::getSamples() const
@@ -8,6 +8,10 @@ namespace openmsx {
 class NullSoundDriver final : public SoundDriver
 {
 public:
+	/** The null driver doesn't output anything, but it still determines
+	  * the sample rate of the MSX mixers (e.g. when recording). */
+	explicit NullSoundDriver(unsigned frequency_) : frequency(frequency_) {}
+
 	void mute() override;
 	void unmute() override;
 
@@ -15,6 +19,9 @@ public:
 	unsigned getSamples() const override;
 
 	void uploadBuffer(int16_t* buffer, unsigned len) override;
+
+private:
+	const unsigned frequency;
 };
 
 } // namespace openmsx
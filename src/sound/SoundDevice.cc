@@ -131,7 +131,7 @@ void SoundDevice::recordChannel(unsigned channel, const Filename& filename)
 	bool wasRecording = writer[channel] != nullptr;
 	if (!filename.empty()) {
 		writer[channel] = make_unique<Wav16Writer>(
-			filename, stereo, inputSampleRate);
+			mixer.getCliComm(), filename, stereo, inputSampleRate);
 	} else {
 		writer[channel].reset();
 	}
@@ -46,6 +46,18 @@ public:
 	void recordChannel(unsigned channel, const Filename& filename);
 	void muteChannel  (unsigned channel, bool muted);
 
+	/** Directly generate sound data at the input sample rate of this
+	  * device, so bypassing the resampler. This is used by the
+	  * 'soundchip_generate' command to benchmark and verify the sound
+	  * chip emulation cores. Note that this advances the internal state
+	  * of the sound chip (e.g. envelopes) without advancing EmuTime.
+	  * @see mixChannels() for the parameters and the buffer requirements.
+	  */
+	bool generateDirect(int* dataOut, unsigned num) {
+		return mixChannels(dataOut, num);
+	}
+	unsigned getInputRate() const { return inputSampleRate; }
+
 protected:
 	/** Constructor.
 	  * @param mixer The Mixer object
@@ -76,7 +88,6 @@ protected:
 	void updateStream(EmuTime::param time);
 
 	void setInputRate(unsigned sampleRate) { inputSampleRate = sampleRate; }
-	unsigned getInputRate() const { return inputSampleRate; }
 
 public: // Will be called by Mixer:
 	/**
@@ -1,6 +1,9 @@
 #include "WavWriter.hh"
+#include "CliComm.hh"
+#include "Filename.hh"
 #include "MSXException.hh"
 #include "Math.hh"
+#include "likely.hh"
 #include "vla.hh"
 #include "endian.hh"
 #include <cstring>
@@ -8,10 +11,19 @@
 
 namespace openmsx {
 
-WavWriter::WavWriter(const Filename& filename,
+WavWriter::WavWriter(CliComm& cliComm_, const Filename& filename_,
                      unsigned channels, unsigned bits, unsigned frequency)
-	: file(filename, "wb")
-	, bytes(0)
+	: bytes(0)
+	, cliComm(cliComm_)
+	, file(filename_, "wb")
+	, filename(filename_.getResolved())
+	, pendingHeader(false)
+	, pendingPad(false)
+	, reported(false)
+	, head(0)
+	, tail(0)
+	, stop(false)
+	, failed(false)
 {
 	// write wav header
 	struct WavHeader {
@@ -45,43 +57,157 @@ WavWriter::WavWriter(const Filename& filename,
 	header.subChunk2Size = 0; // actaul value filled in later
 
 	file.write(&header, sizeof(header));
+
+	for (auto& chunk : queue) {
+		chunk.updateHeader = false;
+		chunk.pad = false;
+	}
+	pending.reserve(CHUNK_SIZE);
+	thread = std::thread([this]() { run(); });
 }
 
 WavWriter::~WavWriter()
 {
-	try {
-		// data chunk must have an even number of bytes
-		if (bytes & 1) {
-			uint8_t pad = 0;
-			file.write(&pad, 1);
-		}
-
-		flush(); // write header
-	} catch (MSXException&) {
-		// ignore, can't throw from destructor
+	// data chunk must have an even number of bytes (the padding byte is
+	// added by the writer thread)
+	pendingPad = (bytes & 1) != 0;
+	pendingHeader = true; // write header
+	while (!failed && !tryPush()) {
+		// queue is full, wait till the writer thread catches up
+		std::this_thread::yield();
 	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+		condition.notify_one();
+	}
+	thread.join();
+	checkError();
 }
 
 void WavWriter::flush()
 {
-	// TODO For now (before C++11) this needs separate definition and
-	//      initialization. See comments in Endian::EndianT for details.
-	Endian::L32 totalSize, wavSize;
-	totalSize = (bytes + 44 - 8 + 1) & ~1; // round up to even number
-	wavSize   = bytes;
-
-	file.seek(4);
-	file.write(&totalSize, 4);
-	file.seek(40);
-	file.write(&wavSize, 4);
-	file.seek(file.getSize()); // SEEK_END
-	file.flush();
+	pendingHeader = true;
+	push();
+}
+
+void WavWriter::writeData(const void* data, size_t size)
+{
+	if (unlikely(checkError())) return;
+	auto* p = static_cast<const uint8_t*>(data);
+	pending.insert(end(pending), p, p + size);
+	bytes += unsigned(size);
+	if (pending.size() >= CHUNK_SIZE) {
+		push();
+	}
+}
+
+void WavWriter::push()
+{
+	if (unlikely(checkError())) return;
+	// When the queue is full, simply keep on collecting data in 'pending'
+	// and try again on the next call. Only when that grows too large, wait
+	// till the writer thread catches up, so memory usage stays bounded.
+	if (tryPush() || (pending.size() < MAX_PENDING)) return;
+	while (!tryPush()) {
+		if (checkError()) return;
+		std::this_thread::yield();
+	}
+}
+
+bool WavWriter::tryPush()
+{
+	unsigned h = head.load(std::memory_order_relaxed);
+	if ((h - tail.load(std::memory_order_acquire)) == QUEUE_SIZE) {
+		return false; // full
+	}
+	auto& chunk = queue[h & (QUEUE_SIZE - 1)];
+	// the writer thread leaves behind an empty buffer (with capacity)
+	chunk.data.swap(pending);
+	chunk.updateHeader = pendingHeader;
+	chunk.pad = pendingPad;
+	pendingHeader = false;
+	pendingPad = false;
+	head.store(h + 1, std::memory_order_release);
+	// Notify while holding the mutex, otherwise the writer thread could
+	// miss this wakeup (between checking the queue and waiting). This
+	// happens once per chunk, so it's not a problem for the emulation
+	// thread.
+	std::lock_guard<std::mutex> lock(mutex);
+	condition.notify_one();
+	return true;
+}
+
+bool WavWriter::checkError()
+{
+	if (likely(!failed.load(std::memory_order_acquire))) return false;
+	if (!reported) {
+		reported = true;
+		pending.clear();
+		std::string message;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			message = error;
+		}
+		cliComm.printWarning("Error while writing to " + filename +
+		                     ": " + message);
+	}
+	return true;
+}
+
+void WavWriter::run()
+{
+	size_t written = 0;
+	while (true) {
+		unsigned t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) {
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&] {
+				return stop ||
+				       (t != head.load(std::memory_order_acquire));
+			});
+			// Only stop once all chunks (including the final one
+			// pushed by the destructor) are written.
+			if (t == head.load(std::memory_order_acquire)) break;
+			continue;
+		}
+		auto& chunk = queue[t & (QUEUE_SIZE - 1)];
+		if (!failed) {
+			try {
+				file.write(chunk.data.data(), chunk.data.size());
+				written += chunk.data.size();
+				if (chunk.pad) {
+					uint8_t pad = 0;
+					file.write(&pad, 1);
+				}
+				if (chunk.updateHeader) {
+					// TODO For now (before C++11) this needs separate definition and
+					//      initialization. See comments in Endian::EndianT for details.
+					Endian::L32 totalSize, wavSize;
+					totalSize = (written + 44 - 8 + 1) & ~1; // round up to even number
+					wavSize   = unsigned(written);
+
+					file.seek(4);
+					file.write(&totalSize, 4);
+					file.seek(40);
+					file.write(&wavSize, 4);
+					file.seek(file.getSize()); // SEEK_END
+					file.flush();
+				}
+			} catch (MSXException& e) {
+				std::lock_guard<std::mutex> lock(mutex);
+				error = e.getMessage();
+				failed.store(true, std::memory_order_release);
+			}
+		}
+		chunk.data.clear(); // keeps capacity, reused by the producer
+		tail.store(t + 1, std::memory_order_release);
+	}
 }
 
 void Wav8Writer::write(const uint8_t* buffer, unsigned samples)
 {
-	file.write(buffer, samples);
-	bytes += samples;
+	writeData(buffer, samples);
 }
 
 void Wav16Writer::write(const int16_t* buffer, unsigned samples)
@@ -100,11 +226,10 @@ void Wav16Writer::write(const int16_t* buffer, unsigned samples)
 		for (unsigned i = 0; i < samples; ++i) {
 			buf[i] = buffer[i];
 		}
-		file.write(buf.data(), size);
+		writeData(buf.data(), size);
 	} else {
-		file.write(buffer, size);
+		writeData(buffer, size);
 	}
-	bytes += size;
 }
 
 void Wav16Writer::write(const int* buffer, unsigned samples, int amp)
@@ -115,8 +240,7 @@ void Wav16Writer::write(const int* buffer, unsigned samples, int amp)
 		buf[i] = Math::clipIntToShort(buffer[i] * amp);
 	}
 	unsigned size = sizeof(int16_t) * samples;
-	file.write(buf.data(), size);
-	bytes += size;
+	writeData(buf.data(), size);
 }
 
 void Wav16Writer::writeSilence(unsigned samples)
@@ -124,8 +248,7 @@ void Wav16Writer::writeSilence(unsigned samples)
 	VLA(int16_t, buf, samples);
 	unsigned size = sizeof(int16_t) * samples;
 	memset(buf, 0, size);
-	file.write(buf, size);
-	bytes += size;
+	writeData(buf, size);
 }
 
 } // namespace openmsx
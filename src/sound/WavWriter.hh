@@ -2,14 +2,30 @@
 #define WAVWRITER_HH
 
 #include "File.hh"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include <cassert>
 #include <cstdint>
 
 namespace openmsx {
 
+class CliComm;
 class Filename;
 
 /** Base class for writing WAV files.
+  *
+  * The actual file I/O is done asynchronously: the written data is collected
+  * in large chunks which are handed over via a lock-free (single producer,
+  * single consumer) queue to a background thread. So a slow disk doesn't
+  * stall the emulation thread, unless the disk is so slow that the queue
+  * stays full and the not yet queued data exceeds MAX_PENDING. Then the
+  * emulation thread waits, so memory usage stays bounded. If a write fails in the background thread,
+  * this is reported (once) via CliComm on the next call from the emulation
+  * thread, and all further data is dropped.
   */
 class WavWriter
 {
@@ -20,16 +36,59 @@ public:
 
 	/** Flush data to file and update header. Try to make (possibly)
 	  * incomplete file already usable for external programs.
+	  * This doesn't wait for the data to actually reach the disk.
 	  */
 	void flush();
 
 protected:
-	WavWriter(const Filename& filename,
+	WavWriter(CliComm& cliComm, const Filename& filename,
 	          unsigned channels, unsigned bits, unsigned frequency);
 	~WavWriter();
 
-	File file;
+	/** Queue data to be written to the file. */
+	void writeData(const void* data, size_t size);
+
 	unsigned bytes;
+
+private:
+	void push();
+	bool tryPush();
+	bool checkError();
+	void run();
+
+	struct Chunk {
+		std::vector<uint8_t> data;
+		bool updateHeader;
+		bool pad; // write a (not counted) padding byte
+	};
+	// must be a power of 2
+	static const unsigned QUEUE_SIZE = 16;
+	// the size from which on a chunk gets handed over to the writer thread
+	static const size_t CHUNK_SIZE = 256 * 1024;
+	// when the queue is full, collect at most this much data in 'pending'
+	static const size_t MAX_PENDING = QUEUE_SIZE * CHUNK_SIZE;
+
+	CliComm& cliComm;
+	File file; // only used by the writer thread after construction
+	const std::string filename;
+
+	// emulation thread only
+	std::vector<uint8_t> pending;
+	bool pendingHeader;
+	bool pendingPad;
+	bool reported;
+
+	// shared between both threads
+	Chunk queue[QUEUE_SIZE];
+	std::atomic<unsigned> head; // only written by the emulation thread
+	std::atomic<unsigned> tail; // only written by the writer thread
+	std::atomic<bool> stop;
+	std::atomic<bool> failed;
+	std::mutex mutex; // for 'condition' and 'error'
+	std::condition_variable condition;
+	std::string error;
+
+	std::thread thread;
 };
 
 /** Writes 8-bit WAV files.
@@ -37,8 +96,9 @@ protected:
 class Wav8Writer : public WavWriter
 {
 public:
-	Wav8Writer(const Filename& filename, unsigned channels, unsigned frequency)
-		: WavWriter(filename, channels, 8, frequency) {}
+	Wav8Writer(CliComm& cliComm, const Filename& filename,
+	           unsigned channels, unsigned frequency)
+		: WavWriter(cliComm, filename, channels, 8, frequency) {}
 
 	void write(const uint8_t* buffer, unsigned stereo, unsigned samples) {
 		assert(stereo == 1 || stereo == 2);
@@ -54,8 +114,9 @@ private:
 class Wav16Writer : public WavWriter
 {
 public:
-	Wav16Writer(const Filename& filename, unsigned channels, unsigned frequency)
-		: WavWriter(filename, channels, 16, frequency) {}
+	Wav16Writer(CliComm& cliComm, const Filename& filename,
+	            unsigned channels, unsigned frequency)
+		: WavWriter(cliComm, filename, channels, 16, frequency) {}
 
 	void write(const int16_t* buffer, unsigned stereo, unsigned samples) {
 		assert(stereo == 1 || stereo == 2);
@@ -2,8 +2,11 @@
 #include "YM2413Burczynski.hh"
 #include "WavWriter.hh"
 #include "WavData.hh"
+#include "CliComm.hh"
+#include "Thread.hh"
 #include "Filename.hh"
 #include "StringOp.hh"
+#include "Timer.hh"
 #include <cstdint>
 #include <vector>
 #include <string>
@@ -43,10 +46,25 @@ static void error(const string& message)
 }
 
 
+// WavWriter reports write errors via CliComm, print them on stdout.
+class TestCliComm final : public CliComm
+{
+public:
+	void log(LogLevel /*level*/, string_ref message) override
+	{
+		cout << message << endl;
+	}
+	void update(UpdateType /*type*/, string_ref /*name*/,
+	            string_ref /*value*/) override
+	{
+	}
+};
+
 static void saveWav(const string& filename, const Samples& data)
 {
-	WavWriter writer(Filename(filename), 1, 16, 3579545 / 72);
-	writer.write16mono(&data[0], data.size());
+	TestCliComm cliComm;
+	Wav16Writer writer(cliComm, Filename(filename), 1, 3579545 / 72);
+	writer.write(data.data(), 1, unsigned(data.size()));
 }
 
 static void loadWav(const string& filename, Samples& data)
@@ -54,7 +72,6 @@ static void loadWav(const string& filename, Samples& data)
 	WavData wav(filename);
 	assert(wav.getFreq() == 3579545 / 72);
 	assert(wav.getBits() == 16);
-	assert(wav.getChannels() == 1);
 
 	auto rawData = reinterpret_cast<const int16_t*>(wav.getData());
 	data.assign(rawData, rawData + wav.getSize());
@@ -82,6 +99,7 @@ static void test(YM2413Core& core, const Log& log,
 	cout << " test " << testName << " ..." << endl;
 
 	Samples generatedSamples[CHANNELS];
+	uint64_t time = 0;
 
 	for (auto& l : log) {
 		// write registers
@@ -100,8 +118,14 @@ static void test(YM2413Core& core, const Log& log,
 		}
 
 		// actually generate samples
+		uint64_t t0 = Timer::getTime();
 		core.generateChannels(bufs, samples);
+		time += Timer::getTime() - t0;
 	}
+	unsigned total = generatedSamples[0].size();
+	cout << "  " << total << " samples in " << time << "us";
+	if (time) cout << " (" << (total * 1000000.0 / time) << " samples/s)";
+	cout << endl;
 
 	// amplify generated data
 	// (makes comparison between different cores easier)
@@ -226,6 +250,7 @@ template<typename CORE> static void testAll(const string& coreName_)
 
 int main()
 {
+	Thread::setMainThread();
 	testAll<YM2413Okazaki::   YM2413>("Okazaki");
 	testAll<YM2413Burczynski::YM2413>("Burczynski");
 	return 0;
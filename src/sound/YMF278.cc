@@ -20,6 +20,10 @@
 
 namespace openmsx {
 
+// Max number of samples in YMF278::decodedRom (8MB). Enough to hold all the
+// samples in the 2MB ROM, even when they're decoded with different lengths.
+static const unsigned MAX_DECODED_ROM = 4 * 1024 * 1024;
+
 static const int EG_SH = 16; // 16.16 fixed point (EG timing)
 static const unsigned EG_TIMER_OVERFLOW = 1 << EG_SH;
 
@@ -200,6 +204,9 @@ void YMF278::Slot::reset()
 
 	// not strictly needed, but avoid UMR on savestate
 	pos = sample1 = sample2 = 0;
+
+	decoded = nullptr;
+	decodedLen = 0;
 }
 
 int YMF278::Slot::compute_rate(int val) const
@@ -250,167 +257,164 @@ void YMF278::Slot::set_lfo(int newlfo)
 }
 
 
-void YMF278::advance()
+void YMF278::advanceSlot(Slot& op, unsigned egCnt)
 {
-	eg_cnt++;
-	for (auto& op : slots) {
-		if (op.lfo_active) {
-			op.lfo_cnt++;
-			if (op.lfo_cnt < op.lfo_max) {
-				op.lfo_step++;
-			} else if (op.lfo_cnt < (op.lfo_max * 3)) {
-				op.lfo_step--;
-			} else {
-				op.lfo_step++;
-				if (op.lfo_cnt == (op.lfo_max * 4)) {
-					op.lfo_cnt = 0;
-				}
+	if (op.lfo_active) {
+		op.lfo_cnt++;
+		if (op.lfo_cnt < op.lfo_max) {
+			op.lfo_step++;
+		} else if (op.lfo_cnt < (op.lfo_max * 3)) {
+			op.lfo_step--;
+		} else {
+			op.lfo_step++;
+			if (op.lfo_cnt == (op.lfo_max * 4)) {
+				op.lfo_cnt = 0;
 			}
 		}
+	}
 
-		// Envelope Generator
-		switch(op.state) {
-		case EG_ATT: { // attack phase
-			byte rate = op.compute_rate(op.AR);
-			if (rate < 4) {
-				break;
-			}
-			byte shift = eg_rate_shift[rate];
-			if (!(eg_cnt & ((1 << shift) -1))) {
-				byte select = eg_rate_select[rate];
-				op.env_vol += (~op.env_vol * eg_inc[select + ((eg_cnt >> shift) & 7)]) >> 3;
-				if (op.env_vol <= MIN_ATT_INDEX) {
-					op.env_vol = MIN_ATT_INDEX;
-					if (op.DL) {
-						op.state = EG_DEC;
-					} else {
-						op.state = EG_SUS;
-					}
-				}
-			}
+	// Envelope Generator
+	switch(op.state) {
+	case EG_ATT: { // attack phase
+		byte rate = op.compute_rate(op.AR);
+		if (rate < 4) {
 			break;
 		}
-		case EG_DEC: { // decay phase
-			byte rate = op.compute_rate(op.D1R);
-			if (rate < 4) {
-				break;
-			}
-			byte shift = eg_rate_shift[rate];
-			if (!(eg_cnt & ((1 << shift) -1))) {
-				byte select = eg_rate_select[rate];
-				op.env_vol += eg_inc[select + ((eg_cnt >> shift) & 7)];
-
-				if ((unsigned(op.env_vol) > dl_tab[6]) && op.PRVB) {
-					op.state = EG_REV;
+		byte shift = eg_rate_shift[rate];
+		if (!(egCnt & ((1 << shift) -1))) {
+			byte select = eg_rate_select[rate];
+			op.env_vol += (~op.env_vol * eg_inc[select + ((egCnt >> shift) & 7)]) >> 3;
+			if (op.env_vol <= MIN_ATT_INDEX) {
+				op.env_vol = MIN_ATT_INDEX;
+				if (op.DL) {
+					op.state = EG_DEC;
 				} else {
-					if (op.env_vol >= op.DL) {
-						op.state = EG_SUS;
-					}
+					op.state = EG_SUS;
 				}
 			}
-			break;
 		}
-		case EG_SUS: { // sustain phase
-			byte rate = op.compute_rate(op.D2R);
-			if (rate < 4) {
-				break;
-			}
-			byte shift = eg_rate_shift[rate];
-			if (!(eg_cnt & ((1 << shift) -1))) {
-				byte select = eg_rate_select[rate];
-				op.env_vol += eg_inc[select + ((eg_cnt >> shift) & 7)];
-
-				if ((unsigned(op.env_vol) > dl_tab[6]) && op.PRVB) {
-					op.state = EG_REV;
-				} else {
-					if (op.env_vol >= MAX_ATT_INDEX) {
-						op.env_vol = MAX_ATT_INDEX;
-						op.active = false;
-					}
-				}
-			}
+		break;
+	}
+	case EG_DEC: { // decay phase
+		byte rate = op.compute_rate(op.D1R);
+		if (rate < 4) {
 			break;
 		}
-		case EG_REL: { // release phase
-			byte rate = op.compute_rate(op.RR);
-			if (rate < 4) {
-				break;
-			}
-			byte shift = eg_rate_shift[rate];
-			if (!(eg_cnt & ((1 << shift) -1))) {
-				byte select = eg_rate_select[rate];
-				op.env_vol += eg_inc[select + ((eg_cnt >> shift) & 7)];
+		byte shift = eg_rate_shift[rate];
+		if (!(egCnt & ((1 << shift) -1))) {
+			byte select = eg_rate_select[rate];
+			op.env_vol += eg_inc[select + ((egCnt >> shift) & 7)];
 
-				if ((unsigned(op.env_vol) > dl_tab[6]) && op.PRVB) {
-					op.state = EG_REV;
-				} else {
-					if (op.env_vol >= MAX_ATT_INDEX) {
-						op.env_vol = MAX_ATT_INDEX;
-						op.active = false;
-					}
+			if ((unsigned(op.env_vol) > dl_tab[6]) && op.PRVB) {
+				op.state = EG_REV;
+			} else {
+				if (op.env_vol >= op.DL) {
+					op.state = EG_SUS;
 				}
 			}
+		}
+		break;
+	}
+	case EG_SUS: { // sustain phase
+		byte rate = op.compute_rate(op.D2R);
+		if (rate < 4) {
 			break;
 		}
-		case EG_REV: { // pseudo reverb
-			// TODO improve env_vol update
-			byte rate = op.compute_rate(5);
-			//if (rate < 4) {
-			//	break;
-			//}
-			byte shift = eg_rate_shift[rate];
-			if (!(eg_cnt & ((1 << shift) - 1))) {
-				byte select = eg_rate_select[rate];
-				op.env_vol += eg_inc[select + ((eg_cnt >> shift) & 7)];
+		byte shift = eg_rate_shift[rate];
+		if (!(egCnt & ((1 << shift) -1))) {
+			byte select = eg_rate_select[rate];
+			op.env_vol += eg_inc[select + ((egCnt >> shift) & 7)];
 
+			if ((unsigned(op.env_vol) > dl_tab[6]) && op.PRVB) {
+				op.state = EG_REV;
+			} else {
 				if (op.env_vol >= MAX_ATT_INDEX) {
 					op.env_vol = MAX_ATT_INDEX;
 					op.active = false;
 				}
 			}
+		}
+		break;
+	}
+	case EG_REL: { // release phase
+		byte rate = op.compute_rate(op.RR);
+		if (rate < 4) {
 			break;
 		}
-		case EG_DMP: { // damping
-			// TODO improve env_vol update, damp is just fastest decay now
-			byte rate = 56;
-			byte shift = eg_rate_shift[rate];
-			if (!(eg_cnt & ((1 << shift) - 1))) {
-				byte select = eg_rate_select[rate];
-				op.env_vol += eg_inc[select + ((eg_cnt >> shift) & 7)];
+		byte shift = eg_rate_shift[rate];
+		if (!(egCnt & ((1 << shift) -1))) {
+			byte select = eg_rate_select[rate];
+			op.env_vol += eg_inc[select + ((egCnt >> shift) & 7)];
 
+			if ((unsigned(op.env_vol) > dl_tab[6]) && op.PRVB) {
+				op.state = EG_REV;
+			} else {
 				if (op.env_vol >= MAX_ATT_INDEX) {
 					op.env_vol = MAX_ATT_INDEX;
 					op.active = false;
 				}
 			}
-			break;
 		}
-		case EG_OFF:
-			// nothing
-			break;
-
-		default:
-			UNREACHABLE;
+		break;
+	}
+	case EG_REV: { // pseudo reverb
+		// TODO improve env_vol update
+		byte rate = op.compute_rate(5);
+		//if (rate < 4) {
+		//	break;
+		//}
+		byte shift = eg_rate_shift[rate];
+		if (!(egCnt & ((1 << shift) - 1))) {
+			byte select = eg_rate_select[rate];
+			op.env_vol += eg_inc[select + ((egCnt >> shift) & 7)];
+
+			if (op.env_vol >= MAX_ATT_INDEX) {
+				op.env_vol = MAX_ATT_INDEX;
+				op.active = false;
+			}
 		}
+		break;
+	}
+	case EG_DMP: { // damping
+		// TODO improve env_vol update, damp is just fastest decay now
+		byte rate = 56;
+		byte shift = eg_rate_shift[rate];
+		if (!(egCnt & ((1 << shift) - 1))) {
+			byte select = eg_rate_select[rate];
+			op.env_vol += eg_inc[select + ((egCnt >> shift) & 7)];
+
+			if (op.env_vol >= MAX_ATT_INDEX) {
+				op.env_vol = MAX_ATT_INDEX;
+				op.active = false;
+			}
+		}
+		break;
+	}
+	case EG_OFF:
+		// nothing
+		break;
+
+	default:
+		UNREACHABLE;
 	}
 }
 
-int16_t YMF278::getSample(Slot& op)
+int16_t YMF278::decodeSample(unsigned startaddr, byte bits, unsigned pos) const
 {
 	// TODO How does this behave when R#2 bit 0 = 1?
 	//      As-if read returns 0xff? (Like for CPU memory reads.) Or is
 	//      sound generation blocked at some higher level?
 	int16_t sample;
-	switch (op.bits) {
+	switch (bits) {
 	case 0: {
 		// 8 bit
-		sample = readMem(op.startaddr + op.pos) << 8;
+		sample = readMem(startaddr + pos) << 8;
 		break;
 	}
 	case 1: {
 		// 12 bit
-		unsigned addr = op.startaddr + ((op.pos / 2) * 3);
-		if (op.pos & 1) {
+		unsigned addr = startaddr + ((pos / 2) * 3);
+		if (pos & 1) {
 			sample = readMem(addr + 2) << 8 |
 				 ((readMem(addr + 1) << 4) & 0xF0);
 		} else {
@@ -421,7 +425,7 @@ int16_t YMF278::getSample(Slot& op)
 	}
 	case 2: {
 		// 16 bit
-		unsigned addr = op.startaddr + (op.pos * 2);
+		unsigned addr = startaddr + (pos * 2);
 		sample = (readMem(addr + 0) << 8) |
 			 (readMem(addr + 1));
 		break;
@@ -433,6 +437,61 @@ int16_t YMF278::getSample(Slot& op)
 	return sample;
 }
 
+int16_t YMF278::getSample(Slot& op)
+{
+	if (likely(op.pos < op.decodedLen)) {
+		return op.decoded[op.pos];
+	}
+	return decodeSample(op.startaddr, op.bits, op.pos);
+}
+
+// Must be called after each change in startaddr, loopaddr, endaddr or bits.
+void YMF278::updateDecoded(Slot& op)
+{
+	op.decoded = nullptr;
+	op.decodedLen = 0;
+	if (op.bits == 3) return; // unspecified format
+
+	// While playing, 'pos' stays in the range [0, len).
+	unsigned len = std::max(std::max(op.endaddr, op.loopaddr + 1), 2u);
+	unsigned bytes = (op.bits == 0) ? len
+	               : (op.bits == 1) ? ((len + 1) / 2) * 3
+	               :                  len * 2;
+	if ((op.startaddr + bytes) > 0x200000) {
+		// (partly) located in RAM (or wraps), RAM content can change,
+		// so these samples are decoded on the fly.
+		return;
+	}
+
+	uint64_t key = op.startaddr | (op.bits << 22) | (uint64_t(len) << 24);
+	auto it = decodedRom.find(key);
+	if (it == end(decodedRom)) {
+		if ((decodedRomSize + len) > MAX_DECODED_ROM) {
+			clearDecodedRom();
+		}
+		std::vector<int16_t> samples(len);
+		for (unsigned i = 0; i < len; ++i) {
+			samples[i] = decodeSample(op.startaddr, op.bits, i);
+		}
+		it = decodedRom.emplace(key, std::move(samples)).first;
+		decodedRomSize += len;
+	}
+	op.decoded = it->second.data();
+	op.decodedLen = len;
+}
+
+void YMF278::clearDecodedRom()
+{
+	// slots that used the cache fall back to decoding on the fly (till
+	// their next updateDecoded())
+	for (auto& op : slots) {
+		op.decoded = nullptr;
+		op.decodedLen = 0;
+	}
+	decodedRom.clear();
+	decodedRomSize = 0;
+}
+
 bool YMF278::anyActive()
 {
 	for (auto& op : slots) {
@@ -452,47 +511,48 @@ void YMF278::generateChannels(int** bufs, unsigned num)
 		return;
 	}
 
+	// Each slot only depends on its own state and on the global envelope
+	// counter, so generate the whole block per slot. This gives the same
+	// result as generating all slots interleaved per sample.
 	int vl = mix_level[pcm_l];
 	int vr = mix_level[pcm_r];
-	for (unsigned j = 0; j < num; ++j) {
-		for (int i = 0; i < 24; ++i) {
-			auto& sl = slots[i];
-			if (!sl.active) {
-				//bufs[i][2 * j + 0] += 0;
-				//bufs[i][2 * j + 1] += 0;
-				continue;
-			}
-
-			int16_t sample = (sl.sample1 * (0x10000 - sl.stepptr) +
-			                  sl.sample2 * sl.stepptr) >> 16;
-			int vol = sl.TL + (sl.env_vol >> 2) + sl.compute_am();
-
-			int volLeft  = vol + pan_left [int(sl.pan)] + vl;
-			int volRight = vol + pan_right[int(sl.pan)] + vr;
-			// TODO prob doesn't happen in real chip
-			volLeft  = std::max(0, volLeft);
-			volRight = std::max(0, volRight);
-
-			bufs[i][2 * j + 0] += (sample * volume[volLeft] ) >> 14;
-			bufs[i][2 * j + 1] += (sample * volume[volRight]) >> 14;
-
-			unsigned step = (sl.lfo_active && sl.vib)
-			              ? calcStep(sl.OCT, sl.FN, sl.compute_vib())
-			              : sl.step;
-			sl.stepptr += step;
-
-			while (sl.stepptr >= 0x10000) {
-				sl.stepptr -= 0x10000;
-				sl.sample1 = sl.sample2;
-				sl.pos++;
-				if (sl.pos >= sl.endaddr) {
-					sl.pos = sl.loopaddr;
+	for (int i = 0; i < 24; ++i) {
+		auto& sl = slots[i];
+		int* buf = bufs[i];
+		for (unsigned j = 0; j < num; ++j) {
+			if (sl.active) {
+				int16_t sample = (sl.sample1 * (0x10000 - sl.stepptr) +
+				                  sl.sample2 * sl.stepptr) >> 16;
+				int vol = sl.TL + (sl.env_vol >> 2) + sl.compute_am();
+
+				int volLeft  = vol + pan_left [int(sl.pan)] + vl;
+				int volRight = vol + pan_right[int(sl.pan)] + vr;
+				// TODO prob doesn't happen in real chip
+				volLeft  = std::max(0, volLeft);
+				volRight = std::max(0, volRight);
+
+				buf[2 * j + 0] += (sample * volume[volLeft] ) >> 14;
+				buf[2 * j + 1] += (sample * volume[volRight]) >> 14;
+
+				unsigned step = (sl.lfo_active && sl.vib)
+				              ? calcStep(sl.OCT, sl.FN, sl.compute_vib())
+				              : sl.step;
+				sl.stepptr += step;
+
+				while (sl.stepptr >= 0x10000) {
+					sl.stepptr -= 0x10000;
+					sl.sample1 = sl.sample2;
+					sl.pos++;
+					if (sl.pos >= sl.endaddr) {
+						sl.pos = sl.loopaddr;
+					}
+					sl.sample2 = getSample(sl);
 				}
-				sl.sample2 = getSample(sl);
 			}
+			advanceSlot(sl, eg_cnt + j + 1);
 		}
-		advance();
 	}
+	eg_cnt += num;
 }
 
 void YMF278::keyOnHelper(YMF278::Slot& slot)
@@ -537,6 +597,7 @@ void YMF278::writeRegDirect(byte reg, byte data, EmuTime::param time)
 			                 ((buf[0] & 0x3F) << 16);
 			slot.loopaddr = buf[4] + (buf[3] << 8);
 			slot.endaddr  = (((buf[6] + (buf[5] << 8)) ^ 0xFFFF) + 1);
+			updateDecoded(slot);
 			for (int i = 7; i < 12; ++i) {
 				// Verified on real YMF278:
 				// After tone loading, if you read these
@@ -748,6 +809,7 @@ YMF278::YMF278(const std::string& name_, int ramSize_,
 	, rom(getName() + " ROM", "rom", config)
 	, ram(config, getName() + " RAM", "YMF278 sample RAM",
 	      ramSize_ * 1024) // size in kB
+	, decodedRomSize(0)
 {
 	if (rom.getSize() != 0x200000) { // 2MB
 		throw MSXException(
@@ -796,6 +858,7 @@ void YMF278::clearRam()
 void YMF278::reset(EmuTime::param time)
 {
 	updateStream(time);
+	clearDecodedRom();
 
 	eg_cnt = 0;
 
@@ -1035,6 +1098,13 @@ void YMF278::serialize(Archive& ar, unsigned version)
 		memadr = (regs[3] << 16) | (regs[4] << 8) | regs[5];
 	}
 
+	if (ar.isLoader()) {
+		clearDecodedRom();
+		for (auto& op : slots) {
+			updateDecoded(op);
+		}
+	}
+
 	// TODO restore more state from registers
 	static const byte rewriteRegs[] = {
 		0xf8,    // fm_l, fm_r
@@ -8,7 +8,10 @@
 #include "EmuTime.hh"
 #include "openmsx.hh"
 #include "serialize_meta.hh"
+#include <cstdint>
+#include <map>
 #include <string>
+#include <vector>
 
 namespace openmsx {
 
@@ -79,6 +82,12 @@ private:
 		char RC;		// rate correction
 		char RR;
 
+		// Points to the pre-decoded samples in case the sample data is
+		// located in ROM (see YMF278::decodedRom), nullptr otherwise.
+		// Not serialized, it's recalculated from the other members.
+		const int16_t* decoded;
+		unsigned decodedLen;
+
 		byte bits;		// width of the samples
 		bool active;		// slot keyed on
 
@@ -92,7 +101,10 @@ private:
 	void writeRegDirect(byte reg, byte data, EmuTime::param time);
 	unsigned getRamAddress(unsigned addr) const;
 	int16_t getSample(Slot& op);
-	void advance();
+	int16_t decodeSample(unsigned startaddr, byte bits, unsigned pos) const;
+	void updateDecoded(Slot& op);
+	void clearDecodedRom();
+	void advanceSlot(Slot& op, unsigned egCnt);
 	bool anyActive();
 	void keyOnHelper(Slot& slot);
 
@@ -123,6 +135,16 @@ private:
 	Rom rom;
 	TrackedRam ram;
 
+	/** Cache of ROM samples, decoded into 16-bit linear samples. ROM
+	  * content never changes, so each sample (identified by start address,
+	  * sample width and length) only needs to be decoded once. The key
+	  * is: startaddr | (bits << 22) | (length << 24).
+	  * The guest controls these parameters, so the total size is bounded:
+	  * when it's full, the whole cache is cleared.
+	  */
+	std::map<uint64_t, std::vector<int16_t>> decodedRom;
+	unsigned decodedRomSize; // total number of samples in 'decodedRom'
+
 	/** Precalculated attenuation values with some margin for
 	  * envelope and pan levels.
 	  */
@@ -260,6 +260,18 @@ static void applyDeltaInPlace(uint8_t* buf, size_t size, const uint8_t* delta)
 	}
 }
 
+// Copy 'src' to 'dst', but skip the (fixed size) chunks that are already equal.
+static void copyChanged(uint8_t* dst, const uint8_t* src, size_t size)
+{
+	static const size_t CHUNK_SIZE = 256;
+	for (size_t i = 0; i < size; i += CHUNK_SIZE) {
+		size_t n = std::min(CHUNK_SIZE, size - i);
+		if (memcmp(dst + i, src + i, n) != 0) {
+			memcpy(dst + i, src + i, n);
+		}
+	}
+}
+
 #if STATISTICS
 
 // class DeltaBlock
@@ -308,6 +320,22 @@ void DeltaBlockCopy::apply(uint8_t* dst, size_t size) const
 #endif
 }
 
+void DeltaBlockCopy::applyChanged(uint8_t* dst, size_t size) const
+{
+	if (compressed()) {
+		MemBuffer<uint8_t> buf(size);
+		snappy::uncompress(
+			reinterpret_cast<const char*>(block.data()), compressedSize,
+			reinterpret_cast<char*>(buf.data()), size);
+		copyChanged(dst, buf.data(), size);
+	} else {
+		copyChanged(dst, block.data(), size);
+	}
+#ifdef DEBUG
+	assert(SHA1::calc(dst, size) == sha1);
+#endif
+}
+
 void DeltaBlockCopy::compress(size_t size)
 {
 	if (compressed()) return;
@@ -377,6 +405,15 @@ void DeltaBlockDiff::apply(uint8_t* dst, size_t size) const
 #endif
 }
 
+void DeltaBlockDiff::applyChanged(uint8_t* dst, size_t size) const
+{
+	prev->applyChanged(dst, size);
+	applyDeltaInPlace(dst, size, delta.data());
+#ifdef DEBUG
+	assert(SHA1::calc(dst, size) == sha1);
+#endif
+}
+
 size_t DeltaBlockDiff::getDeltaSize() const
 {
 	return delta.size();
@@ -23,6 +23,11 @@ public:
 #endif
 	virtual void apply(uint8_t* dst, size_t size) const = 0;
 
+	/** Like apply(), but 'dst' already holds a (similar) older version of
+	  * the data. Only the parts that actually differ are written.
+	  */
+	virtual void applyChanged(uint8_t* dst, size_t size) const = 0;
+
 protected:
 	DeltaBlock() = default;
 
@@ -44,6 +49,7 @@ class DeltaBlockCopy final : public DeltaBlock
 public:
 	DeltaBlockCopy(const uint8_t* data, size_t size);
 	void apply(uint8_t* dst, size_t size) const override;
+	void applyChanged(uint8_t* dst, size_t size) const override;
 	void compress(size_t size);
 	const uint8_t* getData();
 
@@ -61,6 +67,7 @@ public:
 	DeltaBlockDiff(const std::shared_ptr<DeltaBlockCopy>& prev_,
 	               const uint8_t* data, size_t size);
 	void apply(uint8_t* dst, size_t size) const override;
+	void applyChanged(uint8_t* dst, size_t size) const override;
 	size_t getDeltaSize() const;
 
 private:
@@ -1,6 +1,20 @@
 #include "TigerTree.hh"
+#include "File.hh"
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "StringOp.hh"
+#include "Timer.hh"
+#include "endian.hh"
 #include "Math.hh"
+#include "xxhash.hh"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
 #include <map>
+#include <system_error>
+#include <thread>
+#include <vector>
 #include <cstring>
 #include <cassert>
 
@@ -10,13 +24,14 @@ static const size_t BLOCK_SIZE = 1024;
 
 struct TTCacheEntry
 {
-	TTCacheEntry() : time(-1) {}
+	TTCacheEntry() : time(-1), dirty(false) {}
 
 	MemBuffer<TigerHash> hash;
 	MemBuffer<bool> valid;
 	size_t numNodes;
 	time_t time;
 	size_t numNodesValid;
+	bool dirty; // changed since loaded from / saved to the cache file
 };
 // Typically contains 0 or 1 element, and only rarely 2 or more. But we need
 // the address of existing elements to remain stable when new elements are
@@ -29,6 +44,109 @@ static size_t calcNumNodes(size_t dataSize)
 	return (numBlocks == 0) ? 1 : 2 * numBlocks - 1;
 }
 
+// Persistent version of the cache. Layout of a cache file (all integers
+// are little endian):
+//   magic, dataSize (64-bit), time (64-bit), name length (32-bit), name,
+//   numNodes (64-bit), numNodes valid-flags (1 byte each),
+//   padding up to a multiple of 8, numNodes hashes (24 bytes each)
+// Only the hashes of valid nodes have a meaningful value.
+static const char CACHE_MAGIC[8] = { 'o','M','S','X','t','t','h','1' };
+
+static std::string getCacheFilename(const std::string& name)
+{
+	// collisions are harmless, the full name is also stored in the file
+	return FileOperations::getUserDataDir() + "/tigertree/" +
+	       StringOp::toHexString(xxhash(name), 8) + ".tth";
+}
+
+static size_t headerSize(const std::string& name)
+{
+	return 8 + 8 + 8 + 4 + name.size() + 8;
+}
+
+static void loadCacheEntry(TTCacheEntry& entry, size_t dataSize,
+                           const std::string& name)
+{
+	try {
+		File file(getCacheFilename(name));
+		size_t size;
+		const uint8_t* p = file.mmap(size);
+		size_t hdr = headerSize(name);
+		size_t hashOffset = (hdr + entry.numNodes + 7) & ~7;
+		if ((size != (hashOffset + entry.numNodes * sizeof(TigerHash))) ||
+		    (memcmp(p, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) ||
+		    (Endian::read_UA_L64(p +  8) != dataSize) ||
+		    (time_t(Endian::read_UA_L64(p + 16)) != entry.time) ||
+		    (Endian::read_UA_L32(p + 24) != name.size()) ||
+		    (memcmp(p + 28, name.data(), name.size()) != 0) ||
+		    (Endian::read_UA_L64(p + 28 + name.size()) != entry.numNodes)) {
+			return;
+		}
+		const uint8_t* valid = p + hdr;
+		size_t numValid = 0;
+		for (size_t i = 0; i < entry.numNodes; ++i) {
+			entry.valid[i] = valid[i] != 0;
+			numValid += entry.valid[i];
+		}
+		memcpy(entry.hash.data(), p + hashOffset,
+		       entry.numNodes * sizeof(TigerHash));
+		entry.numNodesValid = numValid;
+	} catch (MSXException&) {
+		// no (readable) cache file
+	}
+}
+
+static void saveCacheEntry(const TTCacheEntry& entry, size_t dataSize,
+                           const std::string& name)
+{
+	std::string cacheName = getCacheFilename(name);
+	if (entry.numNodesValid == 0) {
+		// nothing worth storing, but do remove a possibly stale file
+		FileOperations::unlink(cacheName);
+		return;
+	}
+
+	std::vector<uint8_t> header(headerSize(name));
+	memcpy(header.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	Endian::write_UA_L64(&header[ 8], dataSize);
+	Endian::write_UA_L64(&header[16], uint64_t(entry.time));
+	Endian::write_UA_L32(&header[24], unsigned(name.size()));
+	memcpy(&header[28], name.data(), name.size());
+	Endian::write_UA_L64(&header[28 + name.size()], entry.numNodes);
+	for (size_t i = 0; i < entry.numNodes; ++i) {
+		header.push_back(entry.valid[i] ? 1 : 0);
+	}
+	header.resize((header.size() + 7) & ~7, 0);
+
+	// Write to a temporary file first, so that a concurrently running
+	// instance never sees a half written cache.
+	std::string tmpName = cacheName + ".tmp" + StringOp::toString(Timer::getTime());
+	try {
+		FileOperations::mkdirp(FileOperations::getUserDataDir() + "/tigertree");
+		std::ofstream out;
+		FileOperations::openofstream(out, tmpName,
+		                             std::ios::out | std::ios::binary);
+		if (!out.is_open()) return;
+		out.write(reinterpret_cast<const char*>(header.data()), header.size());
+		out.write(reinterpret_cast<const char*>(entry.hash.data()),
+		          entry.numNodes * sizeof(TigerHash));
+		if (!out.good()) {
+			out.close();
+			FileOperations::unlink(tmpName);
+			return;
+		}
+	} catch (MSXException&) {
+		return;
+	}
+	if (std::rename(tmpName.c_str(), cacheName.c_str()) != 0) {
+		// e.g. on windows when the destination exists
+		FileOperations::unlink(cacheName);
+		if (std::rename(tmpName.c_str(), cacheName.c_str()) != 0) {
+			FileOperations::unlink(tmpName);
+		}
+	}
+}
+
 static TTCacheEntry& getCacheEntry(
 	TTData& data, size_t dataSize, const std::string& name)
 {
@@ -40,22 +158,100 @@ static TTCacheEntry& getCacheEntry(
 		result.numNodes = numNodes;
 		memset(result.valid.data(), 0, numNodes); // all invalid
 		result.numNodesValid = 0;
+		result.dirty = false;
+		// 'result.time' now holds the current modification time
+		loadCacheEntry(result, dataSize, name);
 	}
 	return result;
 }
 
-TigerTree::TigerTree(TTData& data_, size_t dataSize_, const std::string& name)
+TigerTree::TigerTree(TTData& data_, size_t dataSize_, const std::string& name_)
 	: data(data_)
 	, dataSize(dataSize_)
+	, name(name_)
 	, entry(getCacheEntry(data, dataSize, name))
 {
 }
 
 const TigerHash& TigerTree::calcHash(const std::function<void(size_t, size_t)>& progressCallback)
 {
+	hashLeaves(progressCallback);
 	return calcHash(getTop(), progressCallback);
 }
 
+// Calculate the hashes of all invalid (full-size) leaf blocks. This is where
+// almost all of the time goes for a large image, so this work is spread over
+// multiple threads. The data itself is still fetched from TTData by this
+// (the main) thread, TTData implementations don't need to be thread-safe.
+// Interior nodes and a partial last block are left for calcHash(Node).
+void TigerTree::hashLeaves(const std::function<void(size_t, size_t)>& progressCallback)
+{
+	if (entry.valid[getTop().n]) return;
+	unsigned maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads <= 1) return;
+
+	// tiger_leaf() temporarily overwrites the byte in front of the
+	// block, so leave a gap between the blocks in the buffer.
+	static const size_t GAP = 8;
+	static const size_t STRIDE = BLOCK_SIZE + GAP;
+	static const size_t BATCH = 4096; // blocks, 4MB of data
+	static const size_t MIN_BLOCKS_PER_THREAD = 64;
+
+	size_t numBlocks = dataSize / BLOCK_SIZE; // only full blocks
+	MemBuffer<uint8_t> buffer(std::min(numBlocks, BATCH) * STRIDE);
+	std::vector<size_t> blocks;
+	size_t b = 0;
+	while (b < numBlocks) {
+		blocks.clear();
+		for (/**/; (b < numBlocks) && (blocks.size() < BATCH); ++b) {
+			if (entry.valid[getLeaf(b).n]) continue;
+			memcpy(&buffer[blocks.size() * STRIDE + GAP],
+			       data.getData(b * BLOCK_SIZE, BLOCK_SIZE),
+			       BLOCK_SIZE);
+			blocks.push_back(b);
+		}
+		if (blocks.empty()) continue;
+
+		std::atomic<size_t> next(0);
+		auto work = [&] {
+			size_t i;
+			while ((i = next++) < blocks.size()) {
+				tiger_leaf(&buffer[i * STRIDE + GAP],
+				           entry.hash[getLeaf(blocks[i]).n]);
+			}
+		};
+		size_t numThreads = std::min<size_t>(
+			maxThreads, blocks.size() / MIN_BLOCKS_PER_THREAD);
+		std::vector<std::thread> threads;
+		for (size_t t = 1; t < numThreads; ++t) {
+			try {
+				threads.emplace_back(work);
+			} catch (std::system_error&) {
+				break; // continue with the threads we already have
+			}
+		}
+		work();
+		for (auto& t : threads) t.join();
+
+		for (auto blk : blocks) {
+			entry.valid[getLeaf(blk).n] = true;
+		}
+		entry.numNodesValid += blocks.size();
+		entry.dirty = true;
+		if (progressCallback) {
+			progressCallback(entry.numNodesValid, entry.numNodes);
+		}
+	}
+}
+
+void TigerTree::save(time_t time)
+{
+	if (!entry.dirty) return;
+	entry.time = time;
+	saveCacheEntry(entry, dataSize, name);
+	entry.dirty = false;
+}
+
 void TigerTree::notifyChange(size_t offset, size_t len, time_t time)
 {
 	entry.time = time;
@@ -66,6 +262,7 @@ void TigerTree::notifyChange(size_t offset, size_t len, time_t time)
 	if (entry.valid[getTop().n]) {
 		entry.valid[getTop().n] = false; // set sentinel
 		entry.numNodesValid--;
+		entry.dirty = true;
 	}
 	auto first = offset / BLOCK_SIZE;
 	auto last = (offset + len - 1) / BLOCK_SIZE;
@@ -75,6 +272,7 @@ void TigerTree::notifyChange(size_t offset, size_t len, time_t time)
 		while (entry.valid[node.n]) {
 			entry.valid[node.n] = false;
 			entry.numNodesValid--;
+			entry.dirty = true;
 			node = getParent(node);
 		}
 	} while (++first <= last);
@@ -110,6 +308,7 @@ const TigerHash& TigerTree::calcHash(Node node, const std::function<void(size_t,
 		}
 		entry.valid[n] = true;
 		entry.numNodesValid++;
+		entry.dirty = true;
 		if (progressCallback) {
 			progressCallback(entry.numNodesValid, entry.numNodes);
 		}
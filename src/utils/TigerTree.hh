@@ -88,6 +88,15 @@ public:
 	 */
 	void notifyChange(size_t offset, size_t len, time_t time);
 
+	/** Store the calculated part of the tree in a cache file (in the
+	 * user data directory), so that a future TigerTree for the same
+	 * (unmodified) data doesn't need to start from scratch. 'time' is
+	 * the current modification time of the data. Does nothing if
+	 * nothing changed since the tree was loaded or last saved. Errors
+	 * are silently ignored, the cache is only an optimization.
+	 */
+	void save(time_t time);
+
 private:
 	// functions to navigate in binary tree
 	struct Node {
@@ -101,10 +110,12 @@ private:
 	Node getLeftChild(Node node) const;
 	Node getRightChild(Node node) const;
 
+	void hashLeaves(const std::function<void(size_t, size_t)>& progressCallback);
 	const TigerHash& calcHash(Node node, const std::function<void(size_t, size_t)>& progressCallback);
 
 	TTData& data;
 	const size_t dataSize;
+	const std::string name;
 	TTCacheEntry& entry;
 };
 
@@ -0,0 +1,87 @@
+// Correctness test and throughput benchmark for the sha1 and tiger code.
+//
+// Build (manually) with something like:
+//   g++ -O3 -Isrc/utils -Isrc -Iderived/<flavour>/config
+//       src/utils/hash_Test.cc src/utils/sha1.cc src/utils/tiger.cc
+//       src/utils/string_ref.cc src/MSXException.cc src/thread/Timer.cc
+//       -o hash-test
+
+#include "sha1.hh"
+#include "tiger.hh"
+#include "Timer.hh"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+
+static Sha1Sum sha1(const string& str)
+{
+	return SHA1::calc(reinterpret_cast<const uint8_t*>(str.data()),
+	                  str.size());
+}
+
+static void checkSha1()
+{
+	// Test vectors from FIPS PUB 180-1
+	assert(sha1("abc").toString() ==
+	       "a9993e364706816aba3e25717850c26c9cd0d89d");
+	assert(sha1("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq").toString() ==
+	       "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+	assert(sha1(string(1000000, 'a')).toString() ==
+	       "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+	assert(sha1("").toString() ==
+	       "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+
+	// Incremental updates with all kinds of (unaligned) sizes must give
+	// the same result as hashing in one go.
+	vector<uint8_t> data(10000);
+	for (size_t i = 0; i < data.size(); ++i) data[i] = uint8_t(i * 7 + (i >> 8));
+	Sha1Sum expected = SHA1::calc(data.data(), data.size());
+	for (size_t step = 1; step < 200; step += 13) {
+		SHA1 s;
+		for (size_t pos = 0; pos < data.size(); pos += step) {
+			s.update(&data[pos], min(step, data.size() - pos));
+		}
+		assert(s.digest() == expected);
+	}
+}
+
+template<typename F>
+static double measure(size_t bytes, F f)
+{
+	// best of a few runs
+	uint64_t best = uint64_t(-1);
+	for (int i = 0; i < 5; ++i) {
+		uint64_t start = Timer::getTime();
+		f();
+		best = min(best, Timer::getTime() - start);
+	}
+	return double(bytes) / max<uint64_t>(best, 1); // bytes/us == MB/s
+}
+
+int main()
+{
+	static const size_t SIZE = 64 * 1024 * 1024;
+	vector<uint8_t> data(SIZE);
+	for (size_t i = 0; i < SIZE; ++i) data[i] = uint8_t(i ^ (i >> 9));
+
+	for (bool scalar : { true, false }) {
+		SHA1::forceScalar(scalar);
+		checkSha1();
+		Sha1Sum sum;
+		double mbs = measure(SIZE, [&] { sum = SHA1::calc(data.data(), SIZE); });
+		cout << "sha1 (" << SHA1::getImplementation() << "): "
+		     << mbs << " MB/s  " << sum.toString() << endl;
+	}
+
+	TigerHash hash;
+	double mbs = measure(SIZE, [&] { tiger(data.data(), SIZE, hash); });
+	cout << "tiger: " << mbs << " MB/s  " << hash.toString() << endl;
+
+	return 0;
+}
@@ -21,8 +21,16 @@ A million repetitions of "a"
 #include "sha1.hh"
 #include "MSXException.hh"
 #include "endian.hh"
+#include "build-info.hh"
 #include <cassert>
 #include <cstring>
+#if ASM_X86 && defined(__GNUC__)
+#define SHA1_SHANI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#else
+#define SHA1_SHANI 0
+#endif
 
 using std::string;
 
@@ -87,6 +95,171 @@ WorkspaceBlock::WorkspaceBlock(const uint8_t buffer[64])
 	memcpy(data, buffer, sizeof(data));
 }
 
+static void transformScalar(uint32_t state[5], const uint8_t* data, size_t blocks)
+{
+	for (/**/; blocks != 0; --blocks, data += 64) {
+		WorkspaceBlock block(data);
+
+		// Copy state[] to working vars
+		uint32_t a = state[0];
+		uint32_t b = state[1];
+		uint32_t c = state[2];
+		uint32_t d = state[3];
+		uint32_t e = state[4];
+
+		// 4 rounds of 20 operations each. Loop unrolled
+		block.r0(a,b,c,d,e, 0); block.r0(e,a,b,c,d, 1); block.r0(d,e,a,b,c, 2);
+		block.r0(c,d,e,a,b, 3); block.r0(b,c,d,e,a, 4); block.r0(a,b,c,d,e, 5);
+		block.r0(e,a,b,c,d, 6); block.r0(d,e,a,b,c, 7); block.r0(c,d,e,a,b, 8);
+		block.r0(b,c,d,e,a, 9); block.r0(a,b,c,d,e,10); block.r0(e,a,b,c,d,11);
+		block.r0(d,e,a,b,c,12); block.r0(c,d,e,a,b,13); block.r0(b,c,d,e,a,14);
+		block.r0(a,b,c,d,e,15); block.r1(e,a,b,c,d,16); block.r1(d,e,a,b,c,17);
+		block.r1(c,d,e,a,b,18); block.r1(b,c,d,e,a,19); block.r2(a,b,c,d,e,20);
+		block.r2(e,a,b,c,d,21); block.r2(d,e,a,b,c,22); block.r2(c,d,e,a,b,23);
+		block.r2(b,c,d,e,a,24); block.r2(a,b,c,d,e,25); block.r2(e,a,b,c,d,26);
+		block.r2(d,e,a,b,c,27); block.r2(c,d,e,a,b,28); block.r2(b,c,d,e,a,29);
+		block.r2(a,b,c,d,e,30); block.r2(e,a,b,c,d,31); block.r2(d,e,a,b,c,32);
+		block.r2(c,d,e,a,b,33); block.r2(b,c,d,e,a,34); block.r2(a,b,c,d,e,35);
+		block.r2(e,a,b,c,d,36); block.r2(d,e,a,b,c,37); block.r2(c,d,e,a,b,38);
+		block.r2(b,c,d,e,a,39); block.r3(a,b,c,d,e,40); block.r3(e,a,b,c,d,41);
+		block.r3(d,e,a,b,c,42); block.r3(c,d,e,a,b,43); block.r3(b,c,d,e,a,44);
+		block.r3(a,b,c,d,e,45); block.r3(e,a,b,c,d,46); block.r3(d,e,a,b,c,47);
+		block.r3(c,d,e,a,b,48); block.r3(b,c,d,e,a,49); block.r3(a,b,c,d,e,50);
+		block.r3(e,a,b,c,d,51); block.r3(d,e,a,b,c,52); block.r3(c,d,e,a,b,53);
+		block.r3(b,c,d,e,a,54); block.r3(a,b,c,d,e,55); block.r3(e,a,b,c,d,56);
+		block.r3(d,e,a,b,c,57); block.r3(c,d,e,a,b,58); block.r3(b,c,d,e,a,59);
+		block.r4(a,b,c,d,e,60); block.r4(e,a,b,c,d,61); block.r4(d,e,a,b,c,62);
+		block.r4(c,d,e,a,b,63); block.r4(b,c,d,e,a,64); block.r4(a,b,c,d,e,65);
+		block.r4(e,a,b,c,d,66); block.r4(d,e,a,b,c,67); block.r4(c,d,e,a,b,68);
+		block.r4(b,c,d,e,a,69); block.r4(a,b,c,d,e,70); block.r4(e,a,b,c,d,71);
+		block.r4(d,e,a,b,c,72); block.r4(c,d,e,a,b,73); block.r4(b,c,d,e,a,74);
+		block.r4(a,b,c,d,e,75); block.r4(e,a,b,c,d,76); block.r4(d,e,a,b,c,77);
+		block.r4(c,d,e,a,b,78); block.r4(b,c,d,e,a,79);
+
+		// Add the working vars back into state[]
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+#if SHA1_SHANI
+// Implementation using the x86 SHA extensions (based on the Intel reference
+// code). This is compiled for the required instruction set extensions, but
+// only called after checking (at runtime) that the host CPU supports them.
+#define SHANI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+
+// Four rounds, plus the message schedule for the following rounds.
+template<int FUNC> SHANI_TARGET static inline void shaNiStep(
+	__m128i& abcd, __m128i& e0, __m128i& e1,
+	__m128i& m0, __m128i& m1, __m128i& m2, __m128i& m3)
+{
+	e0 = _mm_sha1nexte_epu32(e0, m0);
+	e1 = abcd;
+	m1 = _mm_sha1msg2_epu32(m1, m0);
+	abcd = _mm_sha1rnds4_epu32(abcd, e0, FUNC);
+	m3 = _mm_sha1msg1_epu32(m3, m0);
+	m2 = _mm_xor_si128(m2, m0);
+}
+
+SHANI_TARGET static void transformShaNi(
+	uint32_t state[5], const uint8_t* data, size_t blocks)
+{
+	const __m128i MASK = _mm_set_epi64x(
+		0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+	__m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+	abcd = _mm_shuffle_epi32(abcd, 0x1B);
+	__m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	for (/**/; blocks != 0; --blocks, data += 64) {
+		__m128i abcdSave = abcd;
+		__m128i e0Save = e0;
+		auto* in = reinterpret_cast<const __m128i*>(data);
+		__m128i e1;
+
+		// rounds 0-3
+		__m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128(in + 0), MASK);
+		e0 = _mm_add_epi32(e0, m0);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		// rounds 4-7
+		__m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), MASK);
+		e1 = _mm_sha1nexte_epu32(e1, m1);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		m0 = _mm_sha1msg1_epu32(m0, m1);
+		// rounds 8-11
+		__m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128(in + 2), MASK);
+		e0 = _mm_sha1nexte_epu32(e0, m2);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		m1 = _mm_sha1msg1_epu32(m1, m2);
+		m0 = _mm_xor_si128(m0, m2);
+		// rounds 12-15
+		__m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128(in + 3), MASK);
+		shaNiStep<0>(abcd, e1, e0, m3, m0, m1, m2);
+		// rounds 16-79 (the message schedule in the last steps is
+		// calculated but not needed, that's harmless)
+		shaNiStep<0>(abcd, e0, e1, m0, m1, m2, m3); // 16-19
+		shaNiStep<1>(abcd, e1, e0, m1, m2, m3, m0); // 20-23
+		shaNiStep<1>(abcd, e0, e1, m2, m3, m0, m1);
+		shaNiStep<1>(abcd, e1, e0, m3, m0, m1, m2);
+		shaNiStep<1>(abcd, e0, e1, m0, m1, m2, m3);
+		shaNiStep<1>(abcd, e1, e0, m1, m2, m3, m0);
+		shaNiStep<2>(abcd, e0, e1, m2, m3, m0, m1); // 40-43
+		shaNiStep<2>(abcd, e1, e0, m3, m0, m1, m2);
+		shaNiStep<2>(abcd, e0, e1, m0, m1, m2, m3);
+		shaNiStep<2>(abcd, e1, e0, m1, m2, m3, m0);
+		shaNiStep<2>(abcd, e0, e1, m2, m3, m0, m1);
+		shaNiStep<3>(abcd, e1, e0, m3, m0, m1, m2); // 60-63
+		shaNiStep<3>(abcd, e0, e1, m0, m1, m2, m3);
+		shaNiStep<3>(abcd, e1, e0, m1, m2, m3, m0);
+		shaNiStep<3>(abcd, e0, e1, m2, m3, m0, m1);
+		shaNiStep<3>(abcd, e1, e0, m3, m0, m1, m2); // 76-79
+
+		e0 = _mm_sha1nexte_epu32(e0, e0Save);
+		abcd = _mm_add_epi32(abcd, abcdSave);
+	}
+
+	abcd = _mm_shuffle_epi32(abcd, 0x1B);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(state), abcd);
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+static bool hasShaNi()
+{
+	unsigned eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+	bool ssse3  = (ecx & (1 << 9)) != 0;
+	bool sse4_1 = (ecx & (1 << 19)) != 0;
+	if (__get_cpuid_max(0, nullptr) < 7) return false;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	bool sha = (ebx & (1 << 29)) != 0;
+	return ssse3 && sse4_1 && sha;
+}
+#endif
+
+using TransformFunc = void (*)(uint32_t state[5], const uint8_t* data, size_t blocks);
+
+static TransformFunc selectTransform(bool forceScalar)
+{
+#if SHA1_SHANI
+	if (!forceScalar && hasShaNi()) return transformShaNi;
+#else
+	(void)forceScalar;
+#endif
+	return transformScalar;
+}
+
+static TransformFunc& getTransform()
+{
+	static TransformFunc transform = selectTransform(false);
+	return transform;
+}
+
 
 // class Sha1Sum
 
@@ -140,6 +313,22 @@ std::string Sha1Sum::toString() const
 	return string(buf, 40);
 }
 
+void Sha1Sum::parse20(const uint8_t* raw)
+{
+	for (auto& ai : a) {
+		ai = Endian::read_UA_B32(raw);
+		raw += 4;
+	}
+}
+
+void Sha1Sum::write20(uint8_t* raw) const
+{
+	for (const auto& ai : a) {
+		Endian::write_UA_B32(raw, ai);
+		raw += 4;
+	}
+}
+
 bool Sha1Sum::empty() const
 {
 	for (const auto& ai : a) {
@@ -168,52 +357,22 @@ SHA1::SHA1()
 	m_finalized = false;
 }
 
-void SHA1::transform(const uint8_t buffer[64])
+void SHA1::transform(const uint8_t* data, size_t blocks)
+{
+	getTransform()(m_state.a, data, blocks);
+}
+
+void SHA1::forceScalar(bool scalar)
 {
-	WorkspaceBlock block(buffer);
-
-	// Copy m_state[] to working vars
-	uint32_t a = m_state.a[0];
-	uint32_t b = m_state.a[1];
-	uint32_t c = m_state.a[2];
-	uint32_t d = m_state.a[3];
-	uint32_t e = m_state.a[4];
-
-	// 4 rounds of 20 operations each. Loop unrolled
-	block.r0(a,b,c,d,e, 0); block.r0(e,a,b,c,d, 1); block.r0(d,e,a,b,c, 2);
-	block.r0(c,d,e,a,b, 3); block.r0(b,c,d,e,a, 4); block.r0(a,b,c,d,e, 5);
-	block.r0(e,a,b,c,d, 6); block.r0(d,e,a,b,c, 7); block.r0(c,d,e,a,b, 8);
-	block.r0(b,c,d,e,a, 9); block.r0(a,b,c,d,e,10); block.r0(e,a,b,c,d,11);
-	block.r0(d,e,a,b,c,12); block.r0(c,d,e,a,b,13); block.r0(b,c,d,e,a,14);
-	block.r0(a,b,c,d,e,15); block.r1(e,a,b,c,d,16); block.r1(d,e,a,b,c,17);
-	block.r1(c,d,e,a,b,18); block.r1(b,c,d,e,a,19); block.r2(a,b,c,d,e,20);
-	block.r2(e,a,b,c,d,21); block.r2(d,e,a,b,c,22); block.r2(c,d,e,a,b,23);
-	block.r2(b,c,d,e,a,24); block.r2(a,b,c,d,e,25); block.r2(e,a,b,c,d,26);
-	block.r2(d,e,a,b,c,27); block.r2(c,d,e,a,b,28); block.r2(b,c,d,e,a,29);
-	block.r2(a,b,c,d,e,30); block.r2(e,a,b,c,d,31); block.r2(d,e,a,b,c,32);
-	block.r2(c,d,e,a,b,33); block.r2(b,c,d,e,a,34); block.r2(a,b,c,d,e,35);
-	block.r2(e,a,b,c,d,36); block.r2(d,e,a,b,c,37); block.r2(c,d,e,a,b,38);
-	block.r2(b,c,d,e,a,39); block.r3(a,b,c,d,e,40); block.r3(e,a,b,c,d,41);
-	block.r3(d,e,a,b,c,42); block.r3(c,d,e,a,b,43); block.r3(b,c,d,e,a,44);
-	block.r3(a,b,c,d,e,45); block.r3(e,a,b,c,d,46); block.r3(d,e,a,b,c,47);
-	block.r3(c,d,e,a,b,48); block.r3(b,c,d,e,a,49); block.r3(a,b,c,d,e,50);
-	block.r3(e,a,b,c,d,51); block.r3(d,e,a,b,c,52); block.r3(c,d,e,a,b,53);
-	block.r3(b,c,d,e,a,54); block.r3(a,b,c,d,e,55); block.r3(e,a,b,c,d,56);
-	block.r3(d,e,a,b,c,57); block.r3(c,d,e,a,b,58); block.r3(b,c,d,e,a,59);
-	block.r4(a,b,c,d,e,60); block.r4(e,a,b,c,d,61); block.r4(d,e,a,b,c,62);
-	block.r4(c,d,e,a,b,63); block.r4(b,c,d,e,a,64); block.r4(a,b,c,d,e,65);
-	block.r4(e,a,b,c,d,66); block.r4(d,e,a,b,c,67); block.r4(c,d,e,a,b,68);
-	block.r4(b,c,d,e,a,69); block.r4(a,b,c,d,e,70); block.r4(e,a,b,c,d,71);
-	block.r4(d,e,a,b,c,72); block.r4(c,d,e,a,b,73); block.r4(b,c,d,e,a,74);
-	block.r4(a,b,c,d,e,75); block.r4(e,a,b,c,d,76); block.r4(d,e,a,b,c,77);
-	block.r4(c,d,e,a,b,78); block.r4(b,c,d,e,a,79);
-
-	// Add the working vars back into m_state[]
-	m_state.a[0] += a;
-	m_state.a[1] += b;
-	m_state.a[2] += c;
-	m_state.a[3] += d;
-	m_state.a[4] += e;
+	getTransform() = selectTransform(scalar);
+}
+
+const char* SHA1::getImplementation()
+{
+#if SHA1_SHANI
+	if (getTransform() == transformShaNi) return "sha-ni";
+#endif
+	return "scalar";
 }
 
 // Use this function to hash in binary data and strings
@@ -227,10 +386,10 @@ void SHA1::update(const uint8_t* data, size_t len)
 	size_t i;
 	if ((j + len) > 63) {
 		memcpy(&m_buffer[j], data, (i = 64 - j));
-		transform(m_buffer);
-		for (; i + 63 < len; i += 64) {
-			transform(&data[i]);
-		}
+		transform(m_buffer, 1);
+		size_t blocks = (len - i) / 64;
+		transform(&data[i], blocks);
+		i += blocks * 64;
 		j = 0;
 	} else {
 		i = 0;
@@ -27,6 +27,10 @@ public:
 	void parse40(const char* str);
 	std::string toString() const;
 
+	/** Convert from/to the 20-byte binary (big endian) representation. */
+	void parse20(const uint8_t* raw);
+	void write20(uint8_t* raw) const;
+
 	// Test or set 'null' value.
 	bool empty() const;
 	void clear();
@@ -83,8 +87,17 @@ public:
 	/** Easier to use interface, if you can pass all data in one go. */
 	static Sha1Sum calc(const uint8_t* data, size_t len);
 
+	/** By default the fastest implementation supported by the host CPU
+	  * is selected at runtime. This allows to force the portable (scalar)
+	  * implementation, mostly useful for testing and benchmarking.
+	  * Not thread-safe, only call this when no hashes are calculated.
+	  */
+	static void forceScalar(bool scalar);
+	/** Name of the currently selected implementation. */
+	static const char* getImplementation();
+
 private:
-	void transform(const uint8_t buffer[64]);
+	void transform(const uint8_t* data, size_t blocks);
 	void finalize();
 
 	uint64_t m_count;
@@ -91,7 +91,7 @@ void AviRecorder::start(bool recordAudio, bool recordVideo, bool recordMono,
 	} else {
 		assert(recordAudio);
 		wavWriter = make_unique<Wav16Writer>(
-			filename, stereo ? 2 : 1, sampleRate);
+			reactor.getCliComm(), filename, stereo ? 2 : 1, sampleRate);
 	}
 	// only set recorders when all errors are checked for
 	for (auto* pp : postProcessors) {
@@ -163,14 +163,16 @@ void AviRecorder::addImage(FrameSource* frame, EmuTime::param time)
 {
 	assert(!wavWriter);
 	if (duration != EmuDuration::infinity) {
-		if (!warnedFps && ((time - prevTime) != duration)) {
+		// time can go backwards when a reverse snapshot is restored
+		if (!warnedFps && ((time < prevTime) ||
+		                   ((time - prevTime) != duration))) {
 			warnedFps = true;
 			reactor.getCliComm().printWarning(
 				"Detected frame rate change (PAL/NTSC or frameskip) "
 				"during avi recording. Audio/video might get out of "
 				"sync because of this.");
 		}
-	} else if (prevTime != EmuTime::infinity) {
+	} else if ((prevTime != EmuTime::infinity) && (prevTime < time)) {
 		duration = time - prevTime;
 		aviWriter->setFps(1.0 / duration.toDouble());
 	}
@@ -93,7 +93,9 @@ unsigned PostProcessor::getLineWidth(
 std::unique_ptr<RawFrame> PostProcessor::rotateFrames(
 	std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time)
 {
-	if (renderSettings.getInterleaveBlackFrame()) {
+	// 'lastRotate' is in the future after a reverse snapshot was
+	// restored in place, then skip one black frame.
+	if (renderSettings.getInterleaveBlackFrame() && (lastRotate < time)) {
 		auto delta = time - lastRotate; // time between last two calls
 		auto middle = time + delta / 2; // estimate for middle between now
 		                                // and next call
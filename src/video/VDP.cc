@@ -29,6 +29,7 @@ TODO:
 #include "EnumSetting.hh"
 #include "TclObject.hh"
 #include "MSXCPU.hh"
+#include "MemoryCoverage.hh"
 #include "MSXMotherBoard.hh"
 #include "Reactor.hh"
 #include "MSXException.hh"
@@ -812,6 +813,15 @@ void VDP::executeCpuVramAccess(EmuTime::param time)
 		} else {
 			vram->cpuWrite(addr, cpuVramData, time);
 		}
+		auto& coverage = cpu.getCoverage();
+		if (unlikely(coverage.isActive())) {
+			// same name as the 'physical VRAM' debuggable
+			coverage.access(
+				(getName() == "VDP") ? string("physical VRAM")
+				                     : "physical " + getName() + " VRAM",
+				addr, cpuVramReqIsRead ? MemoryCoverage::READ
+				                       : MemoryCoverage::WRITTEN);
+		}
 	} else {
 		if (cpuVramReqIsRead) {
 			cpuVramData = 0xFF;
@@ -94,6 +94,18 @@ void VDPVRAM::PhysicalVRAMDebuggable::write(
 	vram.cpuWrite(address, value, time);
 }
 
+void VDPVRAM::PhysicalVRAMDebuggable::readBlock(
+	unsigned address, byte* output, unsigned num)
+{
+	// Same as calling read() for each byte, but the command engine only
+	// needs to be synchronized once.
+	auto& vram = OUTER(VDPVRAM, physicalVRAMDebug);
+	EmuTime::param time = getMotherBoard().getCurrentTime();
+	vram.cmdEngine->sync(time);
+	vram.cmdEngine->stealAccessSlot(time);
+	memcpy(output, &vram.data[address], num);
+}
+
 
 // class VDPVRAM
 
@@ -327,6 +339,10 @@ void VDPVRAM::serialize(Archive& ar, unsigned /*version*/)
 	if (ar.isLoader()) {
 		vrMode = vdp.getVRMode();
 		setSizeMask(static_cast<MSXDevice&>(vdp).getCurrentTime());
+		#ifdef DEBUG
+		// time may have jumped backwards (reverse)
+		vramTime = EmuTime::zero;
+		#endif
 	}
 
 	ar.serialize_blob("data", &data[0], actualSize);